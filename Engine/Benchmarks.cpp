@@ -0,0 +1,651 @@
+#include "Benchmarks.h"
+#include "FaultFormation.h"
+#include "HeightFilter.h"
+#include "HydraulicErosion.h"
+#include "LSystem.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include "PerlinNoise.h"
+#include "SegmentBVH.h"
+#include "SpatialHash.h"
+#include "Turtle.h"
+#include "WorldGenContext.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+    // Runs the function until at least minSeconds have passed and returns the mean time per run.
+    template <typename Function>
+    double TimeSeconds(Function function, double minSeconds = 0.2)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+
+        int runs = 0;
+        const auto start = Clock::now();
+        double elapsed = 0.0;
+
+        do
+        {
+            function();
+            runs++;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < minSeconds);
+
+        return elapsed / runs;
+    }
+
+    // The original rewriting loop, kept as the reference to compare against.
+    std::string RewriteNaive(const std::string& axiom, const std::vector<std::pair<char, std::string>>& rules, int iterations)
+    {
+        std::string currentString = axiom;
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            std::string nextString;
+
+            for (char c : currentString)
+            {
+                bool ruleFound = false;
+
+                for (const auto& rule : rules)
+                {
+                    if (c == rule.first)
+                    {
+                        nextString += rule.second;
+                        ruleFound = true;
+                        break;
+                    }
+                }
+
+                if (!ruleFound)
+                {
+                    nextString += c;
+                }
+            }
+            currentString = nextString;
+        }
+
+        return currentString;
+    }
+
+    // The original smoothing pass: copies the map, then averages the 8 neighbours of every texel.
+    void SmoothNaive(std::vector<float>& heights, std::vector<float>& smoothed, int width, int height, float smoothFactor)
+    {
+        smoothed = heights;
+
+        for (int j = 1; j < height - 1; j++)
+        {
+            for (int i = 1; i < width - 1; i++)
+            {
+                float avgHeight = 0.0f;
+                for (int dz = -1; dz <= 1; dz++)
+                {
+                    for (int dx = -1; dx <= 1; dx++)
+                    {
+                        if (dx != 0 || dz != 0)
+                        {
+                            avgHeight += heights[(j + dz) * width + i + dx];
+                        }
+                    }
+                }
+                avgHeight /= 8.0f;
+
+                const int index = j * width + i;
+                smoothed[index] = heights[index] * (1.0f - smoothFactor) + avgHeight * smoothFactor;
+            }
+        }
+
+        heights.swap(smoothed);
+    }
+
+    // The original fault loop: every fault visits every texel.
+    void FaultsNaive(std::vector<float>& heights, int width, int height, int faultCount, float displacement, RandomStream& random)
+    {
+        for (int iteration = 0; iteration < faultCount; iteration++)
+        {
+            const float pointX1 = random.NextFloat(0.0f, static_cast<float>(width));
+            const float pointZ1 = random.NextFloat(0.0f, static_cast<float>(height));
+            const float pointX2 = random.NextFloat(0.0f, static_cast<float>(width));
+            const float pointZ2 = random.NextFloat(0.0f, static_cast<float>(height));
+
+            const float A = pointZ1 - pointZ2;
+            const float B = pointX2 - pointX1;
+            const float C = pointX1 * pointZ2 - pointX2 * pointZ1;
+
+            for (int z = 0; z < height; z++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    if ((A * x + B * z + C) > 0)
+                    {
+                        heights[z * width + x] += displacement;
+                    }
+                    else
+                    {
+                        heights[z * width + x] -= displacement;
+                    }
+                }
+            }
+        }
+    }
+}
+
+namespace Benchmarks
+{
+    std::vector<FbmResult> RunFbmNoise(int width, int height, int maxOctaves)
+    {
+        const float scale = 10.0f;
+        const float heightScale = 3.0f;
+        const double megaTexels = (static_cast<double>(width) * height) / 1.0e6;
+        const auto bestKernel = PerlinNoise::GetBestKernel();
+
+        PerlinNoise noise;
+        std::vector<float> scalarHeights(width * height);
+        std::vector<float> simdHeights(width * height);
+        std::vector<FbmResult> results;
+
+        for (int octaves = 1; octaves <= maxOctaves; octaves++)
+        {
+            FbmResult result;
+            result.octaves = octaves;
+
+            result.scalarMTexelsPerSecond = megaTexels / TimeSeconds([&]()
+            {
+                noise.GenerateFbm(PerlinNoise::Kernel::Scalar, scalarHeights.data(), width, height, scale, octaves, heightScale, false);
+            });
+
+            result.simdMTexelsPerSecond = megaTexels / TimeSeconds([&]()
+            {
+                noise.GenerateFbm(bestKernel, simdHeights.data(), width, height, scale, octaves, heightScale, false);
+            });
+
+            result.parallelMTexelsPerSecond = megaTexels / TimeSeconds([&]()
+            {
+                noise.GenerateFbm(bestKernel, simdHeights.data(), width, height, scale, octaves, heightScale, true);
+            });
+
+            result.bitIdentical = std::memcmp(scalarHeights.data(), simdHeights.data(), scalarHeights.size() * sizeof(float)) == 0;
+
+            results.push_back(result);
+        }
+
+        return results;
+    }
+
+    std::vector<LSystemResult> RunLSystem(const std::string& axiom,
+        const std::vector<std::pair<char, std::string>>& rules, int maxIterations)
+    {
+        std::vector<LSystemResult> results;
+
+        for (int iterations = 1; iterations <= maxIterations; iterations++)
+        {
+            // Symbols written over every generation
+            double symbolsWritten = 0.0;
+            for (int generation = 1; generation <= iterations; generation++)
+            {
+                symbolsWritten += static_cast<double>(LSystem(axiom, rules, 0).GetLengthAfter(generation));
+            }
+            const double megaSymbols = symbolsWritten / 1.0e6;
+
+            std::string naiveString;
+            LSystemResult result;
+            result.iterations = iterations;
+
+            result.naiveMSymbolsPerSecond = megaSymbols / TimeSeconds([&]()
+            {
+                naiveString = RewriteNaive(axiom, rules, iterations);
+            });
+
+            result.engineMSymbolsPerSecond = megaSymbols / TimeSeconds([&]()
+            {
+                LSystem lsystem(axiom, rules, iterations);
+                lsystem.Generate();
+            });
+
+            LSystem lsystem(axiom, rules, iterations);
+            lsystem.Generate();
+
+            result.symbols = lsystem.GetCurrentString().size();
+            result.identical = lsystem.GetCurrentString() == naiveString;
+
+            results.push_back(result);
+        }
+
+        return results;
+    }
+
+    MeshResult RunMeshOptimizer(const std::string& path)
+    {
+        MeshResult result = {};
+
+        std::ifstream file(path, std::ios::binary);
+        const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        ObjMesh source;
+        if (!ObjLoader::Parse(text.data(), text.size(), source))
+        {
+            return result;
+        }
+
+        // Each run optimises a fresh copy, since the passes work in place.
+        ObjMesh mesh;
+        size_t vertexCount = 0;
+        MeshOptimizeStats stats = {};
+
+        result.optimiseMilliseconds = 1000.0 * TimeSeconds([&]()
+        {
+            mesh = source;
+            vertexCount = mesh.vertices.size();
+            stats = MeshOptimizer::OptimizeMesh(mesh.vertices.data(), sizeof(ObjVertex), vertexCount, mesh.indices.data(), mesh.indices.size());
+        });
+
+        result.loaded = true;
+        result.triangles = source.indices.size() / 3;
+        result.verticesBefore = stats.verticesBefore;
+        result.verticesAfter = stats.verticesAfter;
+        result.acmrBefore = stats.acmrBefore;
+        result.acmrAfter = stats.acmrAfter;
+
+        return result;
+    }
+
+    SpatialHashResult RunSpatialHash(int objectCount)
+    {
+        // Same density whatever the count: about one object per 20 cubic units.
+        const float worldSize = std::cbrt(20.0f * objectCount);
+
+        std::mt19937 random(12345);
+        std::uniform_real_distribution<float> position(0.0f, worldSize);
+        std::uniform_real_distribution<float> radius(0.1f, 0.5f);
+
+        std::vector<float> boundsMin(objectCount * 3);
+        std::vector<float> boundsMax(objectCount * 3);
+
+        for (int i = 0; i < objectCount; i++)
+        {
+            const float r = radius(random);
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const float centre = position(random);
+                boundsMin[i * 3 + axis] = centre - r;
+                boundsMax[i * 3 + axis] = centre + r;
+            }
+        }
+
+        SpatialHashResult result;
+        result.objects = objectCount;
+
+        SpatialHash hash(0.6f);
+        std::vector<std::pair<int, int>> hashPairs;
+
+        result.hashMilliseconds = 1000.0 * TimeSeconds([&]()
+        {
+            hash.Clear();
+            for (int i = 0; i < objectCount; i++)
+            {
+                hash.Add(&boundsMin[i * 3], &boundsMax[i * 3]);
+            }
+            hash.Build();
+
+            hashPairs.clear();
+            hash.FindPairs(hashPairs);
+        });
+
+        std::vector<std::pair<int, int>> bruteForcePairs;
+
+        result.bruteForceMilliseconds = 1000.0 * TimeSeconds([&]()
+        {
+            bruteForcePairs.clear();
+
+            for (int a = 0; a < objectCount; a++)
+            {
+                for (int b = a + 1; b < objectCount; b++)
+                {
+                    bool overlaps = true;
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        overlaps &= boundsMin[a * 3 + axis] <= boundsMax[b * 3 + axis] && boundsMin[b * 3 + axis] <= boundsMax[a * 3 + axis];
+                    }
+
+                    if (overlaps)
+                    {
+                        bruteForcePairs.push_back(std::make_pair(a, b));
+                    }
+                }
+            }
+        });
+
+        std::sort(hashPairs.begin(), hashPairs.end());
+
+        result.pairs = hashPairs.size();
+        result.identical = hashPairs == bruteForcePairs;
+
+        return result;
+    }
+
+    std::vector<SegmentBVHResult> RunSegmentBVH(int maxIterations)
+    {
+        // FractalObstacle::SegmentRadius: half the drawn width of a segment
+        const float segmentRadius = 0.02f;
+        const float queryRadius = 0.5f;
+        const int queryCount = 1000;
+
+        std::vector<SegmentBVHResult> results;
+
+        for (int iterations = 1; iterations <= maxIterations; iterations++)
+        {
+            const float start[3] = { 0.0f, 0.0f, 0.0f };
+            Turtle turtle(start, 35.0f, 2.5f, 0.2f);
+
+            const LSystem lsystem("F", { {'F', "FF+[+F-F-F]-[-F+F+F]"} }, iterations);
+            LSystem::Expansion expansion = lsystem.Expand();
+            char symbols[256];
+            size_t count;
+
+            while ((count = expansion.Read(symbols, sizeof(symbols))) > 0)
+            {
+                turtle.Interpret(symbols, count);
+            }
+
+            const SegmentList& segments = turtle.GetSegments();
+
+            // Segment end points, for the brute force reference
+            std::vector<float> ends(segments.size() * 3);
+            for (size_t i = 0; i < segments.size(); i++)
+            {
+                ends[i * 3 + 0] = segments.startX[i] + segments.directionX[i] * segments.length[i];
+                ends[i * 3 + 1] = segments.startY[i] + segments.directionY[i] * segments.length[i];
+                ends[i * 3 + 2] = segments.startZ[i] + segments.directionZ[i] * segments.length[i];
+            }
+
+            SegmentBVH bvh;
+
+            SegmentBVHResult result;
+            result.iterations = iterations;
+            result.segments = segments.size();
+            result.buildMilliseconds = 1000.0 * TimeSeconds([&]()
+            {
+                bvh.Build(segments, segmentRadius);
+            });
+            result.nodes = bvh.GetNodeCount();
+            result.depth = bvh.GetDepth();
+
+            // Sphere centres and ray origins scattered over the obstacle's bounds, rays in random directions
+            std::mt19937 random(4321);
+            std::vector<float> points(queryCount * 3);
+            std::vector<float> directions(queryCount * 3);
+            std::normal_distribution<float> normal(0.0f, 1.0f);
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                std::uniform_real_distribution<float> position(bvh.GetBoundsMin()[axis], bvh.GetBoundsMax()[axis]);
+                for (int query = 0; query < queryCount; query++)
+                {
+                    points[query * 3 + axis] = position(random);
+                }
+            }
+
+            for (int query = 0; query < queryCount; query++)
+            {
+                float* direction = &directions[query * 3];
+                float length = 0.0f;
+
+                while (length < 1.0e-3f)
+                {
+                    direction[0] = normal(random);
+                    direction[1] = normal(random);
+                    direction[2] = normal(random);
+                    length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+                }
+
+                direction[0] /= length;
+                direction[1] /= length;
+                direction[2] /= length;
+            }
+
+            const float maxDistance = 100.0f;
+
+            std::vector<std::vector<int>> bvhSpheres(queryCount), bruteForceSpheres(queryCount);
+            std::vector<float> bvhRays(queryCount), bruteForceRays(queryCount);
+
+            result.bvhMicroseconds = 1.0e6 / queryCount * TimeSeconds([&]()
+            {
+                for (int query = 0; query < queryCount; query++)
+                {
+                    bvhSpheres[query].clear();
+                    bvh.QuerySphere(&points[query * 3], queryRadius, bvhSpheres[query]);
+
+                    SegmentBVH::RayHit hit;
+                    bvhRays[query] = bvh.Raycast(&points[query * 3], &directions[query * 3], maxDistance, hit) ? hit.distance : -1.0f;
+                }
+            });
+
+            result.bruteForceMicroseconds = 1.0e6 / queryCount * TimeSeconds([&]()
+            {
+                for (int query = 0; query < queryCount; query++)
+                {
+                    bruteForceSpheres[query].clear();
+                    float nearest = -1.0f;
+
+                    for (size_t i = 0; i < segments.size(); i++)
+                    {
+                        const float segmentStart[3] = { segments.startX[i], segments.startY[i], segments.startZ[i] };
+
+                        if (SegmentBVH::SegmentOverlapsSphere(segmentStart, &ends[i * 3], segmentRadius, &points[query * 3], queryRadius))
+                        {
+                            bruteForceSpheres[query].push_back(static_cast<int>(i));
+                        }
+
+                        const float t = SegmentBVH::RaycastCapsule(&points[query * 3], &directions[query * 3], segmentStart, &ends[i * 3], segmentRadius);
+                        if (t >= 0.0f && t <= maxDistance && (nearest < 0.0f || t < nearest))
+                        {
+                            nearest = t;
+                        }
+                    }
+
+                    bruteForceRays[query] = nearest;
+                }
+            });
+
+            // Traversal statistics and comparison, outside the timed runs
+            SegmentBVH::QueryStats sphereStats, rayStats;
+            result.identical = true;
+
+            for (int query = 0; query < queryCount; query++)
+            {
+                std::vector<int> found;
+                bvh.QuerySphere(&points[query * 3], queryRadius, found, &sphereStats);
+
+                SegmentBVH::RayHit hit;
+                bvh.Raycast(&points[query * 3], &directions[query * 3], maxDistance, hit, &rayStats);
+
+                std::sort(found.begin(), found.end());
+                result.identical &= found == bruteForceSpheres[query] && bvhRays[query] == bruteForceRays[query];
+            }
+
+            result.sphereSegmentsTested = static_cast<double>(sphereStats.segmentsTested) / queryCount;
+            result.raySegmentsTested = static_cast<double>(rayStats.segmentsTested) / queryCount;
+
+            results.push_back(result);
+        }
+
+        return results;
+    }
+
+    ErosionResult RunHydraulicErosion(int size, int dropletCount, int gridIterations)
+    {
+        const int texelCount = size * size;
+
+        PerlinNoise noise;
+        std::vector<float> source(texelCount);
+        noise.GenerateFbm(PerlinNoise::GetBestKernel(), source.data(), size, size, 10.0f, 6, 3.0f);
+
+        HydraulicErosion erosion;
+        HydraulicErosion::DropletSettings dropletSettings;
+        dropletSettings.dropletCount = dropletCount;
+
+        ErosionResult result;
+        result.size = size;
+        result.droplets = dropletCount;
+
+        // Each run erodes a fresh copy, so time a single run rather than repeating it
+        std::vector<float> eroded = source;
+        result.dropletSeconds = TimeSeconds([&]()
+        {
+            erosion.ErodeDroplets(eroded.data(), size, size, dropletSettings, 1234u);
+        }, 0.0);
+        result.mDropletsPerSecond = dropletCount / result.dropletSeconds / 1.0e6;
+
+        std::vector<float> repeated = source;
+        erosion.ErodeDroplets(repeated.data(), size, size, dropletSettings, 1234u);
+        result.deterministic = std::memcmp(eroded.data(), repeated.data(), texelCount * sizeof(float)) == 0;
+
+        double totalChange = 0.0;
+        for (int i = 0; i < texelCount; i++)
+        {
+            totalChange += std::fabs(eroded[i] - source[i]);
+        }
+        result.meanHeightChange = static_cast<float>(totalChange / texelCount);
+
+        HydraulicErosion::GridSettings gridSettings;
+        gridSettings.iterations = gridIterations;
+        result.gridIterations = gridIterations;
+
+        std::vector<float> flooded = source;
+        result.gridMillisecondsPerIteration = 1000.0 / std::max(1, gridIterations) * TimeSeconds([&]()
+        {
+            erosion.ErodeGrid(flooded.data(), size, size, gridSettings);
+        }, 0.0);
+
+        return result;
+    }
+
+    HeightFilterResult RunHeightFilters(int size, int iterations)
+    {
+        const int texelCount = size * size;
+        iterations = std::max(1, iterations);
+
+        PerlinNoise noise;
+        std::vector<float> source(texelCount);
+        noise.GenerateFbm(PerlinNoise::GetBestKernel(), source.data(), size, size, 10.0f, 6, 3.0f);
+
+        HeightFilter filter;
+        HeightFilterResult result;
+        result.size = size;
+        result.iterations = iterations;
+
+        const double perIteration = 1000.0 / iterations;
+
+        std::vector<float> naive = source;
+        std::vector<float> naiveScratch;
+        result.naiveSmoothMilliseconds = perIteration * TimeSeconds([&]()
+        {
+            for (int i = 0; i < iterations; i++)
+            {
+                SmoothNaive(naive, naiveScratch, size, size, 0.5f);
+            }
+        });
+
+        std::vector<float> fused = source;
+        result.smoothMilliseconds = perIteration * TimeSeconds([&]()
+        {
+            filter.Smooth(fused.data(), size, size, 0.5f, iterations);
+        });
+
+        // Fusing iterations must not change the result
+        fused = source;
+        filter.Smooth(fused.data(), size, size, 0.5f, iterations);
+        std::vector<float> stepped = source;
+        for (int i = 0; i < iterations; i++)
+        {
+            filter.Smooth(stepped.data(), size, size, 0.5f, 1);
+        }
+        result.fusedMatchesStepped = std::memcmp(fused.data(), stepped.data(), texelCount * sizeof(float)) == 0;
+
+        std::vector<float> blurred = source;
+        result.gaussianMilliseconds = perIteration * TimeSeconds([&]()
+        {
+            filter.GaussianBlur(blurred.data(), size, size, 2.0f, iterations);
+        });
+
+        std::vector<float> slumped = source;
+        result.thermalMilliseconds = perIteration * TimeSeconds([&]()
+        {
+            filter.ThermalErosion(slumped.data(), size, size, 0.005f, 0.5f, iterations);
+        });
+
+        double sourceTotal = 0.0;
+        double slumpedTotal = 0.0;
+        slumped = source;
+        filter.ThermalErosion(slumped.data(), size, size, 0.005f, 0.5f, iterations);
+        for (int i = 0; i < texelCount; i++)
+        {
+            sourceTotal += source[i];
+            slumpedTotal += slumped[i];
+        }
+        result.thermalMassDrift = static_cast<float>(std::fabs(slumpedTotal - sourceTotal) / std::max(1.0e-9, std::fabs(sourceTotal)));
+
+        return result;
+    }
+
+    FaultResult RunFaultFormation(int size, int faults)
+    {
+        const int texelCount = size * size;
+        const unsigned int seed = 505;
+
+        FaultFormation formation;
+        FaultFormation::Settings settings;
+        settings.faultCount = faults;
+
+        FaultResult result;
+        result.size = size;
+        result.faults = faults;
+
+        // Each run adds to the map, so time single runs on fresh maps
+        std::vector<float> swept(texelCount, 0.0f);
+        result.sweepMilliseconds = 1000.0 * TimeSeconds([&]()
+        {
+            RandomStream random(seed);
+            formation.Generate(swept.data(), size, size, settings, random);
+        }, 0.0);
+
+        FaultFormation::Settings falloffSettings = settings;
+        falloffSettings.falloffWidth = 8.0f;
+        std::vector<float> blended(texelCount, 0.0f);
+        result.falloffMilliseconds = 1000.0 * TimeSeconds([&]()
+        {
+            RandomStream random(seed);
+            formation.Generate(blended.data(), size, size, falloffSettings, random);
+        }, 0.0);
+
+        // The per-texel loop is far too slow for every fault, so run the first few and scale up
+        result.referenceFaults = std::min(faults, 100);
+        std::vector<float> naive(texelCount, 0.0f);
+        result.naiveMilliseconds = 1000.0 * static_cast<double>(faults) / std::max(1, result.referenceFaults) * TimeSeconds([&]()
+        {
+            RandomStream random(seed);
+            FaultsNaive(naive, size, size, result.referenceFaults, settings.initialDisplacement, random);
+        }, 0.0);
+
+        FaultFormation::Settings referenceSettings = settings;
+        referenceSettings.faultCount = result.referenceFaults;
+        std::vector<float> reference(texelCount, 0.0f);
+        RandomStream random(seed);
+        formation.Generate(reference.data(), size, size, referenceSettings, random);
+
+        result.maxDifference = 0.0f;
+        for (int i = 0; i < texelCount; i++)
+        {
+            result.maxDifference = std::max(result.maxDifference, std::fabs(reference[i] - naive[i]));
+        }
+
+        return result;
+    }
+}
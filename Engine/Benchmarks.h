@@ -0,0 +1,125 @@
+#pragma once
+
+// Throughput benchmarks for the procedural generation code.
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Benchmarks
+{
+    struct FbmResult
+    {
+        int octaves;
+        double scalarMTexelsPerSecond;     // scalar kernel, one thread
+        double simdMTexelsPerSecond;       // best SIMD kernel, one thread
+        double parallelMTexelsPerSecond;   // best SIMD kernel, all cores
+        bool bitIdentical;                 // SIMD output matches the scalar output exactly
+    };
+
+    // Runs the fBm Perlin noise kernels on a width x height grid for 1..maxOctaves octaves.
+    std::vector<FbmResult> RunFbmNoise(int width, int height, int maxOctaves);
+
+    struct LSystemResult
+    {
+        int iterations;
+        size_t symbols;                       // length of the final string
+        double naiveMSymbolsPerSecond;        // string += with a linear rule search
+        double engineMSymbolsPerSecond;       // LSystem
+        bool identical;                       // both produce the same string
+    };
+
+    // Expands axiom with rules for 1..maxIterations generations. Symbols per second count every
+    // symbol written across all generations.
+    std::vector<LSystemResult> RunLSystem(const std::string& axiom,
+        const std::vector<std::pair<char, std::string>>& rules, int maxIterations);
+
+    struct MeshResult
+    {
+        bool loaded;
+        size_t triangles;
+        size_t verticesBefore;                // after OBJ corner welding
+        size_t verticesAfter;
+        float acmrBefore;                     // simulated 16-entry FIFO transform cache
+        float acmrAfter;
+        double optimiseMilliseconds;
+    };
+
+    // Parses an OBJ file and runs it through MeshOptimizer, as the .meshbin cache bake does.
+    MeshResult RunMeshOptimizer(const std::string& path);
+
+    struct SpatialHashResult
+    {
+        int objects;
+        size_t pairs;                         // overlapping pairs found
+        double hashMilliseconds;              // SpatialHash rebuild plus FindPairs
+        double bruteForceMilliseconds;        // every pair tested
+        bool identical;                       // both find the same pairs
+    };
+
+    // Scatters objectCount random spheres of drone-like size and finds every overlapping pair,
+    // as a per-frame broad-phase for that many moving objects would.
+    SpatialHashResult RunSpatialHash(int objectCount);
+
+    struct SegmentBVHResult
+    {
+        int iterations;
+        size_t segments;
+        size_t nodes;
+        int depth;
+        double buildMilliseconds;
+        double sphereSegmentsTested;          // per query, on average
+        double raySegmentsTested;
+        double bvhMicroseconds;               // one sphere query plus one ray query
+        double bruteForceMicroseconds;        // the same queries testing every segment
+        bool identical;                       // both find the same segments and hit distances
+    };
+
+    // Builds a SegmentBVH over the CRYSTALS obstacle at 1..maxIterations and runs drone-sized
+    // sphere queries and rays through it.
+    std::vector<SegmentBVHResult> RunSegmentBVH(int maxIterations);
+
+    struct ErosionResult
+    {
+        int size;
+        int droplets;
+        double dropletSeconds;
+        double mDropletsPerSecond;
+        int gridIterations;
+        double gridMillisecondsPerIteration;  // shallow water mode
+        float meanHeightChange;               // mean absolute change from the droplets
+        bool deterministic;                   // a second droplet run with the same seed matches exactly
+    };
+
+    // Erodes an fBm terrain of size x size with the droplet and grid modes of HydraulicErosion.
+    ErosionResult RunHydraulicErosion(int size, int dropletCount, int gridIterations);
+
+    struct HeightFilterResult
+    {
+        int size;
+        int iterations;
+        double naiveSmoothMilliseconds;   // per iteration, original copy-and-average pass
+        double smoothMilliseconds;        // per iteration, all iterations fused in one call
+        double gaussianMilliseconds;      // per iteration, sigma 2
+        double thermalMilliseconds;       // per iteration
+        bool fusedMatchesStepped;         // fused iterations match one call per iteration exactly
+        float thermalMassDrift;           // relative change of the summed height
+    };
+
+    // Smooths, blurs and thermally erodes an fBm terrain of size x size with HeightFilter.
+    HeightFilterResult RunHeightFilters(int size, int iterations);
+
+    struct FaultResult
+    {
+        int size;
+        int faults;
+        double sweepMilliseconds;         // hard steps
+        double falloffMilliseconds;       // blended over 8 texels
+        double naiveMilliseconds;         // per-texel loop, extrapolated from the first referenceFaults
+        int referenceFaults;
+        float maxDifference;              // sweep vs per-texel loop over the reference faults
+    };
+
+    // Generates faults on a flat size x size map with FaultFormation and with the original per-texel loop.
+    FaultResult RunFaultFormation(int size, int faults);
+}
@@ -0,0 +1,556 @@
+#include "CollisionBatch.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define COLLISION_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+// The SIMD kernels only match the scalar kernel bit for bit if neither side is contracted into FMAs.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define COLLISION_BATCH_TARGET_SSE2 __attribute__((target("sse2")))
+#define COLLISION_BATCH_TARGET_AVX __attribute__((target("avx")))
+#else
+#define COLLISION_BATCH_TARGET_SSE2
+#define COLLISION_BATCH_TARGET_AVX
+#endif
+
+using namespace Utils::Collision;
+
+namespace
+{
+	const size_t LanePadding = 8;
+
+	// Added to |R| so that near-parallel edges, whose cross product is close to zero, cannot
+	// produce a separating axis out of rounding noise.
+	const float AxisEpsilon = 1.0e-6f;
+
+	// Appends value at index count, keeping the array padded to a multiple of LanePadding.
+	void Append(std::vector<float>& values, size_t count, float value)
+	{
+		values.resize((count + LanePadding) / LanePadding * LanePadding, 0.0f);
+		values[count] = value;
+	}
+
+	void PrepareMasks(size_t count, std::vector<uint32_t>& hitMasks)
+	{
+		hitMasks.assign((count + 31) / 32, 0u);
+	}
+
+	void ClearPaddingBits(size_t count, std::vector<uint32_t>& hitMasks)
+	{
+		if (count % 32 != 0)
+		{
+			hitMasks.back() &= (1u << (count % 32)) - 1u;
+		}
+	}
+
+	bool SphereHit(const float centre[3], float radius, const SphereBatch& batch, size_t e)
+	{
+		const float dx = batch.centre[0][e] - centre[0];
+		const float dy = batch.centre[1][e] - centre[1];
+		const float dz = batch.centre[2][e] - centre[2];
+		const float distanceSquared = dx * dx + dy * dy + dz * dz;
+		const float radiusSum = radius + batch.radius[e];
+
+		return distanceSquared <= radiusSum * radiusSum;
+	}
+
+	// Unit quaternion (x, y, z, w) to the rows of its rotation matrix.
+	void QuaternionAxes(const float q[4], float axes[3][3])
+	{
+		const float x = q[0], y = q[1], z = q[2], w = q[3];
+
+		axes[0][0] = 1.0f - 2.0f * (y * y + z * z);
+		axes[0][1] = 2.0f * (x * y + z * w);
+		axes[0][2] = 2.0f * (x * z - y * w);
+		axes[1][0] = 2.0f * (x * y - z * w);
+		axes[1][1] = 1.0f - 2.0f * (x * x + z * z);
+		axes[1][2] = 2.0f * (y * z + x * w);
+		axes[2][0] = 2.0f * (x * z + y * w);
+		axes[2][1] = 2.0f * (y * z - x * w);
+		axes[2][2] = 1.0f - 2.0f * (x * x + y * y);
+	}
+
+	// A is the query box, B the batch entry; everything is expressed in A's frame.
+	bool OBBHit(const OBBShape& a, const OBBBatch& batch, size_t e)
+	{
+		float R[3][3], AbsR[3][3], t[3];
+		const float b[3] = { batch.extents[0][e], batch.extents[1][e], batch.extents[2][e] };
+		const float d[3] = { batch.centre[0][e] - a.centre[0], batch.centre[1][e] - a.centre[1], batch.centre[2][e] - a.centre[2] };
+
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				R[i][j] = a.axes[i][0] * batch.axes[j][0][e] + a.axes[i][1] * batch.axes[j][1][e] + a.axes[i][2] * batch.axes[j][2][e];
+				AbsR[i][j] = std::fabs(R[i][j]) + AxisEpsilon;
+			}
+
+			t[i] = d[0] * a.axes[i][0] + d[1] * a.axes[i][1] + d[2] * a.axes[i][2];
+		}
+
+		// A's face axes
+		for (int i = 0; i < 3; i++)
+		{
+			if (std::fabs(t[i]) > a.extents[i] + (b[0] * AbsR[i][0] + b[1] * AbsR[i][1] + b[2] * AbsR[i][2]))
+			{
+				return false;
+			}
+		}
+
+		// B's face axes
+		for (int j = 0; j < 3; j++)
+		{
+			const float ra = a.extents[0] * AbsR[0][j] + a.extents[1] * AbsR[1][j] + a.extents[2] * AbsR[2][j];
+
+			if (std::fabs(t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j]) > ra + b[j])
+			{
+				return false;
+			}
+		}
+
+		// Edge cross products A_i x B_j
+		for (int i = 0; i < 3; i++)
+		{
+			const int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+
+			for (int j = 0; j < 3; j++)
+			{
+				const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+				const float ra = a.extents[i1] * AbsR[i2][j] + a.extents[i2] * AbsR[i1][j];
+				const float rb = b[j1] * AbsR[i][j2] + b[j2] * AbsR[i][j1];
+
+				if (std::fabs(t[i2] * R[i1][j] - t[i1] * R[i2][j]) > ra + rb)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+#if COLLISION_BATCH_X86
+	COLLISION_BATCH_TARGET_SSE2 inline __m128 Abs4(__m128 x)
+	{
+		return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+	}
+
+	COLLISION_BATCH_TARGET_SSE2 int SphereHits4(const float centre[3], float radius, const SphereBatch& batch, size_t e)
+	{
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&batch.centre[0][e]), _mm_set1_ps(centre[0]));
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&batch.centre[1][e]), _mm_set1_ps(centre[1]));
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(&batch.centre[2][e]), _mm_set1_ps(centre[2]));
+		const __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		const __m128 radiusSum = _mm_add_ps(_mm_set1_ps(radius), _mm_loadu_ps(&batch.radius[e]));
+
+		return _mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_mul_ps(radiusSum, radiusSum)));
+	}
+
+	COLLISION_BATCH_TARGET_SSE2 int OBBHits4(const OBBShape& a, const OBBBatch& batch, size_t e)
+	{
+		__m128 R[3][3], AbsR[3][3], t[3], b[3], d[3];
+		const __m128 epsilon = _mm_set1_ps(AxisEpsilon);
+
+		for (int k = 0; k < 3; k++)
+		{
+			b[k] = _mm_loadu_ps(&batch.extents[k][e]);
+			d[k] = _mm_sub_ps(_mm_loadu_ps(&batch.centre[k][e]), _mm_set1_ps(a.centre[k]));
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				R[i][j] = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(a.axes[i][0]), _mm_loadu_ps(&batch.axes[j][0][e])),
+					_mm_mul_ps(_mm_set1_ps(a.axes[i][1]), _mm_loadu_ps(&batch.axes[j][1][e]))),
+					_mm_mul_ps(_mm_set1_ps(a.axes[i][2]), _mm_loadu_ps(&batch.axes[j][2][e])));
+				AbsR[i][j] = _mm_add_ps(Abs4(R[i][j]), epsilon);
+			}
+
+			t[i] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0], _mm_set1_ps(a.axes[i][0])), _mm_mul_ps(d[1], _mm_set1_ps(a.axes[i][1]))),
+				_mm_mul_ps(d[2], _mm_set1_ps(a.axes[i][2])));
+		}
+
+		__m128 separated = _mm_setzero_ps();
+
+		// A's face axes
+		for (int i = 0; i < 3; i++)
+		{
+			const __m128 rb = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b[0], AbsR[i][0]), _mm_mul_ps(b[1], AbsR[i][1])), _mm_mul_ps(b[2], AbsR[i][2]));
+			separated = _mm_or_ps(separated, _mm_cmpgt_ps(Abs4(t[i]), _mm_add_ps(_mm_set1_ps(a.extents[i]), rb)));
+		}
+
+		// B's face axes
+		for (int j = 0; j < 3; j++)
+		{
+			const __m128 ra = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.extents[0]), AbsR[0][j]), _mm_mul_ps(_mm_set1_ps(a.extents[1]), AbsR[1][j])),
+				_mm_mul_ps(_mm_set1_ps(a.extents[2]), AbsR[2][j]));
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(t[0], R[0][j]), _mm_mul_ps(t[1], R[1][j])), _mm_mul_ps(t[2], R[2][j]));
+			separated = _mm_or_ps(separated, _mm_cmpgt_ps(Abs4(distance), _mm_add_ps(ra, b[j])));
+		}
+
+		if (_mm_movemask_ps(separated) == 0xF)
+		{
+			return 0;
+		}
+
+		// Edge cross products A_i x B_j
+		for (int i = 0; i < 3; i++)
+		{
+			const int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+
+			for (int j = 0; j < 3; j++)
+			{
+				const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+				const __m128 ra = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.extents[i1]), AbsR[i2][j]), _mm_mul_ps(_mm_set1_ps(a.extents[i2]), AbsR[i1][j]));
+				const __m128 rb = _mm_add_ps(_mm_mul_ps(b[j1], AbsR[i][j2]), _mm_mul_ps(b[j2], AbsR[i][j1]));
+				const __m128 distance = _mm_sub_ps(_mm_mul_ps(t[i2], R[i1][j]), _mm_mul_ps(t[i1], R[i2][j]));
+				separated = _mm_or_ps(separated, _mm_cmpgt_ps(Abs4(distance), _mm_add_ps(ra, rb)));
+			}
+		}
+
+		return ~_mm_movemask_ps(separated) & 0xF;
+	}
+
+	COLLISION_BATCH_TARGET_AVX inline __m256 Abs8(__m256 x)
+	{
+		return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+	}
+
+	COLLISION_BATCH_TARGET_AVX int SphereHits8(const float centre[3], float radius, const SphereBatch& batch, size_t e)
+	{
+		const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&batch.centre[0][e]), _mm256_set1_ps(centre[0]));
+		const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&batch.centre[1][e]), _mm256_set1_ps(centre[1]));
+		const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&batch.centre[2][e]), _mm256_set1_ps(centre[2]));
+		const __m256 distanceSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		const __m256 radiusSum = _mm256_add_ps(_mm256_set1_ps(radius), _mm256_loadu_ps(&batch.radius[e]));
+
+		return _mm256_movemask_ps(_mm256_cmp_ps(distanceSquared, _mm256_mul_ps(radiusSum, radiusSum), _CMP_LE_OQ));
+	}
+
+	COLLISION_BATCH_TARGET_AVX int OBBHits8(const OBBShape& a, const OBBBatch& batch, size_t e)
+	{
+		__m256 R[3][3], AbsR[3][3], t[3], b[3], d[3];
+		const __m256 epsilon = _mm256_set1_ps(AxisEpsilon);
+
+		for (int k = 0; k < 3; k++)
+		{
+			b[k] = _mm256_loadu_ps(&batch.extents[k][e]);
+			d[k] = _mm256_sub_ps(_mm256_loadu_ps(&batch.centre[k][e]), _mm256_set1_ps(a.centre[k]));
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 3; j++)
+			{
+				R[i][j] = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_set1_ps(a.axes[i][0]), _mm256_loadu_ps(&batch.axes[j][0][e])),
+					_mm256_mul_ps(_mm256_set1_ps(a.axes[i][1]), _mm256_loadu_ps(&batch.axes[j][1][e]))),
+					_mm256_mul_ps(_mm256_set1_ps(a.axes[i][2]), _mm256_loadu_ps(&batch.axes[j][2][e])));
+				AbsR[i][j] = _mm256_add_ps(Abs8(R[i][j]), epsilon);
+			}
+
+			t[i] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(d[0], _mm256_set1_ps(a.axes[i][0])), _mm256_mul_ps(d[1], _mm256_set1_ps(a.axes[i][1]))),
+				_mm256_mul_ps(d[2], _mm256_set1_ps(a.axes[i][2])));
+		}
+
+		__m256 separated = _mm256_setzero_ps();
+
+		// A's face axes
+		for (int i = 0; i < 3; i++)
+		{
+			const __m256 rb = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b[0], AbsR[i][0]), _mm256_mul_ps(b[1], AbsR[i][1])), _mm256_mul_ps(b[2], AbsR[i][2]));
+			separated = _mm256_or_ps(separated, _mm256_cmp_ps(Abs8(t[i]), _mm256_add_ps(_mm256_set1_ps(a.extents[i]), rb), _CMP_GT_OQ));
+		}
+
+		// B's face axes
+		for (int j = 0; j < 3; j++)
+		{
+			const __m256 ra = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a.extents[0]), AbsR[0][j]), _mm256_mul_ps(_mm256_set1_ps(a.extents[1]), AbsR[1][j])),
+				_mm256_mul_ps(_mm256_set1_ps(a.extents[2]), AbsR[2][j]));
+			const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(t[0], R[0][j]), _mm256_mul_ps(t[1], R[1][j])), _mm256_mul_ps(t[2], R[2][j]));
+			separated = _mm256_or_ps(separated, _mm256_cmp_ps(Abs8(distance), _mm256_add_ps(ra, b[j]), _CMP_GT_OQ));
+		}
+
+		if (_mm256_movemask_ps(separated) == 0xFF)
+		{
+			return 0;
+		}
+
+		// Edge cross products A_i x B_j
+		for (int i = 0; i < 3; i++)
+		{
+			const int i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+
+			for (int j = 0; j < 3; j++)
+			{
+				const int j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+				const __m256 ra = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a.extents[i1]), AbsR[i2][j]), _mm256_mul_ps(_mm256_set1_ps(a.extents[i2]), AbsR[i1][j]));
+				const __m256 rb = _mm256_add_ps(_mm256_mul_ps(b[j1], AbsR[i][j2]), _mm256_mul_ps(b[j2], AbsR[i][j1]));
+				const __m256 distance = _mm256_sub_ps(_mm256_mul_ps(t[i2], R[i1][j]), _mm256_mul_ps(t[i1], R[i2][j]));
+				separated = _mm256_or_ps(separated, _mm256_cmp_ps(Abs8(distance), _mm256_add_ps(ra, rb), _CMP_GT_OQ));
+			}
+		}
+
+		return ~_mm256_movemask_ps(separated) & 0xFF;
+	}
+#endif
+}
+
+namespace Utils
+{
+	namespace Collision
+	{
+		BatchKernel GetBestBatchKernel()
+		{
+#if COLLISION_BATCH_X86
+			static const BatchKernel bestKernel = CpuFeatures::HasAVX() ? BatchKernel::AVX : BatchKernel::SSE2;
+			return bestKernel;
+#else
+			return BatchKernel::Scalar;
+#endif
+		}
+
+		const char* GetBatchKernelName(BatchKernel kernel)
+		{
+			switch (kernel)
+			{
+			case BatchKernel::SSE2: return "SSE2";
+			case BatchKernel::AVX:  return "AVX";
+			default:                return "Scalar";
+			}
+		}
+
+		void SphereBatch::clear()
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				centre[k].clear();
+			}
+			radius.clear();
+			count = 0;
+		}
+
+		void SphereBatch::Add(const float sphereCentre[3], float sphereRadius)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				Append(centre[k], count, sphereCentre[k]);
+			}
+			Append(radius, count, sphereRadius);
+			count++;
+		}
+
+		void OBBBatch::clear()
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				centre[k].clear();
+				extents[k].clear();
+
+				for (int component = 0; component < 3; component++)
+				{
+					axes[k][component].clear();
+				}
+			}
+			count = 0;
+		}
+
+		void OBBBatch::Add(const OBBShape& obb)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				Append(centre[k], count, obb.centre[k]);
+				Append(extents[k], count, obb.extents[k]);
+
+				for (int component = 0; component < 3; component++)
+				{
+					Append(axes[k][component], count, obb.axes[k][component]);
+				}
+			}
+			count++;
+		}
+
+		void SphereSphereBatch(BatchKernel kernel, const float centre[3], float radius, const SphereBatch& batch,
+			std::vector<uint32_t>& hitMasks)
+		{
+			PrepareMasks(batch.count, hitMasks);
+
+#if COLLISION_BATCH_X86
+			if (kernel == BatchKernel::AVX)
+			{
+				for (size_t e = 0; e < batch.count; e += 8)
+				{
+					hitMasks[e / 32] |= static_cast<uint32_t>(SphereHits8(centre, radius, batch, e)) << (e % 32);
+				}
+				ClearPaddingBits(batch.count, hitMasks);
+				return;
+			}
+
+			if (kernel == BatchKernel::SSE2)
+			{
+				for (size_t e = 0; e < batch.count; e += 4)
+				{
+					hitMasks[e / 32] |= static_cast<uint32_t>(SphereHits4(centre, radius, batch, e)) << (e % 32);
+				}
+				ClearPaddingBits(batch.count, hitMasks);
+				return;
+			}
+#endif
+
+			for (size_t e = 0; e < batch.count; e++)
+			{
+				if (SphereHit(centre, radius, batch, e))
+				{
+					hitMasks[e / 32] |= 1u << (e % 32);
+				}
+			}
+		}
+
+		void OBBOBBBatch(BatchKernel kernel, const OBBShape& obb, const OBBBatch& batch, std::vector<uint32_t>& hitMasks)
+		{
+			PrepareMasks(batch.count, hitMasks);
+
+#if COLLISION_BATCH_X86
+			if (kernel == BatchKernel::AVX)
+			{
+				for (size_t e = 0; e < batch.count; e += 8)
+				{
+					hitMasks[e / 32] |= static_cast<uint32_t>(OBBHits8(obb, batch, e)) << (e % 32);
+				}
+				ClearPaddingBits(batch.count, hitMasks);
+				return;
+			}
+
+			if (kernel == BatchKernel::SSE2)
+			{
+				for (size_t e = 0; e < batch.count; e += 4)
+				{
+					hitMasks[e / 32] |= static_cast<uint32_t>(OBBHits4(obb, batch, e)) << (e % 32);
+				}
+				ClearPaddingBits(batch.count, hitMasks);
+				return;
+			}
+#endif
+
+			for (size_t e = 0; e < batch.count; e++)
+			{
+				if (OBBHit(obb, batch, e))
+				{
+					hitMasks[e / 32] |= 1u << (e % 32);
+				}
+			}
+		}
+
+		size_t CountBatchKernelMismatches(int trials, int batchSize)
+		{
+			std::vector<BatchKernel> kernels;
+#if COLLISION_BATCH_X86
+			kernels.push_back(BatchKernel::SSE2);
+			if (CpuFeatures::HasAVX())
+			{
+				kernels.push_back(BatchKernel::AVX);
+			}
+#endif
+
+			// Fixed seed so a mismatch can be reproduced
+			std::mt19937 engine(505);
+			std::uniform_real_distribution<float> position(-8.0f, 8.0f);
+			std::uniform_real_distribution<float> size(0.25f, 2.0f);
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+			std::uniform_real_distribution<float> contact(0.999f, 1.001f);
+
+			const auto randomOBB = [&]()
+			{
+				OBBShape obb;
+				float q[4] = { unit(engine), unit(engine), unit(engine), unit(engine) };
+				const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+				for (int k = 0; k < 4; k++)
+				{
+					q[k] = length > 0.0f ? q[k] / length : (k == 3 ? 1.0f : 0.0f);
+				}
+
+				for (int k = 0; k < 3; k++)
+				{
+					obb.centre[k] = position(engine);
+					obb.extents[k] = size(engine);
+				}
+				QuaternionAxes(q, obb.axes);
+				return obb;
+			};
+
+			size_t mismatches = 0;
+			SphereBatch spheres;
+			OBBBatch obbs;
+			std::vector<uint32_t> expected, actual;
+
+			for (int trial = 0; trial < trials; trial++)
+			{
+				// Vary the count so the last lane group is partly padding
+				const int count = batchSize + trial % 8;
+
+				float centre[3] = { position(engine), position(engine), position(engine) };
+				const float radius = size(engine);
+				const OBBShape query = randomOBB();
+
+				spheres.clear();
+				obbs.clear();
+
+				for (int i = 0; i < count; i++)
+				{
+					float otherCentre[3] = { position(engine), position(engine), position(engine) };
+					const float otherRadius = size(engine);
+
+					// Every other sphere is moved to within 0.1% of touching the query sphere
+					if (i % 2 == 0)
+					{
+						const float d[3] = { otherCentre[0] - centre[0], otherCentre[1] - centre[1], otherCentre[2] - centre[2] };
+						const float distance = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+						const float scale = distance > 0.0f ? (radius + otherRadius) * contact(engine) / distance : 0.0f;
+						for (int k = 0; k < 3; k++)
+						{
+							otherCentre[k] = centre[k] + d[k] * scale;
+						}
+					}
+
+					spheres.Add(otherCentre, otherRadius);
+					obbs.Add(randomOBB());
+				}
+
+				SphereSphereBatch(BatchKernel::Scalar, centre, radius, spheres, expected);
+				for (const BatchKernel kernel : kernels)
+				{
+					SphereSphereBatch(kernel, centre, radius, spheres, actual);
+					for (int i = 0; i < count; i++)
+					{
+						mismatches += IsHit(expected, i) != IsHit(actual, i) ? 1 : 0;
+					}
+				}
+
+				OBBOBBBatch(BatchKernel::Scalar, query, obbs, expected);
+				for (const BatchKernel kernel : kernels)
+				{
+					OBBOBBBatch(kernel, query, obbs, actual);
+					for (int i = 0; i < count; i++)
+					{
+						mismatches += IsHit(expected, i) != IsHit(actual, i) ? 1 : 0;
+					}
+				}
+			}
+
+			return mismatches;
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Narrow-phase tests of one sphere or OBB against packed batches, with SSE2 and AVX kernels that
+// return the same hits as the scalar one.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Utils
+{
+	namespace Collision
+	{
+		enum class BatchKernel
+		{
+			Scalar,
+			SSE2,
+			AVX
+		};
+
+		// Widest kernel the current CPU supports.
+		BatchKernel GetBestBatchKernel();
+		const char* GetBatchKernelName(BatchKernel kernel);
+
+		// Arrays are padded with zeros to a multiple of 8 so the kernels can always load whole lanes.
+		struct SphereBatch
+		{
+			std::vector<float> centre[3];
+			std::vector<float> radius;
+			size_t count = 0;
+
+			void clear();
+			void Add(const float sphereCentre[3], float sphereRadius);
+		};
+
+		struct OBBShape
+		{
+			float centre[3];
+			float extents[3];	// half sizes along each axis
+			float axes[3][3];	// unit axes, axes[i][component]
+		};
+
+		struct OBBBatch
+		{
+			std::vector<float> centre[3];
+			std::vector<float> extents[3];
+			std::vector<float> axes[3][3];
+			size_t count = 0;
+
+			void clear();
+			void Add(const OBBShape& obb);
+		};
+
+		// hitMasks is resized to (batch.count + 31) / 32 words; bits past the count are zero.
+		void SphereSphereBatch(BatchKernel kernel, const float centre[3], float radius, const SphereBatch& batch,
+			std::vector<uint32_t>& hitMasks);
+		void OBBOBBBatch(BatchKernel kernel, const OBBShape& obb, const OBBBatch& batch, std::vector<uint32_t>& hitMasks);
+
+		// Randomised check of the SSE2 and AVX kernels (those the CPU supports) against the scalar
+		// kernel, including near-touching pairs and partial last lanes. Returns the number of entries
+		// where any kernel's hit differs from the scalar one; anything but 0 is a kernel bug.
+		size_t CountBatchKernelMismatches(int trials, int batchSize);
+
+		inline bool IsHit(const std::vector<uint32_t>& hitMasks, size_t entry)
+		{
+			return (hitMasks[entry / 32] >> (entry % 32) & 1u) != 0;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Runtime detection of the x86 instruction sets the SIMD kernels dispatch on.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+namespace CpuFeatures
+{
+	// AVX instructions are available and the OS saves YMM state across context switches.
+	inline bool HasAVX()
+	{
+#if CPU_FEATURES_X86 && defined(_MSC_VER)
+		static const bool hasAVX = []()
+		{
+			int info[4];
+			__cpuid(info, 1);
+
+			// The OS must save YMM state (OSXSAVE + XCR0 bits 1 and 2) for AVX to be usable.
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+		}();
+		return hasAVX;
+#elif CPU_FEATURES_X86
+		static const bool hasAVX = __builtin_cpu_supports("avx") != 0;
+		return hasAVX;
+#else
+		return false;
+#endif
+	}
+
+	// AVX2 instructions are available, which implies HasAVX().
+	inline bool HasAVX2()
+	{
+#if CPU_FEATURES_X86 && defined(_MSC_VER)
+		static const bool hasAVX2 = []()
+		{
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7 || !HasAVX())
+			{
+				return false;
+			}
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+		}();
+		return hasAVX2;
+#elif CPU_FEATURES_X86
+		static const bool hasAVX2 = __builtin_cpu_supports("avx2") != 0;
+		return hasAVX2;
+#else
+		return false;
+#endif
+	}
+}
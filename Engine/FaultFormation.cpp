@@ -0,0 +1,158 @@
+#include "FaultFormation.h"
+#include "ParallelFor.h"
+#include "WorldGenContext.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Clamps a fractional texel position to [0, width] before converting, so huge or infinite
+	// crossings of nearly row-parallel faults stay in range.
+	inline int ClampToRow(double x, int width)
+	{
+		return static_cast<int>(std::max(0.0, std::min(x, static_cast<double>(width))));
+	}
+}
+
+FaultFormation::FaultFormation()
+{
+}
+
+void FaultFormation::Generate(float* heights, int width, int height, const Settings& settings, RandomStream& random)
+{
+	if (!heights || width <= 0 || height <= 0 || settings.faultCount <= 0)
+	{
+		return;
+	}
+
+	const float maxX = static_cast<float>(width);
+	const float maxZ = static_cast<float>(height);
+	const int faultCount = settings.faultCount;
+
+	m_faults.resize(faultCount);
+	for (int fault = 0; fault < faultCount; fault++)
+	{
+		// Random fault line through two points
+		const float pointX1 = random.NextFloat(0.0f, maxX);
+		const float pointZ1 = random.NextFloat(0.0f, maxZ);
+		const float pointX2 = random.NextFloat(0.0f, maxX);
+		const float pointZ2 = random.NextFloat(0.0f, maxZ);
+
+		Fault& line = m_faults[fault];
+		line.a = pointZ1 - pointZ2;
+		line.b = pointX2 - pointX1;
+		line.c = pointX1 * pointZ2 - pointX2 * pointZ1;
+
+		const float progress = faultCount > 1 ? static_cast<float>(fault) / (faultCount - 1) : 0.0f;
+		const double displacement = settings.initialDisplacement + (settings.finalDisplacement - settings.initialDisplacement) * progress;
+
+		if (line.a != 0.0f)
+		{
+			line.firstDisplacement = line.a > 0.0f ? -displacement : displacement;
+			line.crossingPerRow = -static_cast<double>(line.b) / line.a;
+			line.crossingOffset = -static_cast<double>(line.c) / line.a;
+
+			// The blend reaches +-1 at falloffWidth texels from the line, measured perpendicular to it
+			const double length = std::sqrt(static_cast<double>(line.a) * line.a + static_cast<double>(line.b) * line.b);
+			line.rampHalfWidth = std::max(0.0f, settings.falloffWidth) * length / std::fabs(line.a);
+		}
+		else
+		{
+			// Parallel to the rows: each row lies wholly on one side, decided per row below
+			line.firstDisplacement = displacement;
+			line.crossingPerRow = 0.0;
+			line.crossingOffset = 0.0;
+			line.rampHalfWidth = std::max(0.0f, settings.falloffWidth) * std::fabs(line.b);
+		}
+	}
+
+	ParallelFor(0, height, [&](int rowBegin, int rowEnd)
+	{
+		std::vector<double> constantDeltas(width + 1);
+		std::vector<double> slopeDeltas(width + 1);
+
+		for (int z = rowBegin; z < rowEnd; z++)
+		{
+			std::fill(constantDeltas.begin(), constantDeltas.end(), 0.0);
+			std::fill(slopeDeltas.begin(), slopeDeltas.end(), 0.0);
+
+			AccumulateRow(z, width, constantDeltas, slopeDeltas);
+
+			float* row = heights + static_cast<size_t>(z) * width;
+			double constant = 0.0;
+			double slope = 0.0;
+			for (int x = 0; x < width; x++)
+			{
+				constant += constantDeltas[x];
+				slope += slopeDeltas[x];
+				row[x] += static_cast<float>(constant + slope * x);
+			}
+		}
+	}, DefaultMinRowsPerThread);
+}
+
+void FaultFormation::AccumulateRow(int z, int width, std::vector<double>& constantDeltas, std::vector<double>& slopeDeltas) const
+{
+	// Each fault adds its first value from x = 0 and changes it where the row crosses the fault,
+	// so only the deltas at x = 0 and at the crossing are written. Deltas at x = width are never read.
+	const float rowZ = static_cast<float>(z);
+	double rowStart = 0.0;
+
+	for (const Fault& fault : m_faults)
+	{
+		const double first = fault.firstDisplacement;
+
+		if (fault.a == 0.0f)
+		{
+			const float distance = fault.b * rowZ + fault.c;
+			if (fault.rampHalfWidth > 0.0)
+			{
+				rowStart += first * std::max(-1.0, std::min(distance / fault.rampHalfWidth, 1.0));
+			}
+			else
+			{
+				rowStart += distance > 0.0f ? first : -first;
+			}
+			continue;
+		}
+
+		const double crossing = fault.crossingPerRow * rowZ + fault.crossingOffset;
+		rowStart += first;
+
+		if (fault.rampHalfWidth == 0.0)
+		{
+			// Same expression as a per-texel test, so each texel lands on the same side. The test
+			// is monotonic along the row, so start from the exact crossing and step until it agrees.
+			const bool raisedFirst = fault.a < 0.0f;
+			const auto raised = [&](int x)
+			{
+				return (fault.a * static_cast<float>(x) + fault.b * rowZ + fault.c) > 0.0f;
+			};
+
+			int split = ClampToRow(std::floor(crossing) + 1.0, width);
+			while (split > 0 && raised(split - 1) != raisedFirst)
+			{
+				split--;
+			}
+			while (split < width && raised(split) == raisedFirst)
+			{
+				split++;
+			}
+
+			constantDeltas[split] -= 2.0 * first;
+			continue;
+		}
+
+		// Blended: a linear ramp from first to -first over the texels within the ramp
+		const double slope = -first / fault.rampHalfWidth;
+		const int rampBegin = ClampToRow(std::ceil(crossing - fault.rampHalfWidth), width);
+		const int rampEnd = ClampToRow(std::floor(crossing + fault.rampHalfWidth) + 1.0, width);
+
+		constantDeltas[rampBegin] += -slope * crossing - first;
+		slopeDeltas[rampBegin] += slope;
+		constantDeltas[rampEnd] += slope * crossing - first;
+		slopeDeltas[rampEnd] -= slope;
+	}
+
+	constantDeltas[0] += rowStart;
+}
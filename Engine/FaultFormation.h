@@ -0,0 +1,44 @@
+#pragma once
+
+// Fault formation on a row-major heightfield, summed per row with difference arrays.
+
+#include <vector>
+
+class RandomStream;
+
+class FaultFormation
+{
+public:
+	struct Settings
+	{
+		int faultCount = 1000;
+		float initialDisplacement = 0.1f;	// height change of the first fault
+		float finalDisplacement = 0.1f;		// of the last; faults in between interpolate linearly
+		float falloffWidth = 0.0f;			// texels either side of a fault to blend over, 0 for a hard step
+	};
+
+public:
+	FaultFormation();
+
+	// Adds settings.faultCount faults to the heights. Fault lines are drawn from random in order
+	// (four floats per fault), so the result depends only on the stream's state.
+	void Generate(float* heights, int width, int height, const Settings& settings, RandomStream& random);
+
+private:
+	struct Fault
+	{
+		// A * x + B * z + C > 0 on the raised side, as drawn
+		float a, b, c;
+		// Displacement of the texels at the start of every row (lowered if A > 0, raised if A < 0)
+		double firstDisplacement;
+		// x where the line, or the middle of the ramp, crosses row z: crossingPerRow * z + crossingOffset
+		double crossingPerRow, crossingOffset;
+		// Half width of the ramp in x along a row, 0 for a hard step
+		double rampHalfWidth;
+	};
+
+	void AccumulateRow(int z, int width, std::vector<double>& constantDeltas, std::vector<double>& slopeDeltas) const;
+
+private:
+	std::vector<Fault> m_faults;
+};
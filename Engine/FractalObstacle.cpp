@@ -3,64 +3,68 @@
 
 FractalObstacle::FractalObstacle(ID3D11Device* device, const DirectX::SimpleMath::Vector3& startPosition,
     const float angle, const float segmentLength)
-    : m_device(device)
+    : m_device(device),
+    m_turtle(&startPosition.x, angle, segmentLength, SegmentThickness)
 {
-    currentState.position = startPosition;
-    currentState.direction = DirectX::SimpleMath::Vector3::UnitY; // Initial growth direction
-    currentState.segmentLength = segmentLength;
-    currentState.angle = angle; // Degrees
 }
 
 void FractalObstacle::Generate(const LSystem& lsystem)
 {
-    const std::string& lstring = lsystem.GetCurrentString();
+    // Walk the final generation symbol by symbol without ever building the string.
+    // The turtle caches each segment's world matrix as it goes, so nothing is rebuilt per frame.
+    LSystem::Expansion expansion = lsystem.Expand();
+    char symbols[256];
+    size_t count;
 
-    for (char c : lstring)
+    while ((count = expansion.Read(symbols, sizeof(symbols))) > 0)
     {
-        switch (c)
-        {
-            case 'F':
-            { // Draw segment
-                Segment segment;
-                segment.position = currentState.position;
+        m_turtle.Interpret(symbols, count);
+    }
 
-                // Calculate rotation from direction (example for Y-axis alignment)
-                float pitch = atan2(currentState.direction.z, currentState.direction.y) * 180.0f / XM_PI;
-                segment.rotation = DirectX::SimpleMath::Vector3(pitch, 0.0f, 0.0f);
+    m_collisionTree.Build(m_turtle.GetSegments(), SegmentRadius);
+    CreateInstanceBuffer();
+}
 
-                segment.length = currentState.segmentLength; // Store the current length
-                m_segments.push_back(segment);
+void FractalObstacle::Render(ID3D11DeviceContext* deviceContext, ModelClass& segmentModel)
+{
+    if (!m_instanceBuffer)
+    {
+        return;
+    }
 
-                currentState.position += currentState.direction * currentState.segmentLength;
+    segmentModel.RenderInstanced(deviceContext, m_instanceBuffer.Get(), sizeof(SegmentInstance),
+        static_cast<unsigned int>(m_turtle.GetSegments().size()));
+}
 
-                break;
-            }
-            case '+': // Turn right
-                currentState.direction = DirectX::SimpleMath::Vector3::Transform
-                (
-                    currentState.direction,
-                    DirectX::SimpleMath::Matrix::CreateRotationZ(DirectX::XMConvertToRadians(currentState.angle))
-                );
+bool FractalObstacle::CreateInstanceBuffer()
+{
+    m_instanceBuffer.Reset();
 
-                break;
-            case '-': // Turn left
-                currentState.direction = DirectX::SimpleMath::Vector3::Transform
-                (
-                    currentState.direction,
-                    DirectX::SimpleMath::Matrix::CreateRotationZ(DirectX::XMConvertToRadians(-currentState.angle))
-                );
+    const std::vector<SegmentInstance>& instances = m_turtle.GetSegments().world;
 
-                break;
-            case '[': // Save state
-                stateStack.push(currentState);
-                currentState.segmentLength *= 0.8f; // Shrink branches
+    if (instances.empty())
+    {
+        return false;
+    }
+
+    D3D11_BUFFER_DESC instanceBufferDesc;
+    instanceBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    instanceBufferDesc.ByteWidth = static_cast<UINT>(sizeof(SegmentInstance) * instances.size());
+    instanceBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    instanceBufferDesc.CPUAccessFlags = 0;
+    instanceBufferDesc.MiscFlags = 0;
+    instanceBufferDesc.StructureByteStride = 0;
 
-                break;
-            case ']': // Restore state
-                currentState = stateStack.top();
-                stateStack.pop();
+    D3D11_SUBRESOURCE_DATA instanceData;
+    instanceData.pSysMem = instances.data();
+    instanceData.SysMemPitch = 0;
+    instanceData.SysMemSlicePitch = 0;
 
-                break;
-        }
+    HRESULT result = m_device->CreateBuffer(&instanceBufferDesc, &instanceData, m_instanceBuffer.ReleaseAndGetAddressOf());
+    if (FAILED(result))
+    {
+        return false;
     }
-}
\ No newline at end of file
+
+    return true;
+}
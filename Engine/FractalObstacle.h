@@ -1,35 +1,37 @@
 #pragma once
 #include "ModelClass.h"
 #include "LSystem.h"
-#include <stack>
-
-struct TurtleState
-{
-    DirectX::SimpleMath::Vector3 position;
-    DirectX::SimpleMath::Vector3 direction;
-    float segmentLength;
-    float angle;
-};
-
-struct Segment
-{
-    DirectX::SimpleMath::Vector3 position;
-    DirectX::SimpleMath::Vector3 rotation;
-    float length;
-};
+#include "Turtle.h"
+#include "SegmentBVH.h"
 
 class FractalObstacle
 {
+public:
+    // X/Z scale applied to the segment model; Y is scaled by the segment length.
+    static constexpr float SegmentThickness = 0.2f;
+    // X/Z size of the segment model (and the baked cross-section) before SegmentThickness.
+    static constexpr float SegmentCrossSection = 0.2f;
+    // Half the drawn width of a segment, so collisions match what is rendered.
+    static constexpr float SegmentRadius = 0.5f * SegmentCrossSection * SegmentThickness;
+
 public:
     FractalObstacle(ID3D11Device* device, const DirectX::SimpleMath::Vector3& startPosition, 
         const float angle, const float segmentLength);
+    // Interprets the expansion and bakes the segments into the instance buffer.
     void Generate(const LSystem& lsystem);
-    const std::vector<Segment>& GetSegments() const { return m_segments; }
-    void Render(ID3D11DeviceContext* deviceContext);
+    // Segments in structure-of-arrays form, each with its cached world matrix.
+    const SegmentList& GetSegments() const { return m_turtle.GetSegments(); }
+    // Segments as capsules of radius SegmentRadius, built once by Generate.
+    const SegmentBVH& GetCollisionTree() const { return m_collisionTree; }
+    // Draws every segment with one instanced draw of segmentModel; expects the instanced shader enabled.
+    void Render(ID3D11DeviceContext* deviceContext, ModelClass& segmentModel);
+
+private:
+    bool CreateInstanceBuffer();
 
 private:
     ID3D11Device* m_device;
-    std::vector<Segment> m_segments;
-    std::stack<TurtleState> stateStack;
-    TurtleState currentState;
+    Turtle m_turtle;
+    SegmentBVH m_collisionTree;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> m_instanceBuffer;
 };
\ No newline at end of file
@@ -6,8 +6,10 @@
 #include "Game.h"
 
 #include "Utils.h"
+#include "Benchmarks.h"
 #include "LSystem.h"
 #include "FractalObstacle.h"
+#include "ObstacleBaker.h"
 
 //toreorganise
 #include <fstream>
@@ -41,6 +43,14 @@ Game::~Game()
 // Initialize the Direct3D resources required to run.
 void Game::Initialize(HWND window, int width, int height)
 {
+#ifdef _DEBUG
+    // Drone collisions go through the widest batch kernel, which must agree with the scalar one hit for hit.
+    if (Utils::Collision::CountBatchKernelMismatches(64, 256) != 0)
+    {
+        throw std::exception("Collision batch kernels disagree with the scalar kernel");
+    }
+
+#endif
     m_deviceResources->RegisterDeviceNotify(shared_from_this());
 
 	m_input.Initialise(window);
@@ -82,8 +92,9 @@ void Game::Initialize(HWND window, int width, int height)
 	m_Camera01.setPosition(m_cameraPosition);
 	m_Camera01.setRotation(m_cameraRotation);	//orientation is -90 becuase zero will be looking up at the sky straight up. 
 
-	m_Terrain.GeneratePerlinNoiseTerrain(m_deviceResources->GetD3DDevice(), 10.0f, 5);
-    m_Terrain.GenerateVoronoiRegions(m_deviceResources->GetD3DDevice(), 5);
+    // The world seed determines the terrain, regions, objects and obstacles.
+    m_worldSeed = static_cast<unsigned int>(std::time(nullptr));
+    m_Terrain.GenerateWorld(m_deviceResources->GetD3DDevice(), GetWorldSettings());
 
     ChangeTargetRegion();
 
@@ -339,13 +350,16 @@ void Game::RenderScene(ID3D11DeviceContext* context)
 
     m_BasicShaderPair.EnableShader(context);
     m_BasicShaderPair.SetShaderParameters(context, &m_world, &m_view, &m_projection, &m_Light, m_texture1.Get());
-    m_Terrain.Render(context);
+    // No tint: the terrain is coloured by its vertices
+    m_BasicShaderPair.SetMaterialColour(context, Vector4::Zero);
+    m_Terrain.Render(context, m_world, m_view, m_projection, m_Camera01.getPosition());
 
     // Render drone
     SimpleMath::Matrix droneWorldMatrix = m_Drone.GetWorldMatrix();
 
     m_BasicShaderPair.EnableShader(context);
     m_BasicShaderPair.SetShaderParameters(context, &droneWorldMatrix, &m_view, &m_projection, &m_Drone_Light, m_texture2.Get());
+    m_BasicShaderPair.SetMaterialColour(context, m_Drone.GetColourVector());
     m_Drone.Render(context);
 
     RenderObjectsAtRandomLocations(context);
@@ -479,11 +493,12 @@ void Game::CreateDeviceDependentResources()
     m_Terrain.SetTranslation(m_terrainTranslation);
 
 	//setup our test model
-    m_Drone.InitializeModel(device,"drone.obj", true);
-    m_ObstacleModel.InitializeBox(device, 0.2f, 1.0f, 0.2f);
+    m_Drone.InitializeModel(device,"drone.obj");
+    m_ObstacleModel.InitializeBox(device, FractalObstacle::SegmentCrossSection, 1.0f, FractalObstacle::SegmentCrossSection);
 
 	//load and set up our Vertex and Pixel Shaders
 	m_BasicShaderPair.InitStandard(device, L"light_vs.cso", L"light_ps.cso");
+	m_InstancedShaderPair.InitStandard(device, L"light_instanced_vs.cso", L"light_ps.cso", false, true);
 
     CreatePostProcessResources();
 
@@ -604,6 +619,11 @@ void Game::SetupImGUI()
 		ImGui::Separator();
 	}
 
+	const auto& terrainSelection = m_Terrain.GetSelection();
+	ImGui::Text("Terrain Chunks: %d drawn, %d culled, %d triangles",
+		terrainSelection.visibleTiles, terrainSelection.culledTiles, terrainSelection.triangleCount);
+	ImGui::SliderFloat("Terrain LOD Distance", m_Terrain.GetLodDistance(), 8.0f, 512.0f);
+
 	ImGui::Text("Sin Wave Parameters");
 	ImGui::SliderFloat("Wave Amplitude",	m_Terrain.GetAmplitude(), 0.0f, 10.0f);
 	ImGui::SliderFloat("Wavelength",		m_Terrain.GetWavelength(), 0.0f, 1.0f);
@@ -634,19 +654,71 @@ void Game::SetupImGUI()
         m_Terrain.SetRandomSeed(static_cast<unsigned int>(manualSeed));
     }
 
+    if (ImGui::Button("Generate World From Seed"))
+    {
+        m_worldSeed = static_cast<unsigned int>(manualSeed);
+        RestartScene();
+    }
+
+    ImGui::Text("World Seed: %u (cache hits %d, misses %d)", m_worldSeed,
+        m_Terrain.GetWorldCache().GetHitCount(), m_Terrain.GetWorldCache().GetMissCount());
+
+    // Local brush under the drone; only the touched terrain tiles are updated
+    static float brushRadius = 6.0f;
+    static float brushStrength = 1.0f;
+    ImGui::SliderFloat("Brush Radius", &brushRadius, 1.0f, 30.0f);
+    ImGui::SliderFloat("Brush Strength", &brushStrength, -5.0f, 5.0f);
+
+    if (ImGui::Button("Apply Brush At Drone"))
+    {
+        const auto& droneLocalPosition = m_Drone.GetLocalPosition();
+        m_Terrain.ApplyBrush(m_deviceResources->GetD3DDevice(),
+            droneLocalPosition.x, droneLocalPosition.z, brushRadius, brushStrength);
+    }
+
     // Smoothing controls
     static float smoothingIntensity = 0.5f;
+    static int smoothingIterations = 1;
     ImGui::SliderFloat("Smoothing Intensity", &smoothingIntensity, 0.0f, 1.0f);
+    ImGui::SliderInt("Smoothing Iterations", &smoothingIterations, 1, 64);
     ImGui::Text("Press 'S' to smooth terrain");
 
     if (ImGui::Button("Smooth Terrain"))
     {
-        m_Terrain.SmoothTerrain(m_deviceResources->GetD3DDevice(), smoothingIntensity);
+        m_Terrain.SmoothTerrain(m_deviceResources->GetD3DDevice(), smoothingIntensity, smoothingIterations);
     }
 
+    static float blurSigma = 1.0f;
+    ImGui::SliderFloat("Blur Sigma", &blurSigma, 0.5f, 8.0f);
+
+    if (ImGui::Button("Gaussian Blur Terrain"))
+    {
+        m_Terrain.BlurTerrain(m_deviceResources->GetD3DDevice(), blurSigma);
+    }
+
+    // Thermal erosion: slopes steeper than the talus slump onto their lower neighbours
+    static float thermalTalus = 0.05f;
+    static float thermalRate = 0.5f;
+    static int thermalIterations = 50;
+    ImGui::SliderFloat("Talus", &thermalTalus, 0.0f, 1.0f);
+    ImGui::SliderFloat("Thermal Rate", &thermalRate, 0.0f, 1.0f);
+    ImGui::SliderInt("Thermal Iterations", &thermalIterations, 1, 500);
+
+    if (ImGui::Button("Thermal Erosion"))
+    {
+        m_Terrain.ApplyThermalErosion(m_deviceResources->GetD3DDevice(), thermalTalus, thermalRate, thermalIterations);
+    }
+
+    // Fault formation: displacement shrinks from the first fault to the last, blended across the falloff
+    static FaultFormation::Settings faultFormation;
+    ImGui::SliderInt("Fault Count", &faultFormation.faultCount, 100, 20000);
+    ImGui::SliderFloat("Initial Fault Displacement", &faultFormation.initialDisplacement, 0.0f, 0.5f);
+    ImGui::SliderFloat("Final Fault Displacement", &faultFormation.finalDisplacement, 0.0f, 0.5f);
+    ImGui::SliderFloat("Fault Falloff Width", &faultFormation.falloffWidth, 0.0f, 32.0f);
+
     if (ImGui::Button("Fault Terrain"))
     {
-        m_Terrain.GenerateFaultTerrain(m_deviceResources->GetD3DDevice());
+        m_Terrain.GenerateFaultTerrain(m_deviceResources->GetD3DDevice(), faultFormation);
     }
 
     if (ImGui::Button("Particle Deposition Terrain"))
@@ -654,6 +726,22 @@ void Game::SetupImGUI()
         m_Terrain.GenerateParticleDepositionTerrain(m_deviceResources->GetD3DDevice());
     }
 
+    // Hydraulic erosion: droplets, or the shallow water grid
+    static HydraulicErosion::DropletSettings dropletErosion;
+    static HydraulicErosion::GridSettings gridErosion;
+    ImGui::SliderInt("Erosion Droplets", &dropletErosion.dropletCount, 1000, 200000);
+    ImGui::SliderInt("Shallow Water Steps", &gridErosion.iterations, 10, 1000);
+
+    if (ImGui::Button("Hydraulic Erosion (Droplets)"))
+    {
+        m_Terrain.ErodeHydraulicDroplets(m_deviceResources->GetD3DDevice(), dropletErosion);
+    }
+
+    if (ImGui::Button("Hydraulic Erosion (Shallow Water)"))
+    {
+        m_Terrain.ErodeHydraulicGrid(m_deviceResources->GetD3DDevice(), gridErosion);
+    }
+
     ImGui::Dummy(ImVec2(0.0f, 10.0f));
 
     static float perlinNoiseScale = 10.0f;
@@ -669,6 +757,28 @@ void Game::SetupImGUI()
 
     ImGui::Dummy(ImVec2(0.0f, 10.0f));
 
+    // Obstacle rendering: instanced segments, or static meshes baked per obstacle or per region colour
+    int obstacleRenderMode = static_cast<int>(m_obstacleRenderMode);
+    bool rebakeObstacles = false;
+
+    rebakeObstacles |= ImGui::RadioButton("Instanced Obstacles", &obstacleRenderMode, static_cast<int>(ObstacleRenderMode::INSTANCED));
+    rebakeObstacles |= ImGui::RadioButton("Baked Per Obstacle", &obstacleRenderMode, static_cast<int>(ObstacleRenderMode::BAKED_PER_OBSTACLE));
+    rebakeObstacles |= ImGui::RadioButton("Baked Per Region", &obstacleRenderMode, static_cast<int>(ObstacleRenderMode::BAKED_PER_REGION));
+    rebakeObstacles |= ImGui::Checkbox("Bake Cylinders", &m_bakeObstacleCylinders);
+
+    if (rebakeObstacles)
+    {
+        m_obstacleRenderMode = static_cast<ObstacleRenderMode>(obstacleRenderMode);
+        BakeFractalObstacles();
+    }
+
+    if (m_obstacleRenderMode != ObstacleRenderMode::INSTANCED)
+    {
+        ImGui::Text("Baked Obstacle Meshes: %d", static_cast<int>(m_bakedObstacleModels.size()));
+    }
+
+    ImGui::Dummy(ImVec2(0.0f, 10.0f));
+
     static int numVoronoiRegions = 5;
     ImGui::SliderInt("Number of Voronoi Regions", &numVoronoiRegions, 1, 20);
 
@@ -677,11 +787,203 @@ void Game::SetupImGUI()
         m_Terrain.GenerateVoronoiRegions(m_deviceResources->GetD3DDevice(), numVoronoiRegions);
     }
 
+#ifdef _DEBUG
+    ImGui::Dummy(ImVec2(0.0f, 10.0f));
+
+    SetupBenchmarksImGUI();
+#endif
+
 	ImGui::End();
 
     SetupPostProcessImGUI();
 }
 
+#ifdef _DEBUG
+void Game::SetupBenchmarksImGUI()
+{
+    // Benchmarks run synchronously and can take seconds, so they stay out of release builds and start collapsed.
+    if (!ImGui::CollapsingHeader("Benchmarks"))
+    {
+        return;
+    }
+
+    static std::vector<Benchmarks::FbmResult> perlinNoiseBenchmark;
+
+    if (ImGui::Button("Benchmark Perlin Noise (1024x1024)"))
+    {
+        perlinNoiseBenchmark = Benchmarks::RunFbmNoise(1024, 1024, 8);
+    }
+
+    if (!perlinNoiseBenchmark.empty())
+    {
+        ImGui::Text("Kernel: %s", PerlinNoise::GetKernelName(PerlinNoise::GetBestKernel()));
+
+        for (const auto& result : perlinNoiseBenchmark)
+        {
+            ImGui::Text("%d octaves: scalar %.1f, SIMD %.1f, parallel %.1f Mtexels/s%s",
+                result.octaves,
+                result.scalarMTexelsPerSecond,
+                result.simdMTexelsPerSecond,
+                result.parallelMTexelsPerSecond,
+                result.bitIdentical ? "" : " (MISMATCH)");
+        }
+    }
+
+    static std::vector<Benchmarks::LSystemResult> lsystemBenchmark;
+
+    if (ImGui::Button("Benchmark L-System (CRYSTALS rule)"))
+    {
+        lsystemBenchmark = Benchmarks::RunLSystem("F", { {'F', "FF+[+F-F-F]-[-F+F+F]"} }, 6);
+    }
+
+    for (const auto& result : lsystemBenchmark)
+    {
+        ImGui::Text("%d iterations (%zu symbols): naive %.1f, engine %.1f Msymbols/s%s",
+            result.iterations,
+            result.symbols,
+            result.naiveMSymbolsPerSecond,
+            result.engineMSymbolsPerSecond,
+            result.identical ? "" : " (MISMATCH)");
+    }
+
+    static Benchmarks::MeshResult meshBenchmark = {};
+
+    if (ImGui::Button("Benchmark Mesh Optimizer (drone.obj)"))
+    {
+        meshBenchmark = Benchmarks::RunMeshOptimizer("drone.obj");
+    }
+
+    if (meshBenchmark.loaded)
+    {
+        ImGui::Text("%zu triangles, %zu -> %zu vertices, ACMR %.3f -> %.3f, %.2f ms",
+            meshBenchmark.triangles,
+            meshBenchmark.verticesBefore,
+            meshBenchmark.verticesAfter,
+            meshBenchmark.acmrBefore,
+            meshBenchmark.acmrAfter,
+            meshBenchmark.optimiseMilliseconds);
+    }
+
+    static std::vector<Benchmarks::SpatialHashResult> spatialHashBenchmark;
+
+    if (ImGui::Button("Benchmark Collision Broad-Phase"))
+    {
+        spatialHashBenchmark.clear();
+        for (const int objectCount : { 100, 1000, 10000 })
+        {
+            spatialHashBenchmark.push_back(Benchmarks::RunSpatialHash(objectCount));
+        }
+    }
+
+    for (const auto& result : spatialHashBenchmark)
+    {
+        ImGui::Text("%d objects (%zu pairs): spatial hash %.3f ms, brute force %.3f ms%s",
+            result.objects,
+            result.pairs,
+            result.hashMilliseconds,
+            result.bruteForceMilliseconds,
+            result.identical ? "" : " (MISMATCH)");
+    }
+
+    static std::vector<Utils::Collision::BatchValidationResult> collisionBatchValidation;
+
+    if (ImGui::Button("Validate Collision Batch Kernels"))
+    {
+        collisionBatchValidation = Utils::Collision::ValidateBatchKernels(256, 256);
+    }
+
+    for (const auto& result : collisionBatchValidation)
+    {
+        ImGui::Text("%s: %zu pairs, %zu/%zu mismatches, %.1f ns/pair batched, %.1f ns/pair pairwise",
+            Utils::Collision::GetBatchKernelName(result.kernel),
+            result.pairs,
+            result.sphereMismatches,
+            result.obbMismatches,
+            result.batchNanosecondsPerPair,
+            result.pairwiseNanosecondsPerPair);
+    }
+
+    static std::vector<Benchmarks::SegmentBVHResult> segmentBVHBenchmark;
+
+    if (ImGui::Button("Benchmark Obstacle BVH (CRYSTALS rule)"))
+    {
+        segmentBVHBenchmark = Benchmarks::RunSegmentBVH(4);
+    }
+
+    for (const auto& result : segmentBVHBenchmark)
+    {
+        ImGui::Text("%d iterations (%zu segments, %zu nodes, depth %d): build %.2f ms, %.1f/%.1f segments tested, BVH %.2f us, brute force %.2f us%s",
+            result.iterations,
+            result.segments,
+            result.nodes,
+            result.depth,
+            result.buildMilliseconds,
+            result.sphereSegmentsTested,
+            result.raySegmentsTested,
+            result.bvhMicroseconds,
+            result.bruteForceMicroseconds,
+            result.identical ? "" : " (MISMATCH)");
+    }
+
+    static Benchmarks::ErosionResult erosionBenchmark = {};
+
+    if (ImGui::Button("Benchmark Hydraulic Erosion (1024^2, 1M droplets)"))
+    {
+        erosionBenchmark = Benchmarks::RunHydraulicErosion(1024, 1000000, 50);
+    }
+
+    if (erosionBenchmark.droplets > 0)
+    {
+        ImGui::Text("%d droplets on %d^2: %.2f s (%.2f Mdroplets/s), shallow water %.1f ms/step, mean change %.3f%s",
+            erosionBenchmark.droplets,
+            erosionBenchmark.size,
+            erosionBenchmark.dropletSeconds,
+            erosionBenchmark.mDropletsPerSecond,
+            erosionBenchmark.gridMillisecondsPerIteration,
+            erosionBenchmark.meanHeightChange,
+            erosionBenchmark.deterministic ? "" : " (NOT DETERMINISTIC)");
+    }
+
+    static Benchmarks::HeightFilterResult heightFilterBenchmark = {};
+
+    if (ImGui::Button("Benchmark Smoothing/Thermal Erosion (2048^2, 8 iterations)"))
+    {
+        heightFilterBenchmark = Benchmarks::RunHeightFilters(2048, 8);
+    }
+
+    if (heightFilterBenchmark.size > 0)
+    {
+        ImGui::Text("%d^2, per iteration: smooth %.2f ms (was %.2f ms), gaussian %.2f ms, thermal %.2f ms, mass drift %.1e%s",
+            heightFilterBenchmark.size,
+            heightFilterBenchmark.smoothMilliseconds,
+            heightFilterBenchmark.naiveSmoothMilliseconds,
+            heightFilterBenchmark.gaussianMilliseconds,
+            heightFilterBenchmark.thermalMilliseconds,
+            heightFilterBenchmark.thermalMassDrift,
+            heightFilterBenchmark.fusedMatchesStepped ? "" : " (FUSED MISMATCH)");
+    }
+
+    static Benchmarks::FaultResult faultBenchmark = {};
+
+    if (ImGui::Button("Benchmark Fault Formation (1024^2, 10k faults)"))
+    {
+        faultBenchmark = Benchmarks::RunFaultFormation(1024, 10000);
+    }
+
+    if (faultBenchmark.faults > 0)
+    {
+        ImGui::Text("%d faults on %d^2: %.1f ms (falloff %.1f ms), per-texel loop ~%.0f ms, max difference %.1e over %d faults",
+            faultBenchmark.faults,
+            faultBenchmark.size,
+            faultBenchmark.sweepMilliseconds,
+            faultBenchmark.falloffMilliseconds,
+            faultBenchmark.naiveMilliseconds,
+            faultBenchmark.maxDifference,
+            faultBenchmark.referenceFaults);
+    }
+}
+#endif
+
 void Game::SetupPostProcessImGUI()
 {
     ImGui::Begin("Post-Processing Effects");
@@ -734,7 +1036,7 @@ void Game::SetupDrone()
     m_Drone.SetPosition(dronePosition); // Set the drone position
     m_Drone.UpdateBoundingSphere();
 
-    m_Drone.ChangeColour(m_deviceResources->GetD3DDevice(), m_targetRegionColour, m_targetRegionColourVector);
+    m_Drone.ChangeColour(m_targetRegionColour, m_targetRegionColourVector);
 }
 
 void Game::UpdateDroneMovement()
@@ -840,14 +1142,22 @@ void Game::UpdateCameraMovement()
         }
     }
 
-    // Update camera position
+    // Update camera position, unless the move would push the drone into an obstacle.
+    // A drone already inside one (e.g. after regeneration) may always move, so it can get out.
     Vector3 cameraPosition = m_Camera01.getPosition();
+    const Vector3 droneOffset = Vector3(0, -0.5f, -1.0f);
+
+    if (IsDroneBlockedByObstacles(cameraPosition + cameraMovement + droneOffset) &&
+        !IsDroneBlockedByObstacles(cameraPosition + droneOffset))
+    {
+        cameraMovement = Vector3::Zero;
+    }
+
     cameraPosition += cameraMovement;
     m_Camera01.setPosition(cameraPosition);
 
     // Update drone position relative to camera
-    Vector3 dronePosition = cameraPosition +
-        Vector3(0, -0.5f, -1.0f);  // Fixed offset
+    Vector3 dronePosition = cameraPosition + droneOffset;
 
     m_Drone.SetPosition(dronePosition);
 }
@@ -871,8 +1181,7 @@ void Game::CheckDroneRegionProgress(const float localX, const float localZ)
 
 void Game::HandleTargetRegionReached(const Enums::COLOUR& regionColour)
 {
-    m_Drone.ChangeColour(m_deviceResources->GetD3DDevice(),
-        regionColour,
+    m_Drone.ChangeColour(regionColour,
         m_Terrain.GetVoronoiRegionColourVector(regionColour));
 }
 
@@ -910,6 +1219,8 @@ void Game::InitializeRegionRules()
 
 void Game::GenerateFractalObstacles()
 {
+    RandomStream& random = m_Terrain.GetWorldGenContext().GetStream(WorldGenContext::Stream::Placement);
+
     for (const auto& region : m_Terrain.GetVoronoiRegions())
     {
         // Find the rule matching the region's colour
@@ -921,72 +1232,156 @@ void Game::GenerateFractalObstacles()
             }
 
             // Randomize parameters for variety
-            const float angle = 25.0f + (rand() % 20); // 2545
-            const float segmentLength = 1.5f + (rand() % 3); // 1.54.5 units
+            const float angle = 25.0f + random.NextInt(0, 19); // 2545
+            const float segmentLength = 1.5f + random.NextInt(0, 2); // 1.54.5 units
 
+            // The obstacle streams the expansion, so the string is never generated.
             LSystem lsystem(rule.axiom, rule.rules, rule.iterations);
-            lsystem.Generate();
 
             FractalObstacle obstacle
             (
                 m_deviceResources->GetD3DDevice(),
-                region.position, // Spawn at region's seed point
+                Vector3(region.position.x, region.position.y, region.position.z), // Spawn at region's seed point
                 angle,
                 segmentLength
             );
 
             obstacle.Generate(lsystem);
             m_fractalObstacles.push_back(obstacle);
+            m_fractalObstacleRegionColours.push_back(region.colour);
 
             break;
         }
     }
+
+    BakeFractalObstacles();
 }
 
-void Game::RenderFractalObstacles(ID3D11DeviceContext* context)
+void Game::BakeFractalObstacles()
 {
-    for (const auto& obstacle : m_fractalObstacles)
+    for (auto& model : m_bakedObstacleModels)
     {
-        for (const auto& segment : obstacle.GetSegments())
+        model->Shutdown();
+    }
+
+    m_bakedObstacleModels.clear();
+
+    if (m_obstacleRenderMode == ObstacleRenderMode::INSTANCED)
+    {
+        return;
+    }
+
+    // Group the obstacles: one mesh each, or one per region colour.
+    std::vector<std::vector<ObstacleBakeInput>> groups;
+    std::vector<Enums::COLOUR> groupColours;
+
+    for (size_t i = 0; i < m_fractalObstacles.size(); i++)
+    {
+        size_t group = groups.size();
+
+        if (m_obstacleRenderMode == ObstacleRenderMode::BAKED_PER_REGION)
         {
-            Matrix scale = Matrix::CreateScale(0.2f, segment.length, 0.2f); // Scale Y-axis by segment length
-            Matrix rotation = Matrix::CreateFromYawPitchRoll(
-                XMConvertToRadians(segment.rotation.y),
-                XMConvertToRadians(segment.rotation.x),
-                XMConvertToRadians(segment.rotation.z)
-            );
-            Matrix translation = Matrix::CreateTranslation(segment.position);
+            group = std::find(groupColours.begin(), groupColours.end(), m_fractalObstacleRegionColours[i]) - groupColours.begin();
+        }
+
+        if (group == groups.size())
+        {
+            groups.emplace_back();
+            groupColours.push_back(m_fractalObstacleRegionColours[i]);
+        }
+
+        // Black leaves the texture untinted, as with the instanced segments.
+        ObstacleBakeInput input = { &m_fractalObstacles[i].GetSegments(), nullptr, { 0.0f, 0.0f, 0.0f, 0.0f } };
+        groups[group].push_back(input);
+    }
+
+    ObstacleBaker baker;
+    baker.SetShape(m_bakeObstacleCylinders ? ObstacleBaker::Shape::Cylinder : ObstacleBaker::Shape::Box, FractalObstacle::SegmentCrossSection);
 
-            Matrix world = scale * rotation * translation;
+    std::vector<BakedMesh> meshes;
+    baker.Bake(groups, meshes);
+
+    static_assert(sizeof(BakedVertex) == sizeof(ModelClass::VertexType), "Baked vertices must match ModelClass::VertexType");
+
+    for (const auto& mesh : meshes)
+    {
+        auto model = std::make_unique<ModelClass>();
 
-            m_BasicShaderPair.EnableShader(context);
-            m_BasicShaderPair.SetShaderParameters(context, &world, &m_view, &m_projection, &m_Light, m_texture2.Get());
-            m_ObstacleModel.Render(context);
+        if (model->InitializeMesh(m_deviceResources->GetD3DDevice(), mesh.vertices.data(), static_cast<int>(mesh.vertices.size()),
+            mesh.indices.data(), static_cast<int>(mesh.indices.size())))
+        {
+            m_bakedObstacleModels.push_back(std::move(model));
         }
     }
 }
 
+void Game::RenderFractalObstacles(ID3D11DeviceContext* context)
+{
+    if (m_fractalObstacles.empty())
+    {
+        return;
+    }
+
+    // Segment world matrices live in each obstacle's instance buffer, or are already baked
+    // into the merged meshes, so the shader and its constant buffers are set once.
+    Matrix world = Matrix::Identity;
+
+    if (m_obstacleRenderMode != ObstacleRenderMode::INSTANCED)
+    {
+        m_BasicShaderPair.EnableShader(context);
+        m_BasicShaderPair.SetShaderParameters(context, &world, &m_view, &m_projection, &m_Light, m_texture2.Get());
+        // No tint: baked obstacles carry their colours in their vertices
+        m_BasicShaderPair.SetMaterialColour(context, Vector4::Zero);
+
+        for (auto& model : m_bakedObstacleModels)
+        {
+            model->Render(context);
+        }
+
+        return;
+    }
+
+    m_InstancedShaderPair.EnableShader(context);
+    m_InstancedShaderPair.SetShaderParameters(context, &world, &m_view, &m_projection, &m_Light, m_texture2.Get());
+    m_InstancedShaderPair.SetMaterialColour(context, Vector4::Zero);
+
+    for (auto& obstacle : m_fractalObstacles)
+    {
+        obstacle.Render(context, m_ObstacleModel);
+    }
+}
+
 void Game::CreateObjectsVector(int count)
 {
     for (size_t i = 0; i < count; i++)
     {
-        const float randomScale = Utils::GetRandomFloat(0.1f, 0.5f);
+        auto model = std::make_unique<ModelClass>();
+
+        // Every object shares one drone mesh through the mesh registry.
+        model->InitializeModel(m_deviceResources->GetD3DDevice(), "drone.obj");
+
+        m_objects.push_back(std::move(model));
+    }
+
+    PlaceObjects();
+}
+
+void Game::PlaceObjects()
+{
+    // Scale, position and colour come from the world's placement stream, so each seed lays the objects out its own way.
+    for (auto& object : m_objects)
+    {
+        const float randomScale = m_Terrain.GetWorldGenContext().GetStream(WorldGenContext::Stream::Placement).NextFloat(0.1f, 0.5f);
         const auto randomPosition = m_Terrain.GetRandomPosition();
 
         const auto randomVoronoiRegionColour = m_Terrain.GetRandomVoronoiRegionColour();
 
-        auto model = std::make_unique<ModelClass>();
-
-        model->InitializeModel(m_deviceResources->GetD3DDevice(), "drone.obj", true);
-        model->ChangeColour(m_deviceResources->GetD3DDevice(),
-            randomVoronoiRegionColour,
+        object->ChangeColour(randomVoronoiRegionColour,
             m_Terrain.GetVoronoiRegionColourVector(randomVoronoiRegionColour));
 
-        model->SetPosition(randomPosition);
-        model->SetScale(Vector3(randomScale, randomScale, randomScale));
-        model->UpdateBoundingSphere();
-
-        m_objects.push_back(std::move(model));
+        object->SetPosition(randomPosition);
+        object->SetScale(Vector3(randomScale, randomScale, randomScale));
+        object->UpdateBoundingSphere();
     }
 }
 
@@ -1002,6 +1397,7 @@ void Game::RenderObjectsAtRandomLocations(ID3D11DeviceContext* context)
 
         m_BasicShaderPair.EnableShader(context);
         m_BasicShaderPair.SetShaderParameters(context, &object->GetWorldMatrix(), &m_view, &m_projection, &m_Light, m_texture2.Get());
+        m_BasicShaderPair.SetMaterialColour(context, object->GetColourVector());
         object->Render(context);
     }
 }
@@ -1056,9 +1452,63 @@ void Game::CheckDroneCollisions()
 {
     const auto droneColour = m_Drone.GetColour();
 
-    for each (auto& object in m_objects)
+    // Broad phase: bucket the objects' bounding spheres, sized to the average object.
+    float diameterSum = 0.0f;
+    m_collisionGrid.Clear();
+
+    for (const auto& object : m_objects)
+    {
+        const auto sphere = object->GetBoundingSphere();
+        const Vector3 boundsMin = sphere.center - Vector3(sphere.radius);
+        const Vector3 boundsMax = sphere.center + Vector3(sphere.radius);
+
+        m_collisionGrid.Add(&boundsMin.x, &boundsMax.x);
+        diameterSum += 2.0f * sphere.radius;
+    }
+
+    if (!m_objects.empty())
+    {
+        m_collisionGrid.SetCellSize(diameterSum / m_objects.size());
+    }
+
+    m_collisionGrid.Build();
+
+    const auto droneSphere = m_Drone.GetBoundingSphere();
+    const Vector3 droneMin = droneSphere.center - Vector3(droneSphere.radius);
+    const Vector3 droneMax = droneSphere.center + Vector3(droneSphere.radius);
+
+    m_collisionCandidates.clear();
+    m_collisionGrid.Query(&droneMin.x, &droneMax.x, m_collisionCandidates);
+
+    // Narrow phase on the candidates only: spheres then OBBs, tested in SIMD batches
+    m_objectCollisionHits.assign(m_objects.size(), 0);
+    m_candidateSpheres.clear();
+    m_candidateOBBs.clear();
+
+    for (const int candidate : m_collisionCandidates)
+    {
+        const auto sphere = m_objects[candidate]->GetBoundingSphere();
+        m_candidateSpheres.Add(&sphere.center.x, sphere.radius);
+        m_candidateOBBs.Add(Utils::Collision::ToOBBShape(m_objects[candidate]->GetOBB()));
+    }
+
+    const auto kernel = Utils::Collision::GetBestBatchKernel();
+    Utils::Collision::SphereSphereBatch(kernel, &droneSphere.center.x, droneSphere.radius, m_candidateSpheres, m_sphereHitMasks);
+    Utils::Collision::OBBOBBBatch(kernel, Utils::Collision::ToOBBShape(m_Drone.GetOBB()), m_candidateOBBs, m_obbHitMasks);
+
+    for (size_t i = 0; i < m_collisionCandidates.size(); i++)
+    {
+        if (Utils::Collision::IsHit(m_sphereHitMasks, i) && Utils::Collision::IsHit(m_obbHitMasks, i))
+        {
+            m_objectCollisionHits[m_collisionCandidates[i]] = 1;
+        }
+    }
+
+    for (size_t i = 0; i < m_objects.size(); i++)
     {
-        if (m_Drone.CheckCollision(*object))
+        auto& object = m_objects[i];
+
+        if (m_objectCollisionHits[i])
         {
             if (object->IsCollidingWithModel())
             {
@@ -1066,7 +1516,7 @@ void Game::CheckDroneCollisions()
             }
 
             object->SetCollidingWithModel(true);
-            object->ChangeColour(m_deviceResources->GetD3DDevice(), droneColour, m_Terrain.GetVoronoiRegionColourVector(droneColour));
+            object->ChangeColour(droneColour, m_Terrain.GetVoronoiRegionColourVector(droneColour));
         }
         else
         {
@@ -1075,17 +1525,38 @@ void Game::CheckDroneCollisions()
     }
 }
 
+bool Game::IsDroneBlockedByObstacles(const Vector3& dronePosition) const
+{
+    const float droneRadius = m_Drone.GetBoundingSphere().radius;
+
+    for (const auto& obstacle : m_fractalObstacles)
+    {
+        if (obstacle.GetCollisionTree().IntersectsSphere(&dronePosition.x, droneRadius))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void Game::CheckObjectColoursWithRegionColours()
 {
     matchedColourCount = 0;
 
-    for each (auto& object in m_objects)
+    // One batched raster lookup for every object
+    m_objectLocalPositions.clear();
+    for (const auto& object : m_objects)
     {
-        const auto objectPosition = object->GetLocalPosition();
-        const auto objectColour = object->GetColour();
-        const auto regionColour = m_Terrain.GetRegionColourAtPosition(objectPosition.x, objectPosition.z);
+        const auto& objectPosition = object->GetLocalPosition();
+        m_objectLocalPositions.push_back({ objectPosition.x, objectPosition.z });
+    }
+
+    m_Terrain.GetRegionColoursAtPositions(m_objectLocalPositions, m_objectRegionColours);
 
-        if (objectColour == regionColour)
+    for (size_t i = 0; i < m_objects.size(); i++)
+    {
+        if (m_objects[i]->GetColour() == m_objectRegionColours[i])
         {
             matchedColourCount++;
         }
@@ -1114,6 +1585,8 @@ bool Game::IsWin()
 
 void Game::OnWin()
 {
+    // Each level gets its own world; losing replays the same one.
+    m_worldSeed++;
     RestartScene();
     level++;
 }
@@ -1138,14 +1611,28 @@ void Game::CreatePostProcessResources()
     );
 }
 
+Heightfield::WorldSettings Game::GetWorldSettings() const
+{
+    return { m_worldSeed, 10.0f, 5, 5 };
+}
+
 void Game::RestartScene()
 {
-    m_Terrain.GeneratePerlinNoiseTerrain(m_deviceResources->GetD3DDevice(), 10.0f, 5);
-    m_Terrain.GenerateVoronoiRegions(m_deviceResources->GetD3DDevice(), 5);
+    m_Terrain.GenerateWorld(m_deviceResources->GetD3DDevice(), GetWorldSettings());
 
     ChangeTargetRegion();
 
-    m_Drone.ChangeColour(m_deviceResources->GetD3DDevice(), m_targetRegionColour, m_targetRegionColourVector);
+    // Same draw order as at startup, so a seed gives the same objects whether reached by restarting or not
+    PlaceObjects();
+
+    // Obstacles follow the new regions
+    m_regionRules.clear();
+    m_fractalObstacles.clear();
+    m_fractalObstacleRegionColours.clear();
+    InitializeRegionRules();
+    GenerateFractalObstacles();
+
+    m_Drone.ChangeColour(m_targetRegionColour, m_targetRegionColourVector);
 
     m_gameTimer.Restart();
 }
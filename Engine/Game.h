@@ -13,6 +13,8 @@
 #include "GameTimer.h"
 #include "Enums.h"
 #include "modelclass.h"
+#include "SpatialHash.h"
+#include "CollisionBatch.h"
 
 // Forward declarations to reduce header dependencies
 class FractalObstacle;
@@ -71,21 +73,25 @@ private:
     void CheckDroneRegionProgress(const float localX, const float localZ);
     void HandleTargetRegionReached(const Enums::COLOUR& regionColour);
     void RestartScene();
+    Heightfield::WorldSettings GetWorldSettings() const;
     void CheckWin();
     bool IsWin();
     void OnWin();
 
     // --- Object and Collision Management ---
     void CreateObjectsVector(int count);
+    void PlaceObjects();
     void CheckObjectCollisionWithTerrain(float& localPositionX, float& localPositionZ,
         DirectX::SimpleMath::Vector3& worldPosition, ModelClass& model,
         const bool isPlayer = false);
     void CheckDroneCollisions();
+    bool IsDroneBlockedByObstacles(const DirectX::SimpleMath::Vector3& dronePosition) const;
     void CheckObjectColoursWithRegionColours();
 
     // --- Procedural Generation ---
     void InitializeRegionRules();
     void GenerateFractalObstacles();
+    void BakeFractalObstacles();
 
     // --- Rendering Sub-systems ---
     void RenderScene(ID3D11DeviceContext* context);
@@ -100,6 +106,9 @@ private:
     void RenderWithoutPostProcess();
     void CreatePostProcessResources();
     void SetupPostProcessImGUI();
+#ifdef _DEBUG
+    void SetupBenchmarksImGUI();
+#endif
 
     // --- Private Member Variables ---
 
@@ -119,6 +128,7 @@ private:
 
     // Shaders and Textures
     Shader                                   m_BasicShaderPair;
+    Shader                                   m_InstancedShaderPair;
     Shader                                   m_PostProcessShader;
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_texture1;
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_texture2;
@@ -128,7 +138,22 @@ private:
     ModelClass                               m_Drone;
     ModelClass                               m_ObstacleModel;
     std::vector<std::unique_ptr<ModelClass>> m_objects;
+    std::vector<Heightfield::Float2>         m_objectLocalPositions;
+    std::vector<Enums::COLOUR>               m_objectRegionColours;
     std::vector<FractalObstacle>             m_fractalObstacles;
+    std::vector<Enums::COLOUR>               m_fractalObstacleRegionColours;
+    std::vector<std::unique_ptr<ModelClass>> m_bakedObstacleModels;
+
+    // Collision broad-phase, rebuilt every frame from the objects' bounding spheres
+    SpatialHash                              m_collisionGrid;
+    std::vector<int>                         m_collisionCandidates;
+    std::vector<unsigned char>               m_objectCollisionHits;
+
+    // Narrow phase: the candidates packed for the batch sphere and OBB tests
+    Utils::Collision::SphereBatch            m_candidateSpheres;
+    Utils::Collision::OBBBatch               m_candidateOBBs;
+    std::vector<uint32_t>                    m_sphereHitMasks;
+    std::vector<uint32_t>                    m_obbHitMasks;
 
     // Lights
     Light                                    m_Light;
@@ -148,6 +173,7 @@ private:
     GameTimer                                m_gameTimer;
     bool                                     m_isTimerPaused = false;
     int                                      level = 1;
+    unsigned int                             m_worldSeed = 0;
     int                                      matchedColourCount = 0;
 
     // UI and Input State
@@ -157,6 +183,9 @@ private:
 
     // Procedural Generation State
     enum class ObstacleType { SPIKES, CRYSTALS, VINES };
+    enum class ObstacleRenderMode { INSTANCED, BAKED_PER_OBSTACLE, BAKED_PER_REGION };
+    ObstacleRenderMode                       m_obstacleRenderMode = ObstacleRenderMode::INSTANCED;
+    bool                                     m_bakeObstacleCylinders = false;
     struct RegionRule
     {
         Enums::COLOUR regionColour;
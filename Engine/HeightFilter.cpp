@@ -0,0 +1,356 @@
+#include "HeightFilter.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const float Sqrt2 = 1.41421356f;
+
+	// Material moved from a neighbour whose height differs by difference: positive flows in,
+	// negative flows out, zero while the slope is within the talus. Antisymmetric, so every pair
+	// of texels exchanges exactly what the other loses.
+	// Written without branches so the row loop vectorises.
+	inline float ThermalFlow(float difference, float talus)
+	{
+		const float excess = std::fabs(difference) - talus;
+		return std::copysign(excess > 0.0f ? excess : 0.0f, difference);
+	}
+
+	// One output row of the 8-neighbour smoothing filter.
+	void SmoothRow(const float* up, const float* middle, const float* down, float* target, float* columnSums,
+		int width, float smoothFactor)
+	{
+		const float keep = 1.0f - smoothFactor;
+
+		for (int x = 0; x < width; x++)
+		{
+			columnSums[x] = up[x] + middle[x] + down[x];
+		}
+
+		target[0] = middle[0];
+		for (int x = 1; x < width - 1; x++)
+		{
+			const float average = (columnSums[x - 1] + columnSums[x] + columnSums[x + 1] - middle[x]) * 0.125f;
+			target[x] = middle[x] * keep + average * smoothFactor;
+		}
+		target[width - 1] = middle[width - 1];
+	}
+
+	// Horizontal pass of a separable filter, edges clamped.
+	void FilterRowHorizontal(const float* source, float* target, int width, const float* weights, int radius)
+	{
+		const int interiorBegin = std::min(radius, width);
+		const int interiorEnd = std::max(interiorBegin, width - radius);
+
+		for (int x = 0; x < interiorBegin; x++)
+		{
+			float sum = 0.0f;
+			for (int tap = -radius; tap <= radius; tap++)
+			{
+				sum += weights[tap + radius] * source[std::min(std::max(x + tap, 0), width - 1)];
+			}
+			target[x] = sum;
+		}
+
+		for (int x = interiorBegin; x < interiorEnd; x++)
+		{
+			target[x] = weights[0] * source[x - radius];
+		}
+		for (int tap = 1; tap <= 2 * radius; tap++)
+		{
+			const float weight = weights[tap];
+			const float* tapSource = source + tap - radius;
+			for (int x = interiorBegin; x < interiorEnd; x++)
+			{
+				target[x] += weight * tapSource[x];
+			}
+		}
+
+		for (int x = interiorEnd; x < width; x++)
+		{
+			float sum = 0.0f;
+			for (int tap = -radius; tap <= radius; tap++)
+			{
+				sum += weights[tap + radius] * source[std::min(std::max(x + tap, 0), width - 1)];
+			}
+			target[x] = sum;
+		}
+	}
+
+	// Thermal flow into one texel from its 8 neighbours; x - 1 and x + 1 must be inside the row.
+	inline float ThermalInflow(const float* up, const float* middle, const float* down, int left, int x, int right,
+		float talus, float diagonalTalus)
+	{
+		const float centre = middle[x];
+
+		const float orthogonal =
+			ThermalFlow(up[x] - centre, talus) +
+			ThermalFlow(middle[left] - centre, talus) +
+			ThermalFlow(middle[right] - centre, talus) +
+			ThermalFlow(down[x] - centre, talus);
+
+		const float diagonal =
+			ThermalFlow(up[left] - centre, diagonalTalus) +
+			ThermalFlow(up[right] - centre, diagonalTalus) +
+			ThermalFlow(down[left] - centre, diagonalTalus) +
+			ThermalFlow(down[right] - centre, diagonalTalus);
+
+		return orthogonal + diagonal;
+	}
+
+	// One output row of thermal erosion. Neighbours past the map edge are clamped onto the texel
+	// itself, so no material flows across the edge.
+	void ThermalRow(const float* up, const float* middle, const float* down, float* target,
+		int width, float talus, float rate)
+	{
+		const float diagonalTalus = talus * Sqrt2;
+		const float scale = rate * 0.125f;
+
+		if (width == 1)
+		{
+			target[0] = middle[0] + scale * (ThermalFlow(up[0] - middle[0], talus) + ThermalFlow(down[0] - middle[0], talus));
+			return;
+		}
+
+		target[0] = middle[0] + scale * ThermalInflow(up, middle, down, 0, 0, 1, talus, diagonalTalus);
+
+		// Interior written out with fixed offsets, so every neighbour is a contiguous load.
+		for (int x = 1; x < width - 1; x++)
+		{
+			const float centre = middle[x];
+
+			const float orthogonal =
+				ThermalFlow(up[x] - centre, talus) +
+				ThermalFlow(middle[x - 1] - centre, talus) +
+				ThermalFlow(middle[x + 1] - centre, talus) +
+				ThermalFlow(down[x] - centre, talus);
+
+			const float diagonal =
+				ThermalFlow(up[x - 1] - centre, diagonalTalus) +
+				ThermalFlow(up[x + 1] - centre, diagonalTalus) +
+				ThermalFlow(down[x - 1] - centre, diagonalTalus) +
+				ThermalFlow(down[x + 1] - centre, diagonalTalus);
+
+			target[x] = centre + scale * (orthogonal + diagonal);
+		}
+		target[width - 1] = middle[width - 1] + scale * ThermalInflow(up, middle, down, width - 2, width - 1, width - 1, talus, diagonalTalus);
+	}
+}
+
+HeightFilter::HeightFilter()
+{
+	m_pass.kernel = Kernel::Smooth;
+	m_pass.radius = 1;
+	m_pass.smoothFactor = 0.0f;
+	m_pass.talus = 0.0f;
+	m_pass.rate = 0.0f;
+}
+
+void HeightFilter::Smooth(float* heights, int width, int height, float smoothFactor, int iterations)
+{
+	m_pass.kernel = Kernel::Smooth;
+	m_pass.radius = 1;
+	m_pass.smoothFactor = smoothFactor;
+
+	Run(heights, width, height, m_pass, iterations);
+}
+
+void HeightFilter::BoxBlur(float* heights, int width, int height, int radius, int iterations)
+{
+	if (radius <= 0)
+	{
+		return;
+	}
+
+	m_pass.kernel = Kernel::Separable;
+	m_pass.radius = radius;
+	m_pass.weights.assign(2 * radius + 1, 1.0f / (2 * radius + 1));
+
+	Run(heights, width, height, m_pass, iterations);
+}
+
+void HeightFilter::GaussianBlur(float* heights, int width, int height, float sigma, int iterations)
+{
+	if (sigma <= 0.0f)
+	{
+		return;
+	}
+
+	const int radius = std::max(1, static_cast<int>(std::ceil(sigma * 3.0f)));
+
+	m_pass.kernel = Kernel::Separable;
+	m_pass.radius = radius;
+	m_pass.weights.resize(2 * radius + 1);
+
+	float total = 0.0f;
+	for (int tap = -radius; tap <= radius; tap++)
+	{
+		const float weight = std::exp(-(tap * tap) / (2.0f * sigma * sigma));
+		m_pass.weights[tap + radius] = weight;
+		total += weight;
+	}
+	for (float& weight : m_pass.weights)
+	{
+		weight /= total;
+	}
+
+	Run(heights, width, height, m_pass, iterations);
+}
+
+void HeightFilter::ThermalErosion(float* heights, int width, int height, float talus, float rate, int iterations)
+{
+	m_pass.kernel = Kernel::Thermal;
+	m_pass.radius = 1;
+	m_pass.talus = std::max(0.0f, talus);
+	// Above 1 a texel can give away more than it has above its neighbours and start oscillating
+	m_pass.rate = std::min(std::max(rate, 0.0f), 1.0f);
+
+	Run(heights, width, height, m_pass, iterations);
+}
+
+void HeightFilter::Run(float* heights, int width, int height, const Pass& pass, int iterations)
+{
+	if (!heights || width <= 0 || height <= 0 || iterations <= 0)
+	{
+		return;
+	}
+
+	const int bandCount = std::max(1, std::min(GetWorkerThreadCount(), height / DefaultMinRowsPerThread));
+	if (static_cast<int>(m_bands.size()) < bandCount)
+	{
+		m_bands.resize(bandCount);
+	}
+
+	const int rowsPerBand = (height + bandCount - 1) / bandCount;
+
+	// A band's halo never grows past its own height, or the bands would mostly recompute each other.
+	const int maxFusedIterations = std::max(1, rowsPerBand / pass.radius);
+
+	for (int done = 0; done < iterations; )
+	{
+		const int fused = std::min(iterations - done, maxFusedIterations);
+
+		// Every band copies its rows and halo before any band writes back, so the write-back can go
+		// straight into the map.
+		ParallelFor(0, bandCount, [&](int firstBand, int lastBand)
+		{
+			for (int band = firstBand; band < lastBand; band++)
+			{
+				const int bandBegin = std::min(band * rowsPerBand, height);
+				const int bandEnd = std::min(bandBegin + rowsPerBand, height);
+				const int halo = fused * pass.radius;
+				const int localBegin = std::max(0, bandBegin - halo);
+				const int localEnd = std::min(height, bandEnd + halo);
+
+				BandScratch& scratch = m_bands[band];
+				const size_t localSize = static_cast<size_t>(localEnd - localBegin) * width;
+				if (scratch.source.size() < localSize)
+				{
+					scratch.source.resize(localSize);
+					scratch.target.resize(localSize);
+				}
+				if (static_cast<int>(scratch.temporary.size()) < width)
+				{
+					scratch.temporary.resize(width);
+				}
+
+				std::memcpy(scratch.source.data(), heights + static_cast<size_t>(localBegin) * width, localSize * sizeof(float));
+			}
+		});
+
+		ParallelFor(0, bandCount, [&](int firstBand, int lastBand)
+		{
+			for (int band = firstBand; band < lastBand; band++)
+			{
+				const int bandBegin = std::min(band * rowsPerBand, height);
+				const int bandEnd = std::min(bandBegin + rowsPerBand, height);
+				RunBand(heights, width, height, pass, fused, bandBegin, bandEnd, m_bands[band]);
+			}
+		});
+
+		done += fused;
+	}
+}
+
+void HeightFilter::RunBand(float* heights, int width, int height, const Pass& pass, int iterations,
+	int bandBegin, int bandEnd, BandScratch& scratch)
+{
+	if (bandBegin >= bandEnd)
+	{
+		return;
+	}
+
+	const int radius = pass.radius;
+	const int localBegin = std::max(0, bandBegin - iterations * radius);
+
+	// Rows are addressed in map coordinates; clamping to the map replicates the edge rows.
+	auto sourceRow = [&](int z) -> const float*
+	{
+		z = std::min(std::max(z, 0), height - 1);
+		return scratch.source.data() + static_cast<size_t>(z - localBegin) * width;
+	};
+
+	float* columnSums = scratch.temporary.data();
+
+	for (int iteration = 1; iteration <= iterations; iteration++)
+	{
+		// Rows still needed by the remaining iterations
+		const int remainingHalo = (iterations - iteration) * radius;
+		const int rowBegin = std::max(0, bandBegin - remainingHalo);
+		const int rowEnd = std::min(height, bandEnd + remainingHalo);
+
+		for (int z = rowBegin; z < rowEnd; z++)
+		{
+			float* target = scratch.target.data() + static_cast<size_t>(z - localBegin) * width;
+
+			switch (pass.kernel)
+			{
+			case Kernel::Smooth:
+				if (z == 0 || z == height - 1)
+				{
+					std::memcpy(target, sourceRow(z), width * sizeof(float));
+				}
+				else
+				{
+					SmoothRow(sourceRow(z - 1), sourceRow(z), sourceRow(z + 1), target, columnSums, width, pass.smoothFactor);
+				}
+				break;
+
+			case Kernel::Separable:
+			{
+				const float* weights = pass.weights.data();
+
+				const float* firstTap = sourceRow(z - radius);
+				for (int x = 0; x < width; x++)
+				{
+					columnSums[x] = weights[0] * firstTap[x];
+				}
+				for (int tap = 1; tap <= 2 * radius; tap++)
+				{
+					const float weight = weights[tap];
+					const float* tapRow = sourceRow(z + tap - radius);
+					for (int x = 0; x < width; x++)
+					{
+						columnSums[x] += weight * tapRow[x];
+					}
+				}
+
+				FilterRowHorizontal(columnSums, target, width, weights, radius);
+				break;
+			}
+
+			case Kernel::Thermal:
+				ThermalRow(sourceRow(z - 1), sourceRow(z), sourceRow(z + 1), target, width, pass.talus, pass.rate);
+				break;
+			}
+		}
+
+		scratch.source.swap(scratch.target);
+	}
+
+	std::memcpy(heights + static_cast<size_t>(bandBegin) * width,
+		scratch.source.data() + static_cast<size_t>(bandBegin - localBegin) * width,
+		static_cast<size_t>(bandEnd - bandBegin) * width * sizeof(float));
+}
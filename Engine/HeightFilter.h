@@ -0,0 +1,56 @@
+#pragma once
+
+// Smoothing, blurs and thermal erosion on a row-major height plane, run in row bands with halos.
+
+#include <vector>
+
+class HeightFilter
+{
+public:
+	HeightFilter();
+
+	// Blends every interior texel towards the mean of its 8 neighbours; border texels are kept.
+	void Smooth(float* heights, int width, int height, float smoothFactor, int iterations);
+
+	// Separable box blur of the given radius, edges clamped.
+	void BoxBlur(float* heights, int width, int height, int radius, int iterations);
+
+	// Separable Gaussian blur, truncated at 3 sigma, edges clamped.
+	void GaussianBlur(float* heights, int width, int height, float sigma, int iterations);
+
+	// Moves material to each of the 8 neighbours whose height difference exceeds the talus
+	// (per texel of distance), closing rate of the excess per iteration. Conserves total height.
+	void ThermalErosion(float* heights, int width, int height, float talus, float rate, int iterations);
+
+private:
+	enum class Kernel
+	{
+		Smooth,
+		Separable,
+		Thermal
+	};
+
+	struct Pass
+	{
+		Kernel kernel;
+		int radius;
+		std::vector<float> weights;		// separable taps, 2 * radius + 1
+		float smoothFactor;
+		float talus;
+		float rate;
+	};
+
+	struct BandScratch
+	{
+		std::vector<float> source, target;
+		std::vector<float> temporary;		// one row
+	};
+
+	void Run(float* heights, int width, int height, const Pass& pass, int iterations);
+	void RunBand(float* heights, int width, int height, const Pass& pass, int iterations,
+		int bandBegin, int bandEnd, BandScratch& scratch);
+
+private:
+	Pass m_pass;
+	std::vector<BandScratch> m_bands;
+};
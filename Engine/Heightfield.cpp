@@ -0,0 +1,789 @@
+#include "Heightfield.h"
+#include "ParallelFor.h"
+#include "RegionLabeller.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <limits>
+
+Heightfield::Heightfield()
+{
+	m_terrainWidth = 0;
+	m_terrainHeight = 0;
+	m_frequency = 0.0f;
+	m_amplitude = 0.0f;
+	m_wavelength = 0.0f;
+	m_textureCoordinatesStep = 0.0f;
+	m_dirtyRect = { 0, 0, -1, -1 };
+	m_isDirty = false;
+
+	FillVoronoiRegionColours();
+
+	// Default random seed
+	SetRandomSeed(static_cast<unsigned int>(std::time(nullptr)));
+}
+
+
+Heightfield::~Heightfield()
+{
+}
+
+bool Heightfield::Initialize(int terrainWidth, int terrainHeight)
+{
+	if (terrainWidth < 2 || terrainHeight < 2)
+	{
+		return false;
+	}
+
+	// Save the dimensions of the terrain.
+	m_terrainWidth = terrainWidth;
+	m_terrainHeight = terrainHeight;
+
+	m_frequency = m_terrainWidth / 20;
+	m_amplitude = 3.0;
+	m_wavelength = 1;
+
+	//this is how we calculate the texture coordinates first calculate the step size there will be between vertices.
+	m_textureCoordinatesStep = 5.0f / m_terrainWidth;  //tile 5 times across the terrain.
+
+	// Initialise the data in the height map (flat).
+	const int texelCount = m_terrainWidth * m_terrainHeight;
+	m_heights.assign(texelCount, 0.0f);
+	m_normals.assign(texelCount, EncodeNormal({ 0.0f, 1.0f, 0.0f }));
+
+	// No texel belongs to a region until regions are generated for this grid.
+	m_regionIds.clear();
+
+	//even though we are generating a flat terrain, we still need to normalise it.
+	return CalculateNormals();
+}
+
+bool Heightfield::CalculateNormals()
+{
+	return CalculateNormals({ 0, 0, m_terrainWidth - 1, m_terrainHeight - 1 });
+}
+
+bool Heightfield::CalculateNormals(const Rect& changedHeights)
+{
+	// Every face touching a changed height changes, and so does every vertex of those faces.
+	const Rect rect = ClipRect({ changedHeights.minX - 1, changedHeights.minZ - 1,
+		changedHeights.maxX + 1, changedHeights.maxZ + 1 });
+	if (rect.minX > rect.maxX || rect.minZ > rect.maxZ)
+	{
+		return true;
+	}
+
+	// Go through the vertices and take an average of each face normal
+	// that the vertex touches to get the averaged normal for that vertex.
+	for (int j = rect.minZ; j <= rect.maxZ; j++)
+	{
+		for (int i = rect.minX; i <= rect.maxX; i++)
+		{
+			Float3 sum = { 0.0f, 0.0f, 0.0f };
+			int count = 0;
+
+			const auto addFace = [&](int faceX, int faceZ)
+			{
+				const Float3 normal = GetFaceNormal(faceX, faceZ);
+				sum.x += normal.x;
+				sum.y += normal.y;
+				sum.z += normal.z;
+				count++;
+			};
+
+			// Bottom left face.
+			if (((i - 1) >= 0) && ((j - 1) >= 0))
+			{
+				addFace(i - 1, j - 1);
+			}
+
+			// Bottom right face.
+			if ((i < (m_terrainWidth - 1)) && ((j - 1) >= 0))
+			{
+				addFace(i, j - 1);
+			}
+
+			// Upper left face.
+			if (((i - 1) >= 0) && (j < (m_terrainHeight - 1)))
+			{
+				addFace(i - 1, j);
+			}
+
+			// Upper right face.
+			if ((i < (m_terrainWidth - 1)) && (j < (m_terrainHeight - 1)))
+			{
+				addFace(i, j);
+			}
+
+			// Take the average of the faces touching this vertex.
+			sum.x = (sum.x / (float)count);
+			sum.y = (sum.y / (float)count);
+			sum.z = (sum.z / (float)count);
+
+			// Calculate the length of this normal.
+			const float length = std::sqrt((sum.x * sum.x) + (sum.y * sum.y) + (sum.z * sum.z));
+
+			// Normalize the final shared normal for this vertex and store it in the height map array.
+			m_normals[GetIndex(i, j)] = EncodeNormal({ sum.x / length, sum.y / length, sum.z / length });
+		}
+	}
+
+	MarkDirty(rect);
+
+	return true;
+}
+
+Heightfield::Float3 Heightfield::GetFaceNormal(int i, int j) const
+{
+	// Get three vertices from the face.
+	const Float3 vertex1 = GetPosition(i, j);
+	const Float3 vertex2 = GetPosition(i + 1, j);
+	const Float3 vertex3 = GetPosition(i, j + 1);
+
+	// Calculate the two vectors for this face.
+	const Float3 vector1 = { vertex1.x - vertex3.x, vertex1.y - vertex3.y, vertex1.z - vertex3.z };
+	const Float3 vector2 = { vertex3.x - vertex2.x, vertex3.y - vertex2.y, vertex3.z - vertex2.z };
+
+	// Calculate the cross product of those two vectors to get the un-normalized value for this face normal.
+	return {
+		(vector1.y * vector2.z) - (vector1.z * vector2.y),
+		(vector1.z * vector2.x) - (vector1.x * vector2.z),
+		(vector1.x * vector2.y) - (vector1.y * vector2.x)
+	};
+}
+
+Heightfield::OctNormal Heightfield::EncodeNormal(const Float3& normal)
+{
+	const auto signNotZero = [](float value) { return value >= 0.0f ? 1.0f : -1.0f; };
+	const auto toSnorm16 = [](float value)
+	{
+		return static_cast<short>(std::round(std::max(-1.0f, std::min(value, 1.0f)) * 32767.0f));
+	};
+
+	// Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the corners.
+	const float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	float x = sum > 0.0f ? normal.x / sum : 0.0f;
+	float z = sum > 0.0f ? normal.z / sum : 0.0f;
+
+	if (normal.y < 0.0f)
+	{
+		const float foldedX = (1.0f - std::fabs(z)) * signNotZero(x);
+		const float foldedZ = (1.0f - std::fabs(x)) * signNotZero(z);
+		x = foldedX;
+		z = foldedZ;
+	}
+
+	return { toSnorm16(x), toSnorm16(z) };
+}
+
+Heightfield::Float3 Heightfield::DecodeNormal(const OctNormal& normal)
+{
+	const auto signNotZero = [](float value) { return value >= 0.0f ? 1.0f : -1.0f; };
+
+	float x = normal.x / 32767.0f;
+	float z = normal.z / 32767.0f;
+	const float y = 1.0f - std::fabs(x) - std::fabs(z);
+
+	if (y < 0.0f)
+	{
+		const float unfoldedX = (1.0f - std::fabs(z)) * signNotZero(x);
+		const float unfoldedZ = (1.0f - std::fabs(x)) * signNotZero(z);
+		x = unfoldedX;
+		z = unfoldedZ;
+	}
+
+	const float length = std::sqrt(x * x + y * y + z * z);
+	return { x / length, y / length, z / length };
+}
+
+Heightfield::Float4 Heightfield::GetColour(int index) const
+{
+	if (m_voronoiRegions.empty() || m_regionIds.empty())
+	{
+		return { 0.0f, 0.0f, 0.0f, 0.0f };
+	}
+
+	return m_voronoiRegions[m_regionIds[index]].colourVector;
+}
+
+Heightfield::Rect Heightfield::ClipRect(const Rect& rect) const
+{
+	return {
+		std::max(rect.minX, 0),
+		std::max(rect.minZ, 0),
+		std::min(rect.maxX, m_terrainWidth - 1),
+		std::min(rect.maxZ, m_terrainHeight - 1)
+	};
+}
+
+void Heightfield::MarkDirty(const Rect& rect)
+{
+	const Rect clipped = ClipRect(rect);
+	if (clipped.minX > clipped.maxX || clipped.minZ > clipped.maxZ)
+	{
+		return;
+	}
+
+	if (!m_isDirty)
+	{
+		m_dirtyRect = clipped;
+		m_isDirty = true;
+		return;
+	}
+
+	m_dirtyRect.minX = std::min(m_dirtyRect.minX, clipped.minX);
+	m_dirtyRect.minZ = std::min(m_dirtyRect.minZ, clipped.minZ);
+	m_dirtyRect.maxX = std::max(m_dirtyRect.maxX, clipped.maxX);
+	m_dirtyRect.maxZ = std::max(m_dirtyRect.maxZ, clipped.maxZ);
+}
+
+void Heightfield::MarkAllDirty()
+{
+	MarkDirty({ 0, 0, m_terrainWidth - 1, m_terrainHeight - 1 });
+}
+
+bool Heightfield::ConsumeDirtyRect(Rect& rect)
+{
+	if (!m_isDirty)
+	{
+		return false;
+	}
+
+	rect = m_dirtyRect;
+	m_isDirty = false;
+
+	return true;
+}
+
+bool Heightfield::ApplyBrush(float x, float z, float radius, float strength)
+{
+	if (radius <= 0.0f)
+	{
+		return false;
+	}
+
+	const Rect rect = ClipRect({
+		static_cast<int>(std::floor(x - radius)),
+		static_cast<int>(std::floor(z - radius)),
+		static_cast<int>(std::ceil(x + radius)),
+		static_cast<int>(std::ceil(z + radius))
+	});
+	if (rect.minX > rect.maxX || rect.minZ > rect.maxZ)
+	{
+		return false;
+	}
+
+	for (int j = rect.minZ; j <= rect.maxZ; j++)
+	{
+		for (int i = rect.minX; i <= rect.maxX; i++)
+		{
+			const float distance = CalculateDistance(static_cast<float>(i), static_cast<float>(j), x, z);
+			if (distance >= radius)
+			{
+				continue;
+			}
+
+			// Smooth falloff: full strength at the centre, zero slope at the edge.
+			const float t = 1.0f - (distance / radius);
+			m_heights[GetIndex(i, j)] += strength * t * t * (3.0f - 2.0f * t);
+		}
+	}
+
+	return CalculateNormals(rect);
+}
+
+bool Heightfield::GenerateHeightMap()
+{
+	m_frequency = (6.283/m_terrainHeight) / m_wavelength; //we want a wavelength of 1 to be a single wave over the whole terrain.  A single wave is 2 pi which is about 6.283
+
+	//loop through the terrain and set the hieghts how we want. This is where we generate the terrain
+	//in this case I will run a sin-wave through the terrain in one axis.
+	for (int j = 0; j < m_terrainHeight; j++)
+	{
+		for (int i = 0; i < m_terrainWidth; i++)
+		{
+			m_heights[GetIndex(i, j)] = (float)(std::sin((float)i * (m_frequency)) * m_amplitude);
+		}
+	}
+
+	return CalculateNormals();
+}
+
+void Heightfield::SetRandomSeed(unsigned int seed)
+{
+	m_worldGenContext.SetSeed(seed);
+	m_perlinNoise.GeneratePermutationTable(m_worldGenContext.GetStream(WorldGenContext::Stream::Permutation));
+}
+
+bool Heightfield::GenerateWorld(const WorldSettings& settings)
+{
+	SetRandomSeed(settings.seed);
+
+	if (!GeneratePerlinNoiseTerrain(settings.noiseScale, settings.noiseOctaves))
+	{
+		return false;
+	}
+
+	return GenerateVoronoiRegions(settings.numRegions);
+}
+
+void Heightfield::Save(WorldSnapshot& snapshot) const
+{
+	snapshot.width = m_terrainWidth;
+	snapshot.height = m_terrainHeight;
+	snapshot.heights = m_heights;
+	snapshot.normals = m_normals;
+	snapshot.regionIds = m_regionIds;
+	snapshot.voronoiRegions = m_voronoiRegions;
+	snapshot.voronoiRegionColours = m_voronoiRegionColours;
+	snapshot.randomVoronoiRegionColours = m_randomVoronoiRegionColours;
+	snapshot.worldGenContext = m_worldGenContext;
+	snapshot.perlinNoise = m_perlinNoise;
+}
+
+bool Heightfield::Restore(const WorldSnapshot& snapshot)
+{
+	if (snapshot.width != m_terrainWidth || snapshot.height != m_terrainHeight)
+	{
+		return false;
+	}
+
+	m_heights = snapshot.heights;
+	m_normals = snapshot.normals;
+	m_regionIds = snapshot.regionIds;
+	m_voronoiRegions = snapshot.voronoiRegions;
+	m_voronoiRegionColours = snapshot.voronoiRegionColours;
+	m_randomVoronoiRegionColours = snapshot.randomVoronoiRegionColours;
+	m_worldGenContext = snapshot.worldGenContext;
+	m_perlinNoise = snapshot.perlinNoise;
+
+	MarkAllDirty();
+
+	return true;
+}
+
+bool Heightfield::GenerateRandomHeightMap()
+{
+	RandomStream& random = m_worldGenContext.GetStream(WorldGenContext::Stream::HeightMap);
+
+	// Loop through the terrain and set random heights
+	for (int j = 0; j < m_terrainHeight; j++)
+	{
+		for (int i = 0; i < m_terrainWidth; i++)
+		{
+			m_heights[GetIndex(i, j)] = random.NextFloat(0.0f, m_amplitude);
+		}
+	}
+
+	return CalculateNormals();
+}
+
+bool Heightfield::SmoothTerrain(float smoothFactor, int iterations)
+{
+	// Blends each interior texel towards the average of its 8 neighbours, all iterations in one pass
+	m_heightFilter.Smooth(m_heights.data(), m_terrainWidth, m_terrainHeight, smoothFactor, iterations);
+
+	return CalculateNormals();
+}
+
+bool Heightfield::BlurTerrain(float sigma, int iterations)
+{
+	m_heightFilter.GaussianBlur(m_heights.data(), m_terrainWidth, m_terrainHeight, sigma, iterations);
+
+	return CalculateNormals();
+}
+
+bool Heightfield::ApplyThermalErosion(float talus, float rate, int iterations)
+{
+	m_heightFilter.ThermalErosion(m_heights.data(), m_terrainWidth, m_terrainHeight, talus, rate, iterations);
+
+	return CalculateNormals();
+}
+
+bool Heightfield::GenerateFaultTerrain(const FaultFormation::Settings& settings)
+{
+	// Fault lines come from the fault stream, so the same seed gives the same faults
+	RandomStream& random = m_worldGenContext.GetStream(WorldGenContext::Stream::Fault);
+	m_faultFormation.Generate(m_heights.data(), m_terrainWidth, m_terrainHeight, settings, random);
+
+	// Normalize terrain
+	return CalculateNormals();
+}
+
+bool Heightfield::GenerateParticleDepositionTerrain()
+{
+	// Reset height map
+	std::fill(m_heights.begin(), m_heights.end(), 0.0f);
+
+	// Particle deposition parameters
+	int numParticles = 100000;  // Number of particles to drop
+	float particleDropHeight = 10.0f;  // Initial drop height
+	float erosionFactor = 0.01f;  // How much particles spread
+
+	RandomStream& random = m_worldGenContext.GetStream(WorldGenContext::Stream::Deposition);
+
+	for (int particle = 0; particle < numParticles; particle++)
+	{
+		// Random drop location
+		int x = static_cast<int>(random.NextFloat(0.0f, static_cast<float>(m_terrainWidth - 1)));
+		int z = static_cast<int>(random.NextFloat(0.0f, static_cast<float>(m_terrainHeight - 1)));
+
+		float currentHeight = particleDropHeight;
+
+		while (currentHeight > 0)
+		{
+			int index = GetIndex(x, z);
+
+			// Deposit particle
+			m_heights[index] += currentHeight;
+
+			// Find lowest neighboring point
+			float lowestHeight = m_heights[index];
+			int lowestX = x, lowestZ = z;
+
+			for (int dx = -1; dx <= 1; dx++)
+			{
+				for (int dz = -1; dz <= 1; dz++)
+				{
+					if (dx == 0 && dz == 0) continue; // Skip the current particle's position
+
+					int neighborX = x + dx;
+					int neighborZ = z + dz;
+
+					// Ensure we stay within bounds of the height map
+					if (neighborX >= 0 && neighborX < m_terrainWidth &&
+						neighborZ >= 0 && neighborZ < m_terrainHeight)
+					{
+						int neighborIndex = GetIndex(neighborX, neighborZ);
+
+						// Check if this neighbor is lower
+						if (m_heights[neighborIndex] < lowestHeight)
+						{
+							lowestHeight = m_heights[neighborIndex];
+							lowestX = neighborX;
+							lowestZ = neighborZ;
+						}
+					}
+				}
+
+				// Move the particle to the lowest neighbor position
+				x = lowestX;
+				z = lowestZ;
+
+				// Reduce height of the particle for spreading
+				currentHeight -= erosionFactor;
+			}
+		}
+
+		// Normalize terrain
+		return CalculateNormals();
+	}
+
+	return CalculateNormals();
+}
+
+bool Heightfield::ErodeHydraulicDroplets(const HydraulicErosion::DropletSettings& settings)
+{
+	const unsigned int seed = m_worldGenContext.GetStream(WorldGenContext::Stream::Erosion).NextUInt();
+	m_hydraulicErosion.ErodeDroplets(m_heights.data(), m_terrainWidth, m_terrainHeight, settings, seed);
+
+	return CalculateNormals();
+}
+
+bool Heightfield::ErodeHydraulicGrid(const HydraulicErosion::GridSettings& settings)
+{
+	m_hydraulicErosion.ErodeGrid(m_heights.data(), m_terrainWidth, m_terrainHeight, settings);
+
+	return CalculateNormals();
+}
+
+bool Heightfield::GeneratePerlinNoiseTerrain(float scale, int octaves)
+{
+	// Clamp octaves to prevent excessive computation
+	octaves = std::max(1, std::min(octaves, 8));
+
+	// Fractal Brownian Motion, evaluated a row of texels at a time on every core
+	m_perlinNoise.GenerateFbm(PerlinNoise::GetBestKernel(), m_heights.data(),
+		m_terrainWidth, m_terrainHeight, scale, octaves, m_amplitude);
+
+	return CalculateNormals();
+}
+
+void Heightfield::FillRandomColourPool()
+{
+	m_randomVoronoiRegionColours.clear();
+
+	for (const auto& voronoiRegionColour : m_voronoiRegionColours)
+	{
+		m_randomVoronoiRegionColours.push_back(voronoiRegionColour.first);
+	}
+}
+
+bool Heightfield::GenerateVoronoiRegions(int numRegions)
+{
+	if (numRegions < 0 || numRegions > MaxRegions)
+	{
+		return false;
+	}
+
+	FillRandomColourPool();
+
+	// Clear existing regions
+	m_voronoiRegions.clear();
+	m_voronoiRegions.reserve(numRegions);
+
+	RandomStream& random = m_worldGenContext.GetStream(WorldGenContext::Stream::Voronoi);
+	const float maxX = static_cast<float>(m_terrainWidth - 1);
+	const float maxZ = static_cast<float>(m_terrainHeight - 1);
+
+	// Generate seed points for each region
+	for (int i = 0; i < numRegions; i++)
+	{
+		VoronoiRegion region;
+		region.seedPoint = Float2{
+			random.NextFloat(0.0f, maxX),
+			random.NextFloat(0.0f, maxZ)
+		};
+		region.colour = GetRandomColour();
+		region.colourVector = m_voronoiRegionColours[region.colour];
+
+		const auto regionSize = 30.0f; // Adjust based on the terrain size
+		region.minX = std::max(0.0f, region.seedPoint.x - regionSize / 2);
+		region.maxX = std::min(static_cast<float>(m_terrainWidth - 1), region.seedPoint.x + regionSize / 2);
+		region.minZ = std::max(0.0f, region.seedPoint.y - regionSize / 2);
+		region.maxZ = std::min(static_cast<float>(m_terrainHeight - 1), region.seedPoint.y + regionSize / 2);
+
+		region.heightOffset = random.NextFloat(-1.0f, 1.0f);
+
+		m_voronoiRegions.push_back(region);
+	}
+
+	LabelRegions();
+
+	return CalculateNormals();
+}
+
+float Heightfield::CalculateDistance(float x1, float y1, float x2, float y2) const
+{
+	float dx = x1 - x2;
+	float dy = y1 - y2;
+	return std::sqrt(dx * dx + dy * dy);
+}
+
+void Heightfield::FillVoronoiRegionColours()
+{
+	// Same values as the matching DirectX::Colors constants.
+	m_voronoiRegionColours[Enums::COLOUR::White] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::Red] = { 1.0f, 0.0f, 0.0f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::Blue] = { 0.0f, 0.0f, 1.0f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::Green] = { 0.0f, 0.501960814f, 0.0f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::Goldenrod] = { 0.854902029f, 0.647058845f, 0.125490203f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::Yellow] = { 1.0f, 1.0f, 0.0f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::Orange] = { 1.0f, 0.647058845f, 0.0f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::Pink] = { 1.0f, 0.752941251f, 0.796078503f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::SlateGray] = { 0.439215720f, 0.501960814f, 0.564705908f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::Violet] = { 0.933333397f, 0.509803951f, 0.933333397f, 1.0f };
+	m_voronoiRegionColours[Enums::COLOUR::RosyBrown] = { 0.737254918f, 0.560784340f, 0.560784340f, 1.0f };
+}
+
+const Enums::COLOUR& Heightfield::GetRandomColour()
+{
+	// Once every colour has been handed out, start over so any number of regions can be coloured.
+	if (m_randomVoronoiRegionColours.empty())
+	{
+		FillRandomColourPool();
+	}
+
+	const auto voronoiRegionColourCount = static_cast<int>(m_randomVoronoiRegionColours.size());
+	RandomStream& random = m_worldGenContext.GetStream(WorldGenContext::Stream::Voronoi);
+	const auto randomIndex = random.NextInt(0, voronoiRegionColourCount - 1);
+	const auto randomColour = m_randomVoronoiRegionColours[randomIndex];
+
+	m_randomVoronoiRegionColours.erase(m_randomVoronoiRegionColours.begin() + randomIndex);
+
+	// Return the stable palette entry rather than a reference to the erased element.
+	return m_voronoiRegionColours.find(randomColour)->first;
+}
+
+const Enums::COLOUR& Heightfield::GetRandomVoronoiRegionColour()
+{
+	RandomStream& random = m_worldGenContext.GetStream(WorldGenContext::Stream::Placement);
+	const auto voronoiRegionsCount = static_cast<int>(m_voronoiRegions.size());
+	const auto randomIndex = random.NextInt(0, voronoiRegionsCount - 1);
+
+	return m_voronoiRegions[randomIndex].colour;
+}
+
+int Heightfield::GetRegionIdAtPosition(const float x, const float z) const
+{
+	if (m_voronoiRegions.empty() || m_regionIds.empty())
+	{
+		return -1;
+	}
+
+	// Round to the nearest texel; the float comparisons also send NaN to the first column/row.
+	const float maxX = static_cast<float>(m_terrainWidth - 1);
+	const float maxZ = static_cast<float>(m_terrainHeight - 1);
+	const float clampedX = x > 0.0f ? (x < maxX ? x : maxX) : 0.0f;
+	const float clampedZ = z > 0.0f ? (z < maxZ ? z : maxZ) : 0.0f;
+
+	return m_regionIds[GetIndex(static_cast<int>(clampedX + 0.5f), static_cast<int>(clampedZ + 0.5f))];
+}
+
+const Enums::COLOUR& Heightfield::GetRegionColourAtPosition(const float x, const float z) const
+{
+	static const Enums::COLOUR defaultColour = Enums::COLOUR::White;
+
+	const int regionId = GetRegionIdAtPosition(x, z);
+	if (regionId < 0)
+	{
+		return defaultColour;
+	}
+
+	return m_voronoiRegions[regionId].colour;
+}
+
+void Heightfield::GetRegionColoursAtPositions(const Float2* positions, int count, Enums::COLOUR* colours) const
+{
+	for (int n = 0; n < count; n++)
+	{
+		const int regionId = GetRegionIdAtPosition(positions[n].x, positions[n].y);
+		colours[n] = regionId < 0 ? Enums::COLOUR::White : m_voronoiRegions[regionId].colour;
+	}
+}
+
+const Heightfield::Float4& Heightfield::GetVoronoiRegionColourVector(const Enums::COLOUR& colour) const
+{
+	return m_voronoiRegionColours.at(colour);
+}
+
+void Heightfield::LabelRegions()
+{
+	m_regionIds.assign(m_heights.size(), 0);
+
+	const int regionCount = static_cast<int>(m_voronoiRegions.size());
+	if (regionCount == 0)
+	{
+		return;
+	}
+
+	std::vector<RegionLabeller::Seed> seeds;
+	seeds.reserve(regionCount);
+	for (const auto& region : m_voronoiRegions)
+	{
+		seeds.push_back({ region.seedPoint.x, region.seedPoint.y });
+	}
+
+	RegionLabeller labeller;
+	labeller.Build(seeds, m_terrainWidth, m_terrainHeight);
+
+	// Centroid sums per fixed band of rows, merged in band order, so the result
+	// does not depend on how many threads did the work.
+	struct CentroidSum
+	{
+		double x, y, z;
+		int count;
+	};
+
+	const int rowsPerBand = 64;
+	const int bandCount = (m_terrainHeight + rowsPerBand - 1) / rowsPerBand;
+	std::vector<CentroidSum> bandSums(static_cast<size_t>(bandCount) * regionCount, CentroidSum{ 0.0, 0.0, 0.0, 0 });
+
+	// One sweep: label each texel with its nearest seed, colour it, apply the region's
+	// height offset and add the texel to the region's centroid.
+	ParallelFor(0, bandCount, [&](int bandBegin, int bandEnd)
+	{
+		for (int band = bandBegin; band < bandEnd; band++)
+		{
+			CentroidSum* sums = &bandSums[static_cast<size_t>(band) * regionCount];
+			const int rowEnd = std::min(m_terrainHeight, (band + 1) * rowsPerBand);
+
+			for (int j = band * rowsPerBand; j < rowEnd; j++)
+			{
+				for (int i = 0; i < m_terrainWidth; i++)
+				{
+					const int index = GetIndex(i, j);
+					const int regionId = labeller.FindNearest(static_cast<float>(i), static_cast<float>(j));
+					const VoronoiRegion& region = m_voronoiRegions[regionId];
+
+					// Also gives the texel its colour, looked up from the region when needed
+					m_regionIds[index] = static_cast<unsigned short>(regionId);
+
+					// Optional height modification
+					m_heights[index] += region.heightOffset * 0.5f;
+
+					CentroidSum& sum = sums[regionId];
+					sum.x += i;
+					sum.y += m_heights[index];
+					sum.z += j;
+					sum.count++;
+				}
+			}
+		}
+	});
+
+	for (int regionId = 0; regionId < regionCount; regionId++)
+	{
+		CentroidSum total = { 0.0, 0.0, 0.0, 0 };
+		for (int band = 0; band < bandCount; band++)
+		{
+			const CentroidSum& sum = bandSums[static_cast<size_t>(band) * regionCount + regionId];
+			total.x += sum.x;
+			total.y += sum.y;
+			total.z += sum.z;
+			total.count += sum.count;
+		}
+
+		VoronoiRegion& region = m_voronoiRegions[regionId];
+
+		// A region whose seed is shadowed by a coincident one keeps its seed point.
+		if (total.count == 0)
+		{
+			region.position = { region.seedPoint.x, GetHeightAt(region.seedPoint.x, region.seedPoint.y), region.seedPoint.y };
+			continue;
+		}
+
+		region.position = {
+			static_cast<float>(total.x / total.count),
+			static_cast<float>(total.y / total.count),
+			static_cast<float>(total.z / total.count)
+		};
+	}
+}
+
+float Heightfield::GetHeightAt(float x, float z) const
+{
+	// Clamp x and z to terrain grid coordinates
+	x = std::max(0.0f, std::min(x, static_cast<float>(m_terrainWidth - 1)));
+	z = std::max(0.0f, std::min(z, static_cast<float>(m_terrainHeight - 1)));
+
+	int x0 = static_cast<int>(x);
+	int z0 = static_cast<int>(z);
+	float fracX = x - x0;
+	float fracZ = z - z0;
+
+	int x1 = std::min(x0 + 1, m_terrainWidth - 1);
+	int z1 = std::min(z0 + 1, m_terrainHeight - 1);
+
+	float h00 = m_heights[GetIndex(x0, z0)];
+	float h10 = m_heights[GetIndex(x1, z0)];
+	float h01 = m_heights[GetIndex(x0, z1)];
+	float h11 = m_heights[GetIndex(x1, z1)];
+
+	// Bilinear interpolation
+	float h = (1 - fracX) * (1 - fracZ) * h00 +
+		fracX * (1 - fracZ) * h10 +
+		(1 - fracX) * fracZ * h01 +
+		fracX * fracZ * h11;
+
+	return h;
+}
+
+Heightfield::Float3 Heightfield::GetRandomPosition()
+{
+	RandomStream& random = m_worldGenContext.GetStream(WorldGenContext::Stream::Placement);
+	const auto randomHeightIndex = random.NextInt(0, m_terrainHeight - 1);
+	const auto randomWidthIndex = random.NextInt(0, m_terrainWidth - 1);
+
+	return GetPosition(randomWidthIndex, randomHeightIndex);
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+// Per-texel height, normal and region data of the terrain, and the generators that modify them.
+
+#include "Enums.h"
+#include "FaultFormation.h"
+#include "HeightFilter.h"
+#include "HydraulicErosion.h"
+#include "PerlinNoise.h"
+#include "WorldGenContext.h"
+#include <map>
+#include <vector>
+
+class Heightfield
+{
+public:
+	struct Float2
+	{
+		float x, y;
+	};
+
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	struct Float4
+	{
+		float x, y, z, w;
+	};
+
+	// Unit normal folded onto an octahedron and stored as two snorm16 values (x and z plane;
+	// the lower hemisphere is folded over the corners), accurate to within 0.05 degrees.
+	struct OctNormal
+	{
+		short x, z;
+	};
+
+	struct VoronoiRegion
+	{
+		Float2 seedPoint;
+		Float4 colourVector;
+		Float3 position;
+		Enums::COLOUR colour;
+		float minX, maxX;
+		float minZ, maxZ;
+		float heightOffset;
+	};
+
+	// Inclusive range of grid points
+	struct Rect
+	{
+		int minX, minZ;
+		int maxX, maxZ;
+	};
+
+	// Everything besides the grid size and amplitude that a generated world depends on.
+	struct WorldSettings
+	{
+		unsigned int seed;
+		float noiseScale;
+		int noiseOctaves;
+		int numRegions;
+	};
+
+	// The data a generated world consists of, without the generators' scratch, for caching worlds.
+	struct WorldSnapshot
+	{
+		int width, height;
+		std::vector<float> heights;
+		std::vector<OctNormal> normals;
+		std::vector<unsigned short> regionIds;
+		std::vector<VoronoiRegion> voronoiRegions;
+		std::map<Enums::COLOUR, Float4> voronoiRegionColours;
+		std::vector<Enums::COLOUR> randomVoronoiRegionColours;
+		WorldGenContext worldGenContext;
+		PerlinNoise perlinNoise;
+	};
+
+public:
+	Heightfield();
+	~Heightfield();
+
+	bool Initialize(int terrainWidth, int terrainHeight);
+
+	float* GetWavelength() { return &m_wavelength; }
+	float* GetAmplitude() { return &m_amplitude; }
+	float GetAmplitude() const { return m_amplitude; }
+
+	// Reseeds every generator (including the Perlin permutation table) from a single seed.
+	void SetRandomSeed(unsigned int seed);
+	unsigned int GetRandomSeed() const { return m_worldGenContext.GetSeed(); }
+	WorldGenContext& GetWorldGenContext() { return m_worldGenContext; }
+
+	// Seeds, then generates Perlin noise terrain and Voronoi regions; same settings, same world.
+	bool GenerateWorld(const WorldSettings& settings);
+
+	void Save(WorldSnapshot& snapshot) const;
+	// Fails if the snapshot was taken from a grid of another size. Marks the whole grid dirty.
+	bool Restore(const WorldSnapshot& snapshot);
+
+	bool GenerateRandomHeightMap();
+
+	bool GenerateHeightMap();
+	bool GeneratePerlinNoiseTerrain(float scale = 1.0f, int octaves = 4);
+	// Region ids are stored per texel as 16-bit values.
+	static const int MaxRegions = 65535;
+
+	// Labels every texel with its nearest seed and sets each region's position to the centroid
+	// of its texels, in a single near-linear sweep.
+	bool GenerateVoronoiRegions(int numRegions);
+	bool SmoothTerrain(float smoothFactor, int iterations = 1);
+	bool BlurTerrain(float sigma, int iterations = 1);
+	// talus is the steepest stable height difference between neighbouring texels.
+	bool ApplyThermalErosion(float talus, float rate, int iterations);
+	bool GenerateFaultTerrain(const FaultFormation::Settings& settings = FaultFormation::Settings());
+	bool GenerateParticleDepositionTerrain();
+
+	// Each call draws a new droplet seed from the erosion stream, so repeated erosion stays
+	// reproducible for a world seed.
+	bool ErodeHydraulicDroplets(const HydraulicErosion::DropletSettings& settings);
+	bool ErodeHydraulicGrid(const HydraulicErosion::GridSettings& settings);
+
+	bool CalculateNormals();
+
+	// Recomputes only the normals affected by height changes inside the rect.
+	bool CalculateNormals(const Rect& changedHeights);
+
+	// Raises (or with a negative strength lowers) the terrain around (x, z), touching only that area.
+	bool ApplyBrush(float x, float z, float radius, float strength);
+
+	// Changed grid points since the last ConsumeDirtyRect, for incremental GPU uploads.
+	// Every normal recalculation marks the points it rewrote.
+	void MarkDirty(const Rect& rect);
+	void MarkAllDirty();
+	bool ConsumeDirtyRect(Rect& rect);
+
+	const Enums::COLOUR& GetRandomVoronoiRegionColour();
+	// Constant-time lookups in the region-id raster, using the texel nearest to (x, z).
+	// Positions outside the map use the closest edge texel. Returns -1 when there are no regions.
+	int GetRegionIdAtPosition(const float x, const float z) const;
+	const Enums::COLOUR& GetRegionColourAtPosition(const float x, const float z) const;
+
+	// Batched form: colours[n] is the region colour at positions[n].
+	void GetRegionColoursAtPositions(const Float2* positions, int count, Enums::COLOUR* colours) const;
+	const Float4& GetVoronoiRegionColourVector(const Enums::COLOUR& colour) const;
+	const std::vector<VoronoiRegion>& GetVoronoiRegions() const { return m_voronoiRegions; }
+
+	float GetHeightAt(float x, float z) const;
+	Float3 GetRandomPosition();
+
+	int GetWidth() const { return m_terrainWidth; }
+	int GetHeight() const { return m_terrainHeight; }
+	int GetIndex(int x, int z) const { return (z * m_terrainWidth) + x; }
+
+	// Per-texel data, row major (z * width + x), one packed plane each: 4 bytes of height,
+	// 4 of normal and 2 of region id per texel. x/z positions, texture coordinates and colours
+	// are pure functions of the grid index or the region, so they are derived on demand.
+	const std::vector<float>& GetHeights() const { return m_heights; }
+	const std::vector<OctNormal>& GetNormals() const { return m_normals; }
+
+	// Index into GetVoronoiRegions() of the region each texel belongs to; empty before any regions.
+	const std::vector<unsigned short>& GetRegionIds() const { return m_regionIds; }
+
+	Float3 GetNormal(int index) const { return DecodeNormal(m_normals[index]); }
+	// Colour of the texel's region, or zero if no regions have been generated.
+	Float4 GetColour(int index) const;
+
+	static OctNormal EncodeNormal(const Float3& normal);
+	static Float3 DecodeNormal(const OctNormal& normal);
+
+	Float3 GetPosition(int x, int z) const { return { (float)x, m_heights[GetIndex(x, z)], (float)z }; }
+	Float2 GetTextureCoordinates(int x, int z) const { return { x * m_textureCoordinatesStep, z * m_textureCoordinatesStep }; }
+
+	const PerlinNoise& GetPerlinNoise() const { return m_perlinNoise; }
+
+private:
+	float CalculateDistance(float x1, float y1, float x2, float y2) const;
+	Float3 GetFaceNormal(int i, int j) const;
+	Rect ClipRect(const Rect& rect) const;
+	const Enums::COLOUR& GetRandomColour();
+	void FillVoronoiRegionColours();
+	void FillRandomColourPool();
+	void LabelRegions();
+
+private:
+	int m_terrainWidth, m_terrainHeight;
+	float m_frequency, m_amplitude, m_wavelength;
+	float m_textureCoordinatesStep;
+
+	std::vector<float> m_heights;
+	std::vector<OctNormal> m_normals;
+	std::vector<unsigned short> m_regionIds;
+
+	// Grid points changed since the last upload
+	Rect m_dirtyRect;
+	bool m_isDirty;
+
+	// Source of all randomness, one stream per generator
+	WorldGenContext m_worldGenContext;
+
+	// Noise generation parameters
+	PerlinNoise m_perlinNoise;
+
+	std::vector<VoronoiRegion> m_voronoiRegions;
+	std::map<Enums::COLOUR, Float4> m_voronoiRegionColours;
+	std::vector<Enums::COLOUR> m_randomVoronoiRegionColours;
+
+	// Keeps its fault list between runs
+	FaultFormation m_faultFormation;
+
+	// Keeps its band scratch between smoothing and thermal erosion runs
+	HeightFilter m_heightFilter;
+
+	// Keeps its brush and droplet buffers between erosion runs; grid state lives only for a call
+	HydraulicErosion m_hydraulicErosion;
+};
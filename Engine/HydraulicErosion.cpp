@@ -0,0 +1,471 @@
+#include "HydraulicErosion.h"
+#include "ParallelFor.h"
+#include "WorldGenContext.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Outflow directions in the grid model, four floats per texel
+	enum Outflow
+	{
+		Left,
+		Right,
+		Up,		// towards z - 1
+		Down,	// towards z + 1
+		OutflowCount
+	};
+
+	// Shallow water state, one value per texel (four outflows per texel)
+	struct GridState
+	{
+		std::vector<float> terrain, terrainNext;
+		std::vector<float> water, waterNext;
+		std::vector<float> sediment, sedimentNext;
+		std::vector<float> outflow;
+		std::vector<float> velocityX, velocityZ;
+	};
+
+	// Bilinear height and gradient at (x, z); the texel at floor(x, z) and its +1 neighbours must exist.
+	float SampleHeightAndGradient(const float* heights, int width, float x, float z, float& gradientX, float& gradientZ)
+	{
+		const int nodeX = static_cast<int>(x);
+		const int nodeZ = static_cast<int>(z);
+		const float u = x - nodeX;
+		const float v = z - nodeZ;
+
+		const int index = nodeZ * width + nodeX;
+		const float heightNW = heights[index];
+		const float heightNE = heights[index + 1];
+		const float heightSW = heights[index + width];
+		const float heightSE = heights[index + width + 1];
+
+		gradientX = (heightNE - heightNW) * (1.0f - v) + (heightSE - heightSW) * v;
+		gradientZ = (heightSW - heightNW) * (1.0f - u) + (heightSE - heightNE) * u;
+
+		return heightNW * (1.0f - u) * (1.0f - v) + heightNE * u * (1.0f - v) + heightSW * (1.0f - u) * v + heightSE * u * v;
+	}
+
+	// Spreads amount bilinearly over the four texels around (x, z)
+	void Deposit(float* heights, int width, float x, float z, float amount)
+	{
+		const int nodeX = static_cast<int>(x);
+		const int nodeZ = static_cast<int>(z);
+		const float u = x - nodeX;
+		const float v = z - nodeZ;
+
+		const int index = nodeZ * width + nodeX;
+		heights[index] += amount * (1.0f - u) * (1.0f - v);
+		heights[index + 1] += amount * u * (1.0f - v);
+		heights[index + width] += amount * (1.0f - u) * v;
+		heights[index + width + 1] += amount * u * v;
+	}
+}
+
+HydraulicErosion::HydraulicErosion()
+	: m_brushRadius(-1)
+{
+}
+
+void HydraulicErosion::BuildBrush(int radius)
+{
+	if (radius == m_brushRadius)
+	{
+		return;
+	}
+
+	m_brush.clear();
+	m_brushRadius = radius;
+
+	float weightSum = 0.0f;
+
+	for (int offsetZ = -radius; offsetZ <= radius; offsetZ++)
+	{
+		for (int offsetX = -radius; offsetX <= radius; offsetX++)
+		{
+			const float distance = std::sqrt(static_cast<float>(offsetX * offsetX + offsetZ * offsetZ));
+
+			if (distance < radius || radius == 0)
+			{
+				const float weight = radius > 0 ? 1.0f - distance / radius : 1.0f;
+				m_brush.push_back({ offsetX, offsetZ, weight });
+				weightSum += weight;
+			}
+		}
+	}
+
+	for (auto& tap : m_brush)
+	{
+		tap.weight /= weightSum;
+	}
+}
+
+void HydraulicErosion::RunDroplet(float* heights, int width, int height, const DropletSettings& settings, float x, float z) const
+{
+	float directionX = 0.0f;
+	float directionZ = 0.0f;
+	float speed = settings.initialSpeed;
+	float water = settings.initialWater;
+	float sediment = 0.0f;
+
+	for (int lifetime = 0; lifetime < settings.maxLifetime; lifetime++)
+	{
+		const float previousX = x;
+		const float previousZ = z;
+		const int nodeX = static_cast<int>(x);
+		const int nodeZ = static_cast<int>(z);
+
+		float gradientX, gradientZ;
+		const float currentHeight = SampleHeightAndGradient(heights, width, x, z, gradientX, gradientZ);
+
+		// Blend the previous direction with the downhill direction and take one texel long step
+		directionX = directionX * settings.inertia - gradientX * (1.0f - settings.inertia);
+		directionZ = directionZ * settings.inertia - gradientZ * (1.0f - settings.inertia);
+
+		const float length = std::sqrt(directionX * directionX + directionZ * directionZ);
+		if (length < 1.0e-6f)
+		{
+			break;
+		}
+
+		directionX /= length;
+		directionZ /= length;
+		x += directionX;
+		z += directionZ;
+
+		if (x < 0.0f || z < 0.0f || x >= width - 1 || z >= height - 1)
+		{
+			// Whatever it carries drains off the map
+			return;
+		}
+
+		float unusedX, unusedZ;
+		const float deltaHeight = SampleHeightAndGradient(heights, width, x, z, unusedX, unusedZ) - currentHeight;
+
+		// Faster, fuller droplets going steeper downhill can carry more
+		const float capacity = std::max(-deltaHeight * speed * water * settings.sedimentCapacityFactor, settings.minSedimentCapacity);
+
+		if (sediment > capacity || deltaHeight > 0.0f)
+		{
+			// Uphill: fill the pit behind the droplet, at most up to the new height.
+			// Downhill: drop a share of the excess. Either way spread it over the four corners left behind.
+			const float deposit = deltaHeight > 0.0f ? std::min(deltaHeight, sediment) : (sediment - capacity) * settings.depositSpeed;
+			sediment -= deposit;
+			Deposit(heights, width, previousX, previousZ, deposit);
+		}
+		else
+		{
+			// Never erode more than the height difference, so the droplet does not dig a pit behind itself
+			const float erode = std::min((capacity - sediment) * settings.erodeSpeed, -deltaHeight);
+
+			for (const BrushTap& tap : m_brush)
+			{
+				const int tapX = nodeX + tap.offsetX;
+				const int tapZ = nodeZ + tap.offsetZ;
+
+				// The border ring is never eroded, or droplets draining off the map would keep
+				// deepening it and dig trenches along the edges
+				if (tapX < 1 || tapZ < 1 || tapX >= width - 1 || tapZ >= height - 1)
+				{
+					continue;
+				}
+
+				const float amount = erode * tap.weight;
+				heights[tapZ * width + tapX] -= amount;
+				sediment += amount;
+			}
+		}
+
+		speed = std::sqrt(std::max(0.0f, speed * speed - deltaHeight * settings.gravity));
+		water *= 1.0f - settings.evaporateSpeed;
+	}
+
+	// Evaporated or stuck: the sediment settles where the droplet stopped
+	Deposit(heights, width, x, z, sediment);
+}
+
+void HydraulicErosion::ErodeDroplets(float* heights, int width, int height, const DropletSettings& settings, unsigned int seed)
+{
+	if (width < 2 || height < 2 || settings.dropletCount <= 0 || settings.maxLifetime <= 0)
+	{
+		return;
+	}
+
+	BuildBrush(std::max(0, settings.erosionRadius));
+
+	// Farthest texel a droplet can read or write from its start: one texel per step, plus the
+	// brush, plus the +1 corner of bilinear sampling and deposition.
+	const int reach = settings.maxLifetime + m_brushRadius + 2;
+	const int tileSize = 2 * reach;
+	const int tilesX = (width + tileSize - 1) / tileSize;
+	const int tilesZ = (height + tileSize - 1) / tileSize;
+	const int tileCount = tilesX * tilesZ;
+
+	// Start positions are drawn in order, so they only depend on the seed
+	RandomStream random(seed);
+	const int dropletCount = settings.dropletCount;
+	m_dropletPositions.resize(2 * static_cast<size_t>(dropletCount));
+
+	for (int droplet = 0; droplet < dropletCount; droplet++)
+	{
+		m_dropletPositions[2 * droplet] = random.NextFloat(0.0f, static_cast<float>(width - 1));
+		m_dropletPositions[2 * droplet + 1] = random.NextFloat(0.0f, static_cast<float>(height - 1));
+	}
+
+	const auto getTile = [&](int droplet)
+	{
+		const int tileX = static_cast<int>(m_dropletPositions[2 * droplet]) / tileSize;
+		const int tileZ = static_cast<int>(m_dropletPositions[2 * droplet + 1]) / tileSize;
+		return tileZ * tilesX + tileX;
+	};
+
+	// Stable counting sort by tile, keeping the seed order within each tile
+	m_tileStarts.assign(tileCount + 1, 0);
+
+	for (int droplet = 0; droplet < dropletCount; droplet++)
+	{
+		m_tileStarts[getTile(droplet) + 1]++;
+	}
+
+	for (int tile = 0; tile < tileCount; tile++)
+	{
+		m_tileStarts[tile + 1] += m_tileStarts[tile];
+	}
+
+	m_tiledPositions.resize(m_dropletPositions.size());
+	std::vector<int> cursors(m_tileStarts.begin(), m_tileStarts.end() - 1);
+
+	for (int droplet = 0; droplet < dropletCount; droplet++)
+	{
+		const int slot = cursors[getTile(droplet)]++;
+		m_tiledPositions[2 * slot] = m_dropletPositions[2 * droplet];
+		m_tiledPositions[2 * slot + 1] = m_dropletPositions[2 * droplet + 1];
+	}
+
+	// Four checkerboard phases; tiles of one phase are a whole tile apart
+	for (int phase = 0; phase < 4; phase++)
+	{
+		m_phaseTiles.clear();
+
+		for (int tileZ = phase / 2; tileZ < tilesZ; tileZ += 2)
+		{
+			for (int tileX = phase % 2; tileX < tilesX; tileX += 2)
+			{
+				m_phaseTiles.push_back(tileZ * tilesX + tileX);
+			}
+		}
+
+		ParallelFor(0, static_cast<int>(m_phaseTiles.size()), [&](int tileBegin, int tileEnd)
+		{
+			for (int i = tileBegin; i < tileEnd; i++)
+			{
+				const int tile = m_phaseTiles[i];
+
+				for (int slot = m_tileStarts[tile]; slot < m_tileStarts[tile + 1]; slot++)
+				{
+					RunDroplet(heights, width, height, settings, m_tiledPositions[2 * slot], m_tiledPositions[2 * slot + 1]);
+				}
+			}
+		});
+	}
+}
+
+void HydraulicErosion::ErodeGrid(float* heights, int width, int height, const GridSettings& settings)
+{
+	if (width < 2 || height < 2)
+	{
+		return;
+	}
+
+	const size_t texelCount = static_cast<size_t>(width) * height;
+	const float dt = settings.timeStep;
+
+	// Twelve full-size planes, so they only live for the length of the call
+	GridState grid;
+
+	grid.terrain.assign(heights, heights + texelCount);
+	grid.terrainNext.resize(texelCount);
+	grid.water.assign(texelCount, settings.rainRate * dt);
+	grid.waterNext.resize(texelCount);
+	grid.sediment.assign(texelCount, 0.0f);
+	grid.sedimentNext.resize(texelCount);
+	grid.outflow.assign(texelCount * OutflowCount, 0.0f);
+	grid.velocityX.resize(texelCount);
+	grid.velocityZ.resize(texelCount);
+
+	for (int iteration = 0; iteration < settings.iterations; iteration++)
+	{
+		// Outflow towards each lower neighbour, scaled so no texel sends more water than it has
+		ParallelFor(0, height, [&](int rowBegin, int rowEnd)
+		{
+			for (int z = rowBegin; z < rowEnd; z++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					const int index = z * width + x;
+					const float surface = grid.terrain[index] + grid.water[index];
+					float* outflow = &grid.outflow[index * OutflowCount];
+
+					const auto flowTowards = [&](float previous, bool exists, int neighbour)
+					{
+						if (!exists)
+						{
+							return 0.0f;
+						}
+
+						const float neighbourSurface = grid.terrain[neighbour] + grid.water[neighbour];
+						return std::max(0.0f, previous + dt * settings.gravity * (surface - neighbourSurface));
+					};
+
+					outflow[Left] = flowTowards(outflow[Left], x > 0, index - 1);
+					outflow[Right] = flowTowards(outflow[Right], x < width - 1, index + 1);
+					outflow[Up] = flowTowards(outflow[Up], z > 0, index - width);
+					outflow[Down] = flowTowards(outflow[Down], z < height - 1, index + width);
+
+					const float total = outflow[Left] + outflow[Right] + outflow[Up] + outflow[Down];
+					if (total > 0.0f)
+					{
+						const float scale = std::min(1.0f, grid.water[index] / (total * dt));
+						for (int direction = 0; direction < OutflowCount; direction++)
+						{
+							outflow[direction] *= scale;
+						}
+					}
+				}
+			}
+		}, DefaultMinRowsPerThread);
+
+		// Water height from the net flow, and the velocity field it implies
+		ParallelFor(0, height, [&](int rowBegin, int rowEnd)
+		{
+			for (int z = rowBegin; z < rowEnd; z++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					const int index = z * width + x;
+					const float* outflow = &grid.outflow[index * OutflowCount];
+
+					const float fromLeft = x > 0 ? grid.outflow[(index - 1) * OutflowCount + Right] : 0.0f;
+					const float fromRight = x < width - 1 ? grid.outflow[(index + 1) * OutflowCount + Left] : 0.0f;
+					const float fromUp = z > 0 ? grid.outflow[(index - width) * OutflowCount + Down] : 0.0f;
+					const float fromDown = z < height - 1 ? grid.outflow[(index + width) * OutflowCount + Up] : 0.0f;
+
+					const float inflow = fromLeft + fromRight + fromUp + fromDown;
+					const float totalOutflow = outflow[Left] + outflow[Right] + outflow[Up] + outflow[Down];
+					grid.waterNext[index] = std::max(0.0f, grid.water[index] + dt * (inflow - totalOutflow));
+
+					const float averageWater = 0.5f * (grid.water[index] + grid.waterNext[index]);
+					const float flowX = 0.5f * (fromLeft - outflow[Left] + outflow[Right] - fromRight);
+					const float flowZ = 0.5f * (fromUp - outflow[Up] + outflow[Down] - fromDown);
+
+					float velocityX = averageWater > 1.0e-4f ? flowX / averageWater : 0.0f;
+					float velocityZ = averageWater > 1.0e-4f ? flowZ / averageWater : 0.0f;
+
+					// Thin films would otherwise give huge velocities, and with them huge capacities
+					const float speed = std::sqrt(velocityX * velocityX + velocityZ * velocityZ);
+					if (speed * dt > 1.0f)
+					{
+						velocityX /= speed * dt;
+						velocityZ /= speed * dt;
+					}
+
+					grid.velocityX[index] = velocityX;
+					grid.velocityZ[index] = velocityZ;
+				}
+			}
+		}, DefaultMinRowsPerThread);
+
+		// Dissolve below the transport capacity, deposit above it
+		ParallelFor(0, height, [&](int rowBegin, int rowEnd)
+		{
+			for (int z = rowBegin; z < rowEnd; z++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					const int index = z * width + x;
+
+					const float slopeX = 0.5f * (grid.terrain[z * width + std::min(x + 1, width - 1)] - grid.terrain[z * width + std::max(x - 1, 0)]);
+					const float slopeZ = 0.5f * (grid.terrain[std::min(z + 1, height - 1) * width + x] - grid.terrain[std::max(z - 1, 0) * width + x]);
+					const float slopeSquared = slopeX * slopeX + slopeZ * slopeZ;
+					const float tilt = std::max(settings.minTilt, std::sqrt(slopeSquared / (1.0f + slopeSquared)));
+
+					const float speed = std::sqrt(grid.velocityX[index] * grid.velocityX[index] + grid.velocityZ[index] * grid.velocityZ[index]);
+					// Deeper, faster water on steeper ground carries more; depth counts up to one unit
+					const float capacity = settings.sedimentCapacity * tilt * speed * std::min(1.0f, grid.waterNext[index]);
+
+					float terrain = grid.terrain[index];
+					float sediment = grid.sediment[index];
+
+					if (capacity > sediment)
+					{
+						const float amount = settings.dissolveRate * (capacity - sediment);
+						terrain -= amount;
+						sediment += amount;
+					}
+					else
+					{
+						const float amount = settings.depositRate * (sediment - capacity);
+						terrain += amount;
+						sediment -= amount;
+					}
+
+					grid.terrainNext[index] = terrain;
+					grid.sedimentNext[index] = sediment;
+				}
+			}
+		}, DefaultMinRowsPerThread);
+
+		grid.terrain.swap(grid.terrainNext);
+		grid.sediment.swap(grid.sedimentNext);
+
+		// Carry the sediment along with the water that left each texel, so none is lost on the way,
+		// then evaporate and rain for the next step
+		ParallelFor(0, height, [&](int rowBegin, int rowEnd)
+		{
+			for (int z = rowBegin; z < rowEnd; z++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					const int index = z * width + x;
+
+					const auto leavingFraction = [&](int texel, int direction)
+					{
+						return grid.water[texel] > 0.0f ? grid.outflow[texel * OutflowCount + direction] * dt / grid.water[texel] : 0.0f;
+					};
+
+					const float leaving = leavingFraction(index, Left) + leavingFraction(index, Right) + leavingFraction(index, Up) + leavingFraction(index, Down);
+					float sediment = grid.sediment[index] * std::max(0.0f, 1.0f - leaving);
+
+					if (x > 0)
+					{
+						sediment += grid.sediment[index - 1] * leavingFraction(index - 1, Right);
+					}
+					if (x < width - 1)
+					{
+						sediment += grid.sediment[index + 1] * leavingFraction(index + 1, Left);
+					}
+					if (z > 0)
+					{
+						sediment += grid.sediment[index - width] * leavingFraction(index - width, Down);
+					}
+					if (z < height - 1)
+					{
+						sediment += grid.sediment[index + width] * leavingFraction(index + width, Up);
+					}
+
+					grid.sedimentNext[index] = sediment;
+					grid.waterNext[index] = grid.waterNext[index] * std::max(0.0f, 1.0f - settings.evaporationRate * dt) + settings.rainRate * dt;
+				}
+			}
+		}, DefaultMinRowsPerThread);
+
+		grid.sediment.swap(grid.sedimentNext);
+		grid.water.swap(grid.waterNext);
+	}
+
+	// Whatever is still suspended settles where it is
+	for (size_t index = 0; index < texelCount; index++)
+	{
+		heights[index] = grid.terrain[index] + grid.sediment[index];
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Hydraulic erosion on a row-major heightfield: rolling droplets, or a shallow water grid.
+
+#include <vector>
+
+class HydraulicErosion
+{
+public:
+	struct DropletSettings
+	{
+		int dropletCount = 20000;
+		int maxLifetime = 30;					// steps; each moves the droplet at most one texel
+		int erosionRadius = 3;					// texels eroded around the droplet
+		float inertia = 0.05f;					// 0 follows the slope exactly, 1 never turns
+		float sedimentCapacityFactor = 4.0f;
+		float minSedimentCapacity = 0.01f;
+		float erodeSpeed = 0.3f;
+		float depositSpeed = 0.3f;
+		float evaporateSpeed = 0.01f;
+		float gravity = 4.0f;
+		float initialSpeed = 1.0f;
+		float initialWater = 1.0f;
+	};
+
+	struct GridSettings
+	{
+		int iterations = 300;
+		float timeStep = 0.05f;
+		float rainRate = 0.1f;					// water height added per second
+		float gravity = 9.81f;
+		float sedimentCapacity = 0.1f;
+		float dissolveRate = 0.3f;
+		float depositRate = 0.3f;
+		float evaporationRate = 0.5f;			// fraction of the water lost per second
+		float minTilt = 0.05f;					// lets flat texels still carry some sediment
+	};
+
+public:
+	HydraulicErosion();
+
+	// Simulates settings.dropletCount droplets. Deterministic for a given seed.
+	void ErodeDroplets(float* heights, int width, int height, const DropletSettings& settings, unsigned int seed);
+
+	// Runs settings.iterations steps of the shallow water model, then settles any sediment still
+	// suspended back onto the terrain. The model's twelve per-texel planes are allocated for the
+	// call and released when it returns.
+	void ErodeGrid(float* heights, int width, int height, const GridSettings& settings);
+
+private:
+	struct BrushTap
+	{
+		int offsetX, offsetZ;
+		float weight;
+	};
+
+	void BuildBrush(int radius);
+	void RunDroplet(float* heights, int width, int height, const DropletSettings& settings, float x, float z) const;
+
+private:
+	// Erosion brush: texels within the radius, weighted by distance and summing to 1
+	std::vector<BrushTap> m_brush;
+	int m_brushRadius;
+
+	// Droplet start positions (x, z pairs), grouped by tile
+	std::vector<float> m_dropletPositions;
+	std::vector<float> m_tiledPositions;
+	std::vector<int> m_tileStarts;
+	std::vector<int> m_phaseTiles;
+};
@@ -1,39 +1,199 @@
-#include "pch.h"
 #include "LSystem.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // Below this many symbols per thread the threads cost more than they save.
+    const int MinSymbolsPerThread = 1 << 16;
+
+    size_t ToIndex(char c)
+    {
+        return static_cast<unsigned char>(c);
+    }
+}
 
 LSystem::LSystem(const std::string& axiom, const std::vector<std::pair<char, std::string>>& rules, int iterations)
-    : currentString(axiom), productionRules(rules), iterations(iterations) {}
+    : axiom(axiom), currentBuffer(0), iterations(iterations)
+{
+    buffers[0] = axiom;
+
+    // The pool starts with every symbol once, which is where rule-less symbols point.
+    ruleSymbols.resize(256);
+    for (int c = 0; c < 256; c++)
+    {
+        ruleSymbols[c] = static_cast<char>(c);
+        ruleOffset[c] = c;
+        expansionLength[c] = 1;
+    }
+
+    // The first rule for a symbol wins, as in a linear search over the rules.
+    std::fill(std::begin(hasRule), std::end(hasRule), false);
+    for (const auto& rule : rules)
+    {
+        const size_t index = ToIndex(rule.first);
+        if (!hasRule[index])
+        {
+            ruleOffset[index] = ruleSymbols.size();
+            expansionLength[index] = rule.second.size();
+            ruleSymbols += rule.second;
+            hasRule[index] = true;
+        }
+    }
+}
 
 void LSystem::Generate()
 {
     for (int i = 0; i < iterations; ++i)
     {
-        std::string nextString;
+        Rewrite(buffers[currentBuffer], buffers[1 - currentBuffer]);
+        currentBuffer = 1 - currentBuffer;
+    }
+}
+
+void LSystem::Rewrite(const std::string& source, std::string& destination)
+{
+    const size_t symbolCount = source.size();
+    const int blockCount = static_cast<int>(std::max<size_t>(1, std::min<size_t>(GetWorkerThreadCount(), symbolCount / MinSymbolsPerThread)));
+    const size_t symbolsPerBlock = (symbolCount + blockCount - 1) / blockCount;
+
+    // Pass 1: output size of each block, then an exclusive prefix sum gives each block's write offset.
+    blockOffsets.assign(blockCount + 1, 0);
+    ParallelFor(0, blockCount, [&](int blockBegin, int blockEnd)
+    {
+        for (int block = blockBegin; block < blockEnd; block++)
+        {
+            const size_t begin = block * symbolsPerBlock;
+            const size_t end = std::min(symbolCount, begin + symbolsPerBlock);
+
+            size_t length = 0;
+            for (size_t i = begin; i < end; i++)
+            {
+                length += expansionLength[ToIndex(source[i])];
+            }
+            blockOffsets[block + 1] = length;
+        }
+    });
+
+    for (int block = 0; block < blockCount; block++)
+    {
+        blockOffsets[block + 1] += blockOffsets[block];
+    }
 
-        for (char c : currentString)
+    // Exact size; keeps the capacity from earlier generations.
+    destination.resize(blockOffsets[blockCount]);
+    char* output = &destination[0];
+    const char* rules = ruleSymbols.data();
+
+    // Pass 2: every block expands into its own slice of the output.
+    ParallelFor(0, blockCount, [&](int blockBegin, int blockEnd)
+    {
+        for (int block = blockBegin; block < blockEnd; block++)
         {
-            bool ruleFound = false;
+            const size_t begin = block * symbolsPerBlock;
+            const size_t end = std::min(symbolCount, begin + symbolsPerBlock);
+            char* write = output + blockOffsets[block];
+
+            for (size_t i = begin; i < end; i++)
+            {
+                const size_t symbol = ToIndex(source[i]);
+                std::memcpy(write, rules + ruleOffset[symbol], expansionLength[symbol]);
+                write += expansionLength[symbol];
+            }
+        }
+    });
+}
+
+size_t LSystem::GetLengthAfter(int generations) const
+{
+    // Count of each symbol, advanced one generation at a time.
+    std::vector<size_t> counts(256, 0);
+    for (char c : buffers[currentBuffer])
+    {
+        counts[ToIndex(c)]++;
+    }
 
-            for (const auto& rule : productionRules)
+    for (int generation = 0; generation < generations; generation++)
+    {
+        std::vector<size_t> next(256, 0);
+        for (int c = 0; c < 256; c++)
+        {
+            if (counts[c] == 0)
             {
-                if (c == rule.first)
-                {
-                    nextString += rule.second;
-                    ruleFound = true;
-                    break;
-                }
+                continue;
             }
 
-            if (!ruleFound)
+            for (size_t n = 0; n < expansionLength[c]; n++)
             {
-                nextString += c;
+                next[ToIndex(ruleSymbols[ruleOffset[c] + n])] += counts[c];
             }
         }
-        currentString = nextString;
+        counts.swap(next);
+    }
+
+    size_t length = 0;
+    for (size_t count : counts)
+    {
+        length += count;
     }
+
+    return length;
 }
 
 const std::string& LSystem::GetCurrentString() const
 {
-    return currentString;
+    return buffers[currentBuffer];
+}
+
+LSystem::Expansion::Expansion(const LSystem& lsystem)
+    : lsystem(lsystem)
+{
+    frames.reserve(lsystem.iterations + 1);
+
+    if (!lsystem.axiom.empty())
+    {
+        const char* axiom = lsystem.axiom.data();
+        frames.push_back({ axiom, axiom + lsystem.axiom.size(), 0 });
+    }
+}
+
+bool LSystem::Expansion::Next(char& symbol)
+{
+    while (!frames.empty())
+    {
+        Frame& frame = frames.back();
+        if (frame.next == frame.end)
+        {
+            frames.pop_back();
+            continue;
+        }
+
+        const char c = *frame.next++;
+        const size_t index = ToIndex(c);
+
+        // Symbols without a rule, or in the final generation, are emitted as they are.
+        if (frame.generation == lsystem.iterations || !lsystem.hasRule[index])
+        {
+            symbol = c;
+            return true;
+        }
+
+        const char* replacement = lsystem.ruleSymbols.data() + lsystem.ruleOffset[index];
+        const int generation = frame.generation + 1;
+        frames.push_back({ replacement, replacement + lsystem.expansionLength[index], generation });
+    }
+
+    return false;
+}
+
+size_t LSystem::Expansion::Read(char* symbols, size_t capacity)
+{
+    size_t count = 0;
+    while (count < capacity && Next(symbols[count]))
+    {
+        count++;
+    }
+
+    return count;
 }
@@ -3,15 +3,65 @@
 #include <vector>
 #include <stack>
 
+// Rewrites every symbol of the current string in parallel each generation.
+// Rules live in a 256-entry table indexed by symbol, the exact size of the next generation is
+// known from a prefix sum over per-block output sizes before anything is written, and the two
+// generation buffers are reused, so a generation costs no allocations once the buffers have grown.
 class LSystem
 {
+public:
+    // Depth-first walk over the symbols of the final generation that never builds any generation's
+    // string. Holds one frame per generation, so memory is bounded by the iteration count rather
+    // than the (exponential) length of the result.
+    class Expansion
+    {
+    public:
+        explicit Expansion(const LSystem& lsystem);
+
+        // Next symbol of the final generation; false once every symbol has been produced.
+        bool Next(char& symbol);
+
+        // Fills up to capacity symbols and returns how many were written (0 at the end).
+        size_t Read(char* symbols, size_t capacity);
+
+    private:
+        struct Frame
+        {
+            const char* next;
+            const char* end;
+            int generation;
+        };
+
+        const LSystem& lsystem;
+        std::vector<Frame> frames;
+    };
+
 public:
     LSystem(const std::string& axiom, const std::vector<std::pair<char, std::string>>& rules, int iterations);
     void Generate();
     const std::string& GetCurrentString() const;
 
+    // Streams the axiom expanded by the iteration count, the same symbols Generate produces.
+    Expansion Expand() const { return Expansion(*this); }
+
+    // Length of the string after the given number of generations, without generating it.
+    size_t GetLengthAfter(int generations) const;
+
+private:
+    void Rewrite(const std::string& source, std::string& destination);
+
 private:
-    std::string currentString;
-    std::vector<std::pair<char, std::string>> productionRules;
+    std::string axiom;
+    std::string buffers[2];
+    int currentBuffer;
+
+    // Replacement for each symbol, as a slice of ruleSymbols; symbols without a rule map to themselves.
+    std::string ruleSymbols;
+    size_t ruleOffset[256];
+    size_t expansionLength[256];
+    bool hasRule[256];
     int iterations;
-};
\ No newline at end of file
+
+    // Output offset of each block of the generation being rewritten, reused between generations.
+    std::vector<size_t> blockOffsets;
+};
@@ -0,0 +1,471 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+	// Forsyth's scoring constants; the scoring cache is larger than the simulated one on purpose.
+	const int ScoringCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+	const int MaxValenceScore = 32;
+
+	struct VertexScoreTable
+	{
+		float cache[ScoringCacheSize];
+		float valence[MaxValenceScore];
+
+		VertexScoreTable()
+		{
+			for (int position = 0; position < ScoringCacheSize; position++)
+			{
+				if (position < 3)
+				{
+					// The triangle just drawn: its vertices get a fixed score so that the next
+					// triangle does not simply reuse the same edge.
+					cache[position] = LastTriangleScore;
+				}
+				else
+				{
+					const float scale = 1.0f / static_cast<float>(ScoringCacheSize - 3);
+					cache[position] = std::pow(1.0f - static_cast<float>(position - 3) * scale, CacheDecayPower);
+				}
+			}
+
+			valence[0] = 0.0f;
+			for (int remaining = 1; remaining < MaxValenceScore; remaining++)
+			{
+				valence[remaining] = ValenceBoostScale * std::pow(static_cast<float>(remaining), -ValenceBoostPower);
+			}
+		}
+
+		float Score(int cachePosition, uint32_t remainingTriangles) const
+		{
+			if (remainingTriangles == 0)
+			{
+				return -1.0f;
+			}
+
+			const float valenceScore = remainingTriangles < MaxValenceScore ? valence[remainingTriangles] :
+				ValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+
+			return (cachePosition >= 0 ? cache[cachePosition] : 0.0f) + valenceScore;
+		}
+	};
+
+	uint32_t HashVertex(const unsigned char* vertex, size_t vertexStride)
+	{
+		// FNV-1a
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < vertexStride; i++)
+		{
+			hash = (hash ^ vertex[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	const float* GetPosition(const void* vertices, size_t vertexStride, uint32_t vertex)
+	{
+		return reinterpret_cast<const float*>(static_cast<const unsigned char*>(vertices) + vertex * vertexStride);
+	}
+}
+
+namespace MeshOptimizer
+{
+	float ComputeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return 0.0f;
+		}
+
+		// FIFO cache: a vertex is resident while it was inserted within the last cacheSize misses.
+		std::vector<size_t> insertedAt(vertexCount, 0);
+		size_t misses = 0;
+
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			const uint32_t vertex = indices[i];
+
+			if (insertedAt[vertex] == 0 || misses - insertedAt[vertex] + 1 > static_cast<size_t>(cacheSize))
+			{
+				misses++;
+				insertedAt[vertex] = misses;
+			}
+		}
+
+		return static_cast<float>(misses) / static_cast<float>(triangleCount);
+	}
+
+	size_t WeldVertices(void* vertices, size_t vertexStride, size_t vertexCount, uint32_t* indices, size_t indexCount)
+	{
+		unsigned char* bytes = static_cast<unsigned char*>(vertices);
+
+		size_t tableSize = 16;
+		while (tableSize < vertexCount * 2)
+		{
+			tableSize *= 2;
+		}
+
+		const uint32_t emptySlot = UINT32_MAX;
+		const size_t tableMask = tableSize - 1;
+		std::vector<uint32_t> table(tableSize, emptySlot);
+		std::vector<uint32_t> remap(vertexCount);
+		size_t uniqueCount = 0;
+
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			const unsigned char* data = bytes + vertex * vertexStride;
+
+			size_t slot = HashVertex(data, vertexStride) & tableMask;
+			while (table[slot] != emptySlot && std::memcmp(bytes + table[slot] * vertexStride, data, vertexStride) != 0)
+			{
+				slot = (slot + 1) & tableMask;
+			}
+
+			if (table[slot] == emptySlot)
+			{
+				// Unique vertices are moved down in place; the slot always points at the compacted copy.
+				if (uniqueCount != vertex)
+				{
+					std::memcpy(bytes + uniqueCount * vertexStride, data, vertexStride);
+				}
+
+				table[slot] = static_cast<uint32_t>(uniqueCount++);
+			}
+
+			remap[vertex] = table[slot];
+		}
+
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			indices[i] = remap[indices[i]];
+		}
+
+		return uniqueCount;
+	}
+
+	void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+	{
+		static const VertexScoreTable scoreTable;
+
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// Triangles using each vertex; a vertex's remaining triangles stay at the front of its range.
+		std::vector<uint32_t> remaining(vertexCount, 0);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			remaining[indices[i]]++;
+		}
+
+		std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			firstTriangle[vertex + 1] = firstTriangle[vertex] + remaining[vertex];
+		}
+
+		std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+		std::vector<uint32_t> fill(firstTriangle.begin(), firstTriangle.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+		{
+			vertexTriangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			vertexScore[vertex] = scoreTable.Score(-1, remaining[vertex]);
+		}
+
+		std::vector<float> triangleScore(triangleCount);
+		for (size_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			const uint32_t* corners = indices + triangle * 3;
+			triangleScore[triangle] = vertexScore[corners[0]] + vertexScore[corners[1]] + vertexScore[corners[2]];
+		}
+
+		const std::vector<uint32_t> source(indices, indices + triangleCount * 3);
+		std::vector<bool> emitted(triangleCount, false);
+
+		uint32_t cache[ScoringCacheSize + 3];
+		uint32_t nextCache[ScoringCacheSize + 3];
+		int cacheCount = 0;
+
+		size_t bestTriangle = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+		size_t searchCursor = 0;
+
+		for (size_t output = 0; output < triangleCount; output++)
+		{
+			if (bestTriangle == SIZE_MAX)
+			{
+				// Nothing in the cache has triangles left: continue with the next unused triangle.
+				while (emitted[searchCursor])
+				{
+					searchCursor++;
+				}
+				bestTriangle = searchCursor;
+			}
+
+			const uint32_t* corners = &source[bestTriangle * 3];
+			indices[output * 3 + 0] = corners[0];
+			indices[output * 3 + 1] = corners[1];
+			indices[output * 3 + 2] = corners[2];
+			emitted[bestTriangle] = true;
+
+			// Remove the triangle from its vertices' lists.
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const uint32_t vertex = corners[corner];
+				uint32_t* triangles = &vertexTriangles[firstTriangle[vertex]];
+				const uint32_t count = remaining[vertex];
+
+				for (uint32_t i = 0; i < count; i++)
+				{
+					if (triangles[i] == bestTriangle)
+					{
+						std::swap(triangles[i], triangles[count - 1]);
+						break;
+					}
+				}
+
+				remaining[vertex]--;
+			}
+
+			// The triangle's vertices move to the front of the cache, the rest shift back.
+			int nextCount = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				nextCache[nextCount++] = corners[corner];
+			}
+
+			for (int i = 0; i < cacheCount; i++)
+			{
+				const uint32_t vertex = cache[i];
+				if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2])
+				{
+					nextCache[nextCount++] = vertex;
+				}
+			}
+
+			// Rescore everything that was or is in the cache and find the best triangle among them.
+			bestTriangle = SIZE_MAX;
+			float bestScore = -1.0f;
+
+			for (int i = 0; i < nextCount; i++)
+			{
+				const uint32_t vertex = nextCache[i];
+				const int position = i < ScoringCacheSize ? i : -1;
+
+				cachePosition[vertex] = position;
+
+				const float score = scoreTable.Score(position, remaining[vertex]);
+				const float delta = score - vertexScore[vertex];
+				vertexScore[vertex] = score;
+
+				const uint32_t* triangles = &vertexTriangles[firstTriangle[vertex]];
+				for (uint32_t j = 0; j < remaining[vertex]; j++)
+				{
+					const uint32_t triangle = triangles[j];
+					triangleScore[triangle] += delta;
+
+					if (triangleScore[triangle] > bestScore)
+					{
+						bestScore = triangleScore[triangle];
+						bestTriangle = triangle;
+					}
+				}
+			}
+
+			cacheCount = std::min(nextCount, ScoringCacheSize);
+			std::copy(nextCache, nextCache + cacheCount, cache);
+		}
+	}
+
+	void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexStride, size_t vertexCount,
+		float threshold)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount < 2)
+		{
+			return;
+		}
+
+		// Cluster boundaries: triangles whose three vertices all miss the cache start a new cluster,
+		// so reordering whole clusters costs the cache little.
+		std::vector<size_t> clusterStarts;
+		{
+			std::vector<size_t> insertedAt(vertexCount, 0);
+			size_t misses = 0;
+
+			for (size_t triangle = 0; triangle < triangleCount; triangle++)
+			{
+				int triangleMisses = 0;
+
+				for (int corner = 0; corner < 3; corner++)
+				{
+					const uint32_t vertex = indices[triangle * 3 + corner];
+					if (insertedAt[vertex] == 0 || misses - insertedAt[vertex] + 1 > static_cast<size_t>(SimulatedCacheSize))
+					{
+						misses++;
+						insertedAt[vertex] = misses;
+						triangleMisses++;
+					}
+				}
+
+				if (triangle == 0 || triangleMisses == 3)
+				{
+					clusterStarts.push_back(triangle);
+				}
+			}
+		}
+
+		if (clusterStarts.size() < 2)
+		{
+			return;
+		}
+
+		// Area weighted centroid and normal of every cluster and of the whole mesh.
+		const size_t clusterCount = clusterStarts.size();
+		std::vector<float> clusterCentroids(clusterCount * 3, 0.0f);
+		std::vector<float> clusterNormals(clusterCount * 3, 0.0f);
+		std::vector<float> clusterAreas(clusterCount, 0.0f);
+		float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+		float meshArea = 0.0f;
+
+		for (size_t cluster = 0; cluster < clusterCount; cluster++)
+		{
+			const size_t end = cluster + 1 < clusterCount ? clusterStarts[cluster + 1] : triangleCount;
+
+			for (size_t triangle = clusterStarts[cluster]; triangle < end; triangle++)
+			{
+				const float* p0 = GetPosition(vertices, vertexStride, indices[triangle * 3 + 0]);
+				const float* p1 = GetPosition(vertices, vertexStride, indices[triangle * 3 + 1]);
+				const float* p2 = GetPosition(vertices, vertexStride, indices[triangle * 3 + 2]);
+
+				const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				const float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				const float area = 0.5f * std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+				for (int axis = 0; axis < 3; axis++)
+				{
+					const float centre = (p0[axis] + p1[axis] + p2[axis]) / 3.0f;
+					clusterCentroids[cluster * 3 + axis] += centre * area;
+					clusterNormals[cluster * 3 + axis] += normal[axis];
+					meshCentroid[axis] += centre * area;
+				}
+
+				clusterAreas[cluster] += area;
+				meshArea += area;
+			}
+		}
+
+		if (meshArea <= 0.0f)
+		{
+			return;
+		}
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			meshCentroid[axis] /= meshArea;
+		}
+
+		// Clusters facing away from the centre are likely in front, so they are drawn first.
+		std::vector<float> sortKeys(clusterCount, 0.0f);
+		for (size_t cluster = 0; cluster < clusterCount; cluster++)
+		{
+			const float* normal = &clusterNormals[cluster * 3];
+			const float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			if (clusterAreas[cluster] <= 0.0f || normalLength <= 0.0f)
+			{
+				continue;
+			}
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				const float offset = clusterCentroids[cluster * 3 + axis] / clusterAreas[cluster] - meshCentroid[axis];
+				sortKeys[cluster] += offset * normal[axis] / normalLength;
+			}
+		}
+
+		std::vector<size_t> order(clusterCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve(triangleCount * 3);
+
+		for (size_t cluster : order)
+		{
+			const size_t end = cluster + 1 < clusterCount ? clusterStarts[cluster + 1] : triangleCount;
+			sorted.insert(sorted.end(), indices + clusterStarts[cluster] * 3, indices + end * 3);
+		}
+
+		const float acmrBefore = ComputeACMR(indices, triangleCount * 3, vertexCount);
+		const float acmrAfter = ComputeACMR(sorted.data(), sorted.size(), vertexCount);
+
+		if (acmrAfter <= acmrBefore * threshold)
+		{
+			std::copy(sorted.begin(), sorted.end(), indices);
+		}
+	}
+
+	size_t OptimizeVertexFetch(void* vertices, size_t vertexStride, size_t vertexCount, uint32_t* indices, size_t indexCount)
+	{
+		unsigned char* bytes = static_cast<unsigned char*>(vertices);
+		const uint32_t unused = UINT32_MAX;
+		std::vector<uint32_t> remap(vertexCount, unused);
+		uint32_t nextVertex = 0;
+
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			uint32_t& target = remap[indices[i]];
+			if (target == unused)
+			{
+				target = nextVertex++;
+			}
+			indices[i] = target;
+		}
+
+		const std::vector<unsigned char> original(bytes, bytes + vertexCount * vertexStride);
+
+		for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		{
+			if (remap[vertex] != unused)
+			{
+				std::memcpy(bytes + remap[vertex] * vertexStride, &original[vertex * vertexStride], vertexStride);
+			}
+		}
+
+		return nextVertex;
+	}
+
+	MeshOptimizeStats OptimizeMesh(void* vertices, size_t vertexStride, size_t& vertexCount, uint32_t* indices, size_t indexCount)
+	{
+		MeshOptimizeStats stats;
+		stats.verticesBefore = vertexCount;
+		stats.acmrBefore = ComputeACMR(indices, indexCount, vertexCount);
+
+		vertexCount = WeldVertices(vertices, vertexStride, vertexCount, indices, indexCount);
+		OptimizeVertexCache(indices, indexCount, vertexCount);
+		OptimizeOverdraw(indices, indexCount, vertices, vertexStride, vertexCount);
+		vertexCount = OptimizeVertexFetch(vertices, vertexStride, vertexCount, indices, indexCount);
+
+		stats.verticesAfter = vertexCount;
+		stats.acmrAfter = ComputeACMR(indices, indexCount, vertexCount);
+
+		return stats;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Vertex welding and index/vertex reordering for loaded meshes.
+
+#include <cstddef>
+#include <cstdint>
+
+struct MeshOptimizeStats
+{
+	size_t verticesBefore;
+	size_t verticesAfter;
+	float acmrBefore;	// average cache miss ratio: vertex shader runs per triangle
+	float acmrAfter;
+};
+
+namespace MeshOptimizer
+{
+	// Transform cache simulated by ComputeACMR; 16 entries is typical of current hardware.
+	const int SimulatedCacheSize = 16;
+
+	float ComputeACMR(const uint32_t* indices, size_t indexCount, size_t vertexCount, int cacheSize = SimulatedCacheSize);
+
+	// Returns the new vertex count; the vertices are compacted in place and indices rewritten.
+	size_t WeldVertices(void* vertices, size_t vertexStride, size_t vertexCount, uint32_t* indices, size_t indexCount);
+
+	void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	// Expects an index buffer already ordered by OptimizeVertexCache. threshold is the ACMR increase allowed.
+	void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexStride, size_t vertexCount,
+		float threshold = 1.05f);
+
+	// Returns the new vertex count; vertices no index refers to are dropped.
+	size_t OptimizeVertexFetch(void* vertices, size_t vertexStride, size_t vertexCount, uint32_t* indices, size_t indexCount);
+
+	// Runs every pass above in order.
+	MeshOptimizeStats OptimizeMesh(void* vertices, size_t vertexStride, size_t& vertexCount, uint32_t* indices, size_t indexCount);
+}
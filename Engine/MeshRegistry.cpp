@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "MeshRegistry.h"
+#include "modelclass.h"
+#include "ObjLoader.h"
+#include <mutex>
+
+namespace
+{
+	struct Registry
+	{
+		std::mutex mutex;
+		std::map<std::string, std::weak_ptr<const MeshAsset>> meshes;
+
+		// Drops entries whose mesh has been released, so the map only grows with live meshes.
+		void Prune()
+		{
+			for (auto entry = meshes.begin(); entry != meshes.end();)
+			{
+				entry = entry->second.expired() ? meshes.erase(entry) : std::next(entry);
+			}
+		}
+	};
+
+	Registry& GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+}
+
+bool MeshAsset::Create(ID3D11Device* device, const void* vertices, unsigned int vertexStride, int vertexCount, const uint32_t* indices, int indexCount)
+{
+	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
+	D3D11_SUBRESOURCE_DATA vertexData, indexData;
+	HRESULT result;
+
+	if (vertexCount <= 0 || indexCount <= 0)
+	{
+		return false;
+	}
+
+	// Bounding radius and box extents
+	float maxDistanceSquared = 0.0f;
+	DirectX::SimpleMath::Vector3 minBounds(FLT_MAX, FLT_MAX, FLT_MAX);
+	DirectX::SimpleMath::Vector3 maxBounds(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	const unsigned char* vertex = static_cast<const unsigned char*>(vertices);
+	for (int i = 0; i < vertexCount; i++, vertex += vertexStride)
+	{
+		const DirectX::SimpleMath::Vector3& position = *reinterpret_cast<const DirectX::SimpleMath::Vector3*>(vertex);
+
+		maxDistanceSquared = std::max(maxDistanceSquared, position.LengthSquared());
+		minBounds = DirectX::SimpleMath::Vector3::Min(minBounds, position);
+		maxBounds = DirectX::SimpleMath::Vector3::Max(maxBounds, position);
+	}
+
+	boundingRadius = std::sqrt(maxDistanceSquared);
+	extents = (maxBounds - minBounds) * 0.5f;
+
+	// Shared meshes are never written after creation, so both buffers are immutable.
+	vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	vertexBufferDesc.ByteWidth = vertexStride * vertexCount;
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDesc.CPUAccessFlags = 0;
+	vertexBufferDesc.MiscFlags = 0;
+	vertexBufferDesc.StructureByteStride = 0;
+
+	vertexData.pSysMem = vertices;
+	vertexData.SysMemPitch = 0;
+	vertexData.SysMemSlicePitch = 0;
+
+	result = device->CreateBuffer(&vertexBufferDesc, &vertexData, vertexBuffer.ReleaseAndGetAddressOf());
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	std::vector<uint16_t> shortIndices;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+
+	if (vertexCount <= UINT16_MAX + 1)
+	{
+		shortIndices.assign(indices, indices + indexCount);
+		indexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
+	indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	indexBufferDesc.ByteWidth = (shortIndices.empty() ? sizeof(uint32_t) : sizeof(uint16_t)) * indexCount;
+	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexBufferDesc.CPUAccessFlags = 0;
+	indexBufferDesc.MiscFlags = 0;
+	indexBufferDesc.StructureByteStride = 0;
+
+	indexData.pSysMem = shortIndices.empty() ? static_cast<const void*>(indices) : shortIndices.data();
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+
+	result = device->CreateBuffer(&indexBufferDesc, &indexData, indexBuffer.ReleaseAndGetAddressOf());
+	if (FAILED(result))
+	{
+		return false;
+	}
+
+	this->vertexCount = vertexCount;
+	this->indexCount = indexCount;
+
+	return true;
+}
+
+std::shared_ptr<const MeshAsset> MeshRegistry::Acquire(ID3D11Device* device, const std::string& path)
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	auto found = registry.meshes.find(path);
+	if (found != registry.meshes.end())
+	{
+		if (std::shared_ptr<const MeshAsset> mesh = found->second.lock())
+		{
+			return mesh;
+		}
+	}
+
+	ObjMesh source;
+	if (!ObjLoader::Load(path, source))
+	{
+		return nullptr;
+	}
+
+	std::vector<ModelClass::VertexType> vertices(source.vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const ObjVertex& vertex = source.vertices[i];
+
+		vertices[i].position = DirectX::SimpleMath::Vector3(vertex.position[0], vertex.position[1], vertex.position[2]);
+		vertices[i].texture = DirectX::SimpleMath::Vector2(vertex.texture[0], vertex.texture[1]);
+		vertices[i].normal = DirectX::SimpleMath::Vector3(vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+		vertices[i].colour = DirectX::SimpleMath::Vector4::Zero;
+	}
+
+	auto mesh = std::make_shared<MeshAsset>();
+	if (!mesh->Create(device, vertices.data(), sizeof(ModelClass::VertexType), static_cast<int>(vertices.size()),
+		source.indices.data(), static_cast<int>(source.indices.size())))
+	{
+		return nullptr;
+	}
+
+	registry.Prune();
+	registry.meshes[path] = mesh;
+
+	return mesh;
+}
+
+int MeshRegistry::GetLiveMeshCount()
+{
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	registry.Prune();
+
+	return static_cast<int>(registry.meshes.size());
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// Reference-counted cache of GPU meshes loaded from model files, shared by every model that loads the same file.
+
+#include "pch.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct MeshAsset
+{
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	int vertexCount = 0;
+	int indexCount = 0;
+	DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;	// 16-bit whenever the vertex count allows it
+
+	// Model space bounds, before any per-model scale.
+	float boundingRadius = 0.0f;
+	DirectX::SimpleMath::Vector3 extents = DirectX::SimpleMath::Vector3::Zero;	// half the size of the bounding box
+
+	// Creates immutable buffers, narrowing the indices to 16 bits when every vertex fits.
+	// Each vertex is vertexStride bytes and starts with its float3 position.
+	bool Create(ID3D11Device* device, const void* vertices, unsigned int vertexStride, int vertexCount, const uint32_t* indices, int indexCount);
+};
+
+namespace MeshRegistry
+{
+	// Returns the shared mesh for path, loading it on first use. Vertex colours are left black; models
+	// are tinted per draw through the shader's material colour instead.
+	std::shared_ptr<const MeshAsset> Acquire(ID3D11Device* device, const std::string& path);
+
+	// Meshes currently held by at least one model.
+	int GetLiveMeshCount();
+}
@@ -0,0 +1,790 @@
+#include "ObjLoader.h"
+#include "MeshOptimizer.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const char CacheMagic[4] = { 'M', 'B', 'I', 'N' };
+	const uint32_t CacheVersion = 2;
+
+	// Below this the threads cost more than they save.
+	const size_t MinChunkBytes = 64 * 1024;
+
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t reserved;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+	};
+
+	// Read-only mapping of a whole file.
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& path)
+			: m_data(nullptr), m_size(0)
+		{
+#ifdef _WIN32
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				return;
+			}
+
+			LARGE_INTEGER size;
+			if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+			{
+				HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping)
+				{
+					m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+					m_size = m_data ? static_cast<size_t>(size.QuadPart) : 0;
+
+					// The view keeps the mapping alive.
+					CloseHandle(mapping);
+				}
+			}
+
+			CloseHandle(file);
+#else
+			const int file = open(path.c_str(), O_RDONLY);
+			if (file < 0)
+			{
+				return;
+			}
+
+			struct stat info;
+			if (fstat(file, &info) == 0 && info.st_size > 0)
+			{
+				void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+				if (data != MAP_FAILED)
+				{
+					m_data = static_cast<const char*>(data);
+					m_size = static_cast<size_t>(info.st_size);
+				}
+			}
+
+			close(file);
+#endif
+		}
+
+		~MappedFile()
+		{
+			if (!m_data)
+			{
+				return;
+			}
+
+#ifdef _WIN32
+			UnmapViewOfFile(m_data);
+#else
+			munmap(const_cast<char*>(m_data), m_size);
+#endif
+		}
+
+		const char* GetData() const { return m_data; }
+		size_t GetSize() const { return m_size; }
+		bool IsOpen() const { return m_data != nullptr; }
+
+	private:
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		const char* m_data;
+		size_t m_size;
+	};
+
+	bool GetFileInfo(const std::string& path, uint64_t& size, int64_t& time)
+	{
+#ifdef _WIN32
+		struct _stat64 info;
+		if (_stat64(path.c_str(), &info) != 0)
+		{
+			return false;
+		}
+#else
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+		{
+			return false;
+		}
+#endif
+
+		size = static_cast<uint64_t>(info.st_size);
+		time = static_cast<int64_t>(info.st_mtime);
+		return true;
+	}
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p))
+		{
+			p++;
+		}
+
+		return p;
+	}
+
+	// End of the line starting at p, excluding the newline.
+	inline const char* FindLineEnd(const char* p, const char* end)
+	{
+		const void* newline = std::memchr(p, '\n', end - p);
+		return newline ? static_cast<const char*>(newline) : end;
+	}
+
+	// Decimal float in the style of from_chars: no locale, no allocation, no stream state.
+	// Up to 19 significant digits are kept; the result is one scaling of the exact mantissa.
+	bool ParseFloat(const char*& p, const char* end, float& value)
+	{
+		static const double powersOfTen[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const char* q = p;
+		bool negative = false;
+
+		if (q < end && (*q == '-' || *q == '+'))
+		{
+			negative = *q == '-';
+			q++;
+		}
+
+		uint64_t mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+
+		for (; q < end && IsDigit(*q); q++)
+		{
+			anyDigits = true;
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*q - '0');
+				significantDigits += mantissa != 0 ? 1 : 0;
+			}
+			else
+			{
+				exponent++;
+			}
+		}
+
+		if (q < end && *q == '.')
+		{
+			for (q++; q < end && IsDigit(*q); q++)
+			{
+				anyDigits = true;
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + static_cast<uint64_t>(*q - '0');
+					significantDigits += mantissa != 0 ? 1 : 0;
+					exponent--;
+				}
+			}
+		}
+
+		if (!anyDigits)
+		{
+			return false;
+		}
+
+		if (q < end && (*q == 'e' || *q == 'E'))
+		{
+			const char* e = q + 1;
+			bool negativeExponent = false;
+
+			if (e < end && (*e == '-' || *e == '+'))
+			{
+				negativeExponent = *e == '-';
+				e++;
+			}
+
+			if (e < end && IsDigit(*e))
+			{
+				int explicitExponent = 0;
+				for (; e < end && IsDigit(*e); e++)
+				{
+					explicitExponent = std::min(explicitExponent * 10 + (*e - '0'), 100000);
+				}
+
+				exponent += negativeExponent ? -explicitExponent : explicitExponent;
+				q = e;
+			}
+		}
+
+		double result = static_cast<double>(mantissa);
+
+		if (mantissa != 0 && exponent > 0)
+		{
+			result *= exponent <= 22 ? powersOfTen[exponent] : std::pow(10.0, exponent);
+		}
+		else if (mantissa != 0 && exponent < 0)
+		{
+			result /= exponent >= -22 ? powersOfTen[-exponent] : std::pow(10.0, -exponent);
+		}
+
+		value = static_cast<float>(negative ? -result : result);
+		p = q;
+		return true;
+	}
+
+	bool ParseIndex(const char*& p, const char* end, int64_t& value)
+	{
+		const char* q = p;
+		bool negative = false;
+
+		if (q < end && (*q == '-' || *q == '+'))
+		{
+			negative = *q == '-';
+			q++;
+		}
+
+		if (q >= end || !IsDigit(*q))
+		{
+			return false;
+		}
+
+		int64_t result = 0;
+		for (; q < end && IsDigit(*q); q++)
+		{
+			result = std::min<int64_t>(result * 10 + (*q - '0'), INT32_MAX);
+		}
+
+		value = negative ? -result : result;
+		p = q;
+		return true;
+	}
+
+	enum class LineType { Other, Position, TextureCoordinate, Normal, Face };
+
+	// Classifies the line and moves p past its keyword.
+	LineType ClassifyLine(const char*& p, const char* end)
+	{
+		p = SkipSpaces(p, end);
+
+		const size_t length = end - p;
+		const auto keywordIs = [&](const char* keyword, size_t keywordLength)
+		{
+			return length >= keywordLength && std::memcmp(p, keyword, keywordLength) == 0 &&
+				(length == keywordLength || IsSpace(p[keywordLength]));
+		};
+
+		LineType type = LineType::Other;
+		size_t keywordLength = 0;
+
+		if (keywordIs("v", 1)) { type = LineType::Position; keywordLength = 1; }
+		else if (keywordIs("vt", 2)) { type = LineType::TextureCoordinate; keywordLength = 2; }
+		else if (keywordIs("vn", 2)) { type = LineType::Normal; keywordLength = 2; }
+		else if (keywordIs("f", 1)) { type = LineType::Face; keywordLength = 1; }
+
+		p += keywordLength;
+		return type;
+	}
+
+	// Resolved, zero-based attribute indices of one face corner; -1 when the corner has none.
+	struct Corner
+	{
+		int32_t position, texture, normal;
+
+		bool operator==(const Corner& other) const
+		{
+			return position == other.position && texture == other.texture && normal == other.normal;
+		}
+	};
+
+	// One line-aligned slice of the file, with its attribute counts and output offsets.
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+		size_t positions, textureCoordinates, normals, corners;
+		size_t firstPosition, firstTextureCoordinate, firstNormal, firstCorner;
+		bool failed;
+	};
+
+	size_t CountFaceCorners(const char* p, const char* end)
+	{
+		size_t references = 0;
+
+		while ((p = SkipSpaces(p, end)) < end)
+		{
+			references++;
+			while (p < end && !IsSpace(*p))
+			{
+				p++;
+			}
+		}
+
+		return references >= 3 ? (references - 2) * 3 : 0;
+	}
+
+	void CountChunk(Chunk& chunk)
+	{
+		for (const char* line = chunk.begin; line < chunk.end;)
+		{
+			const char* lineEnd = FindLineEnd(line, chunk.end);
+			const char* p = line;
+
+			switch (ClassifyLine(p, lineEnd))
+			{
+			case LineType::Position: chunk.positions++; break;
+			case LineType::TextureCoordinate: chunk.textureCoordinates++; break;
+			case LineType::Normal: chunk.normals++; break;
+			case LineType::Face:
+			{
+				const size_t corners = CountFaceCorners(p, lineEnd);
+				chunk.failed |= corners == 0;
+				chunk.corners += corners;
+				break;
+			}
+			default: break;
+			}
+
+			line = lineEnd + 1;
+		}
+	}
+
+	// Relative indices count back from the attributes defined so far.
+	bool ResolveIndex(int64_t index, size_t definedSoFar, int32_t& resolved)
+	{
+		if (index > 0)
+		{
+			resolved = static_cast<int32_t>(index - 1);
+			return true;
+		}
+
+		if (index < 0 && static_cast<size_t>(-index) <= definedSoFar)
+		{
+			resolved = static_cast<int32_t>(static_cast<int64_t>(definedSoFar) + index);
+			return true;
+		}
+
+		return false;
+	}
+
+	void ParseChunk(Chunk& chunk, float* positions, float* textureCoordinates, float* normals, Corner* corners)
+	{
+		size_t position = chunk.firstPosition;
+		size_t textureCoordinate = chunk.firstTextureCoordinate;
+		size_t normal = chunk.firstNormal;
+		size_t corner = chunk.firstCorner;
+		std::vector<Corner> polygon;
+
+		for (const char* line = chunk.begin; line < chunk.end && !chunk.failed;)
+		{
+			const char* lineEnd = FindLineEnd(line, chunk.end);
+			const char* p = line;
+			bool ok = true;
+
+			switch (ClassifyLine(p, lineEnd))
+			{
+			case LineType::Position:
+				for (int axis = 0; axis < 3 && ok; axis++)
+				{
+					p = SkipSpaces(p, lineEnd);
+					ok = ParseFloat(p, lineEnd, positions[position * 3 + axis]);
+				}
+				position++;
+				break;
+			case LineType::TextureCoordinate:
+				p = SkipSpaces(p, lineEnd);
+				ok = ParseFloat(p, lineEnd, textureCoordinates[textureCoordinate * 2]);
+				p = SkipSpaces(p, lineEnd);
+				if (p == lineEnd || !ParseFloat(p, lineEnd, textureCoordinates[textureCoordinate * 2 + 1]))
+				{
+					textureCoordinates[textureCoordinate * 2 + 1] = 0.0f;
+				}
+				textureCoordinate++;
+				break;
+			case LineType::Normal:
+				for (int axis = 0; axis < 3 && ok; axis++)
+				{
+					p = SkipSpaces(p, lineEnd);
+					ok = ParseFloat(p, lineEnd, normals[normal * 3 + axis]);
+				}
+				normal++;
+				break;
+			case LineType::Face:
+				polygon.clear();
+
+				while (ok && (p = SkipSpaces(p, lineEnd)) < lineEnd)
+				{
+					Corner reference = { -1, -1, -1 };
+					int64_t index;
+
+					ok = ParseIndex(p, lineEnd, index) && ResolveIndex(index, position, reference.position);
+
+					if (ok && p < lineEnd && *p == '/')
+					{
+						p++;
+						if (p < lineEnd && *p != '/')
+						{
+							ok = ParseIndex(p, lineEnd, index) && ResolveIndex(index, textureCoordinate, reference.texture);
+						}
+
+						if (ok && p < lineEnd && *p == '/')
+						{
+							p++;
+							ok = ParseIndex(p, lineEnd, index) && ResolveIndex(index, normal, reference.normal);
+						}
+					}
+
+					ok = ok && (p == lineEnd || IsSpace(*p));
+					polygon.push_back(reference);
+				}
+
+				// Fan triangulation
+				for (size_t i = 1; ok && i + 1 < polygon.size(); i++)
+				{
+					corners[corner++] = polygon[0];
+					corners[corner++] = polygon[i];
+					corners[corner++] = polygon[i + 1];
+				}
+				break;
+			default:
+				break;
+			}
+
+			chunk.failed |= !ok;
+			line = lineEnd + 1;
+		}
+	}
+
+	inline uint32_t HashCorner(const Corner& corner)
+	{
+		uint32_t hash = static_cast<uint32_t>(corner.position) * 0x9E3779B1u;
+		hash ^= static_cast<uint32_t>(corner.texture) * 0x85EBCA77u;
+		hash ^= static_cast<uint32_t>(corner.normal) * 0xC2B2AE3Du;
+		return hash ^ (hash >> 15);
+	}
+}
+
+void ObjMesh::clear()
+{
+	vertices.clear();
+	indices.clear();
+}
+
+namespace ObjLoader
+{
+	bool Load(const std::string& path, ObjMesh& mesh)
+	{
+		uint64_t sourceSize;
+		int64_t sourceTime;
+
+		if (!GetFileInfo(path, sourceSize, sourceTime))
+		{
+			return false;
+		}
+
+		const std::string cachePath = GetCachePath(path);
+
+		if (ReadCache(cachePath, sourceSize, sourceTime, mesh))
+		{
+			return true;
+		}
+
+		MappedFile file(path);
+
+		if (!file.IsOpen() || !Parse(file.GetData(), file.GetSize(), mesh))
+		{
+			return false;
+		}
+
+		// Optimised once here, so every later load gets the reordered buffers from the cache.
+		size_t vertexCount = mesh.vertices.size();
+		MeshOptimizer::OptimizeMesh(mesh.vertices.data(), sizeof(ObjVertex), vertexCount, mesh.indices.data(), mesh.indices.size());
+		mesh.vertices.resize(vertexCount);
+
+		// Best effort: a read-only install just parses every time.
+		WriteCache(cachePath, sourceSize, sourceTime, mesh);
+		return true;
+	}
+
+	bool Parse(const char* text, size_t length, ObjMesh& mesh)
+	{
+		mesh.clear();
+
+		// Split into line-aligned chunks, one per worker for large files.
+		const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(GetWorkerThreadCount(), length / MinChunkBytes));
+		const char* const end = text + length;
+		std::vector<Chunk> chunks(chunkCount);
+
+		const char* sliceBegin = text;
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			const char* sliceEnd = i + 1 == chunkCount ? end : text + length / chunkCount * (i + 1);
+			sliceEnd = std::max(sliceEnd, sliceBegin);
+			if (sliceEnd < end)
+			{
+				sliceEnd = std::min(end, FindLineEnd(sliceEnd, end) + 1);
+			}
+
+			Chunk& chunk = chunks[i];
+			std::memset(&chunk, 0, sizeof(chunk));
+			chunk.begin = sliceBegin;
+			chunk.end = sliceEnd;
+			sliceBegin = sliceEnd;
+		}
+
+		const int chunkTotal = static_cast<int>(chunkCount);
+
+		ParallelFor(0, chunkTotal, [&](int chunkBegin, int chunkEnd)
+		{
+			for (int i = chunkBegin; i < chunkEnd; i++)
+			{
+				CountChunk(chunks[i]);
+			}
+		});
+
+		// Each chunk's output starts where the previous one's ends.
+		size_t positionCount = 0, textureCoordinateCount = 0, normalCount = 0, cornerCount = 0;
+
+		for (Chunk& chunk : chunks)
+		{
+			if (chunk.failed)
+			{
+				return false;
+			}
+
+			chunk.firstPosition = positionCount;
+			chunk.firstTextureCoordinate = textureCoordinateCount;
+			chunk.firstNormal = normalCount;
+			chunk.firstCorner = cornerCount;
+
+			positionCount += chunk.positions;
+			textureCoordinateCount += chunk.textureCoordinates;
+			normalCount += chunk.normals;
+			cornerCount += chunk.corners;
+		}
+
+		if (positionCount == 0 || cornerCount == 0 || positionCount > INT32_MAX)
+		{
+			return false;
+		}
+
+		std::vector<float> positions(positionCount * 3);
+		std::vector<float> textureCoordinates(textureCoordinateCount * 2);
+		std::vector<float> normals(normalCount * 3);
+		std::vector<Corner> corners(cornerCount);
+
+		ParallelFor(0, chunkTotal, [&](int chunkBegin, int chunkEnd)
+		{
+			for (int i = chunkBegin; i < chunkEnd; i++)
+			{
+				ParseChunk(chunks[i], positions.data(), textureCoordinates.data(), normals.data(), corners.data());
+			}
+		});
+
+		for (const Chunk& chunk : chunks)
+		{
+			if (chunk.failed)
+			{
+				return false;
+			}
+		}
+
+		// Weld identical corners with an open-addressing table of unique corner indices.
+		size_t tableSize = 16;
+		while (tableSize < cornerCount * 2)
+		{
+			tableSize *= 2;
+		}
+
+		const uint32_t emptySlot = UINT32_MAX;
+		const size_t tableMask = tableSize - 1;
+		std::vector<uint32_t> table(tableSize, emptySlot);
+		std::vector<Corner> uniqueCorners;
+		uniqueCorners.reserve(cornerCount / 2);
+		mesh.indices.resize(cornerCount);
+
+		for (size_t i = 0; i < cornerCount; i++)
+		{
+			const Corner& corner = corners[i];
+
+			if (static_cast<size_t>(corner.position) >= positionCount ||
+				(corner.texture >= 0 && static_cast<size_t>(corner.texture) >= textureCoordinateCount) ||
+				(corner.normal >= 0 && static_cast<size_t>(corner.normal) >= normalCount))
+			{
+				mesh.clear();
+				return false;
+			}
+
+			size_t slot = HashCorner(corner) & tableMask;
+			while (table[slot] != emptySlot && !(uniqueCorners[table[slot]] == corner))
+			{
+				slot = (slot + 1) & tableMask;
+			}
+
+			if (table[slot] == emptySlot)
+			{
+				table[slot] = static_cast<uint32_t>(uniqueCorners.size());
+				uniqueCorners.push_back(corner);
+			}
+
+			mesh.indices[i] = table[slot];
+		}
+
+		mesh.vertices.resize(uniqueCorners.size());
+
+		for (size_t i = 0; i < uniqueCorners.size(); i++)
+		{
+			const Corner& corner = uniqueCorners[i];
+			ObjVertex& vertex = mesh.vertices[i];
+
+			std::memcpy(vertex.position, &positions[corner.position * 3], sizeof(vertex.position));
+
+			if (corner.texture >= 0)
+			{
+				std::memcpy(vertex.texture, &textureCoordinates[corner.texture * 2], sizeof(vertex.texture));
+			}
+			else
+			{
+				vertex.texture[0] = vertex.texture[1] = 0.0f;
+			}
+
+			if (corner.normal >= 0)
+			{
+				std::memcpy(vertex.normal, &normals[corner.normal * 3], sizeof(vertex.normal));
+			}
+			else
+			{
+				vertex.normal[0] = vertex.normal[1] = vertex.normal[2] = 0.0f;
+			}
+		}
+
+		return true;
+	}
+
+	std::string GetCachePath(const std::string& path)
+	{
+		return path + ".meshbin";
+	}
+
+	bool ReadCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime, ObjMesh& mesh)
+	{
+		std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			return false;
+		}
+
+		// One read of the whole file, then validate and copy out.
+		const std::streamoff fileSize = file.tellg();
+		if (fileSize < static_cast<std::streamoff>(sizeof(CacheHeader)))
+		{
+			return false;
+		}
+
+		std::vector<char> contents(static_cast<size_t>(fileSize));
+		file.seekg(0);
+
+		if (!file.read(contents.data(), fileSize))
+		{
+			return false;
+		}
+
+		CacheHeader header;
+		std::memcpy(&header, contents.data(), sizeof(header));
+
+		const size_t vertexBytes = static_cast<size_t>(header.vertexCount) * sizeof(ObjVertex);
+		const size_t indexBytes = static_cast<size_t>(header.indexCount) * sizeof(uint32_t);
+
+		if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+			header.version != CacheVersion ||
+			header.vertexStride != sizeof(ObjVertex) ||
+			header.sourceSize != sourceSize ||
+			header.sourceTime != sourceTime ||
+			contents.size() != sizeof(header) + vertexBytes + indexBytes)
+		{
+			return false;
+		}
+
+		mesh.vertices.resize(header.vertexCount);
+		mesh.indices.resize(header.indexCount);
+		std::memcpy(mesh.vertices.data(), contents.data() + sizeof(header), vertexBytes);
+		std::memcpy(mesh.indices.data(), contents.data() + sizeof(header) + vertexBytes, indexBytes);
+
+		for (uint32_t index : mesh.indices)
+		{
+			if (index >= header.vertexCount)
+			{
+				mesh.clear();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool WriteCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime, const ObjMesh& mesh)
+	{
+		std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		CacheHeader header;
+		std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+		header.version = CacheVersion;
+		header.vertexStride = sizeof(ObjVertex);
+		header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+		header.reserved = 0;
+		header.sourceSize = sourceSize;
+		header.sourceTime = sourceTime;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(ObjVertex));
+		file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+		file.close();
+
+		const bool ok = !file.fail();
+
+		if (!ok)
+		{
+			// A partial file would fail validation anyway; don't leave it around.
+			std::remove(cachePath.c_str());
+		}
+
+		return ok;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// Wavefront OBJ loading, cached as an optimised binary "<path>.meshbin" next to the OBJ.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ObjVertex
+{
+	float position[3];
+	float texture[2];
+	float normal[3];
+};
+
+struct ObjMesh
+{
+	std::vector<ObjVertex> vertices;
+	std::vector<uint32_t> indices;
+
+	void clear();
+};
+
+namespace ObjLoader
+{
+	// Loads path through its .meshbin cache, parsing and rewriting the cache when it is missing or stale.
+	bool Load(const std::string& path, ObjMesh& mesh);
+
+	// Parses OBJ text, without optimising the result.
+	bool Parse(const char* text, size_t length, ObjMesh& mesh);
+
+	std::string GetCachePath(const std::string& path);
+
+	// The cache is rejected unless its version, vertex layout and source size/time all match.
+	bool ReadCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime, ObjMesh& mesh);
+	bool WriteCache(const std::string& cachePath, uint64_t sourceSize, int64_t sourceTime, const ObjMesh& mesh);
+}
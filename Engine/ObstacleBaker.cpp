@@ -0,0 +1,315 @@
+#include "ObstacleBaker.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	const float TwoPi = 6.28318530717959f;
+
+	// Transforms and writes one vertex of a segment. Local x/z span the cross-section and y the
+	// length (-0.5 to 0.5); the normal goes through the inverse transpose of the segment's world matrix.
+	void WriteVertex(BakedVertex& vertex, const float (&world)[4][4], const float local[3], const float localNormal[3],
+		float u, float v, const float colour[4], float boundsMin[3], float boundsMax[3])
+	{
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (int row = 0; row < 3; row++)
+		{
+			const float rowLengthSquared = world[row][0] * world[row][0] + world[row][1] * world[row][1] + world[row][2] * world[row][2];
+			const float weight = rowLengthSquared > 0.0f ? localNormal[row] / rowLengthSquared : 0.0f;
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				normal[axis] += world[row][axis] * weight;
+			}
+		}
+
+		const float normalLengthSquared = normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2];
+		const float inverseNormalLength = normalLengthSquared > 0.0f ? 1.0f / std::sqrt(normalLengthSquared) : 0.0f;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float position = local[0] * world[0][axis] + local[1] * world[1][axis] + local[2] * world[2][axis] + world[3][axis];
+
+			vertex.position[axis] = position;
+			vertex.normal[axis] = normal[axis] * inverseNormalLength;
+
+			boundsMin[axis] = std::min(boundsMin[axis], position);
+			boundsMax[axis] = std::max(boundsMax[axis], position);
+		}
+
+		vertex.texture[0] = u;
+		vertex.texture[1] = v;
+
+		for (int channel = 0; channel < 4; channel++)
+		{
+			vertex.colour[channel] = colour[channel];
+		}
+	}
+
+	void ResetBounds(float boundsMin[3], float boundsMax[3])
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = std::numeric_limits<float>::max();
+			boundsMax[axis] = -std::numeric_limits<float>::max();
+		}
+	}
+}
+
+void BakedMesh::clear()
+{
+	vertices.clear();
+	indices.clear();
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		boundsMin[axis] = 0.0f;
+		boundsMax[axis] = 0.0f;
+	}
+}
+
+ObstacleBaker::ObstacleBaker()
+{
+	SetShape(Shape::Box, 0.2f);
+}
+
+void ObstacleBaker::SetShape(Shape shape, float crossSection, int cylinderSides)
+{
+	m_shape = shape;
+	m_crossSection = crossSection;
+	m_cylinderSides = std::max(3, cylinderSides);
+
+	m_ringCos.resize(m_cylinderSides + 1);
+	m_ringSin.resize(m_cylinderSides + 1);
+
+	for (int side = 0; side <= m_cylinderSides; side++)
+	{
+		const float angle = TwoPi * static_cast<float>(side % m_cylinderSides) / static_cast<float>(m_cylinderSides);
+		m_ringCos[side] = std::cos(angle);
+		m_ringSin[side] = std::sin(angle);
+	}
+}
+
+int ObstacleBaker::GetVerticesPerSegment() const
+{
+	// Box: four per face. Cylinder: a welded side ring top and bottom, plus a centre and ring per cap.
+	return m_shape == Shape::Box ? 24 : 4 * (m_cylinderSides + 1);
+}
+
+int ObstacleBaker::GetIndicesPerSegment() const
+{
+	return m_shape == Shape::Box ? 36 : 12 * m_cylinderSides;
+}
+
+void ObstacleBaker::Bake(const std::vector<std::vector<ObstacleBakeInput>>& groups, std::vector<BakedMesh>& meshes) const
+{
+	struct Job
+	{
+		const ObstacleBakeInput* input;
+		int group;
+		size_t firstVertex;
+		size_t firstIndex;
+		float boundsMin[3];
+		float boundsMax[3];
+	};
+
+	const size_t verticesPerSegment = GetVerticesPerSegment();
+	const size_t indicesPerSegment = GetIndicesPerSegment();
+
+	// Lay every obstacle out in its group's mesh up front so the jobs can fill them independently.
+	std::vector<Job> jobs;
+	meshes.resize(groups.size());
+
+	for (size_t group = 0; group < groups.size(); group++)
+	{
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+
+		for (const ObstacleBakeInput& input : groups[group])
+		{
+			Job job;
+			job.input = &input;
+			job.group = static_cast<int>(group);
+			job.firstVertex = vertexCount;
+			job.firstIndex = indexCount;
+			jobs.push_back(job);
+
+			vertexCount += input.segments->size() * verticesPerSegment;
+			indexCount += input.segments->size() * indicesPerSegment;
+		}
+
+		meshes[group].vertices.resize(vertexCount);
+		meshes[group].indices.resize(indexCount);
+	}
+
+	ParallelFor(0, static_cast<int>(jobs.size()), [&](int jobBegin, int jobEnd)
+	{
+		for (int i = jobBegin; i < jobEnd; i++)
+		{
+			Job& job = jobs[i];
+			BakedMesh& mesh = meshes[job.group];
+
+			ResetBounds(job.boundsMin, job.boundsMax);
+
+			if (job.input->segments->empty())
+			{
+				continue;
+			}
+
+			BakeSegments(*job.input, &mesh.vertices[job.firstVertex], &mesh.indices[job.firstIndex],
+				static_cast<uint32_t>(job.firstVertex), job.boundsMin, job.boundsMax);
+		}
+	});
+
+	// Merge the bounds in job order.
+	for (BakedMesh& mesh : meshes)
+	{
+		ResetBounds(mesh.boundsMin, mesh.boundsMax);
+	}
+
+	for (const Job& job : jobs)
+	{
+		BakedMesh& mesh = meshes[job.group];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			mesh.boundsMin[axis] = std::min(mesh.boundsMin[axis], job.boundsMin[axis]);
+			mesh.boundsMax[axis] = std::max(mesh.boundsMax[axis], job.boundsMax[axis]);
+		}
+	}
+
+	for (BakedMesh& mesh : meshes)
+	{
+		if (mesh.vertices.empty())
+		{
+			mesh.clear();
+		}
+	}
+}
+
+void ObstacleBaker::BakeSegments(const ObstacleBakeInput& input, BakedVertex* vertices, uint32_t* indices, uint32_t baseVertex,
+	float boundsMin[3], float boundsMax[3]) const
+{
+	const SegmentList& segments = *input.segments;
+	const float halfWidth = 0.5f * m_crossSection;
+
+	for (size_t segment = 0; segment < segments.size(); segment++)
+	{
+		const float (&world)[4][4] = segments.world[segment].world;
+		const float* colour = input.segmentColours ? input.segmentColours + segment * 4 : input.colour;
+
+		uint32_t vertex = 0;
+
+		// Triangles are wound so that (v1 - v0) x (v2 - v0) points out of the surface.
+		const auto triangle = [&](uint32_t a, uint32_t b, uint32_t c)
+		{
+			*indices++ = baseVertex + a;
+			*indices++ = baseVertex + b;
+			*indices++ = baseVertex + c;
+		};
+
+		if (m_shape == Shape::Box)
+		{
+			// For each face: the normal axis and sign, then tangents u and v with u x v = normal.
+			static const int faces[6][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 2, 0 }, { 1, 0, 2 }, { 2, 0, 1 }, { 2, 1, 0 } };
+			static const float faceSigns[6] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+			static const float corners[4][2] = { { -1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f } };
+			const float halfExtents[3] = { halfWidth, 0.5f, halfWidth };
+
+			for (int face = 0; face < 6; face++)
+			{
+				const int normalAxis = faces[face][0];
+				const int uAxis = faces[face][1];
+				const int vAxis = faces[face][2];
+
+				float localNormal[3] = { 0.0f, 0.0f, 0.0f };
+				localNormal[normalAxis] = faceSigns[face];
+
+				for (int corner = 0; corner < 4; corner++)
+				{
+					float local[3];
+					local[normalAxis] = faceSigns[face] * halfExtents[normalAxis];
+					local[uAxis] = corners[corner][0] * halfExtents[uAxis];
+					local[vAxis] = corners[corner][1] * halfExtents[vAxis];
+
+					WriteVertex(vertices[vertex + corner], world, local, localNormal,
+						0.5f + 0.5f * corners[corner][0], 0.5f - 0.5f * corners[corner][1], colour, boundsMin, boundsMax);
+				}
+
+				triangle(vertex, vertex + 2, vertex + 1);
+				triangle(vertex, vertex + 3, vertex + 2);
+				vertex += 4;
+			}
+		}
+		else
+		{
+			const int sides = m_cylinderSides;
+			const uint32_t ring = static_cast<uint32_t>(sides + 1);
+
+			// Side: bottom ring then top ring, shared by neighbouring faces; the seam is duplicated for u.
+			for (int row = 0; row < 2; row++)
+			{
+				for (int side = 0; side <= sides; side++)
+				{
+					const float local[3] = { halfWidth * m_ringCos[side], row == 0 ? -0.5f : 0.5f, halfWidth * m_ringSin[side] };
+					const float localNormal[3] = { m_ringCos[side], 0.0f, m_ringSin[side] };
+
+					WriteVertex(vertices[vertex + row * ring + side], world, local, localNormal,
+						static_cast<float>(side) / static_cast<float>(sides), row == 0 ? 1.0f : 0.0f, colour, boundsMin, boundsMax);
+				}
+			}
+
+			for (int side = 0; side < sides; side++)
+			{
+				const uint32_t bottom = vertex + side;
+				const uint32_t top = bottom + ring;
+
+				triangle(bottom, top, bottom + 1);
+				triangle(bottom + 1, top, top + 1);
+			}
+
+			vertex += 2 * ring;
+
+			// Caps: a centre vertex followed by its own ring, so the cap normals stay flat.
+			for (int cap = 0; cap < 2; cap++)
+			{
+				const float y = cap == 0 ? -0.5f : 0.5f;
+				const float localNormal[3] = { 0.0f, cap == 0 ? -1.0f : 1.0f, 0.0f };
+				const float centre[3] = { 0.0f, y, 0.0f };
+
+				WriteVertex(vertices[vertex], world, centre, localNormal, 0.5f, 0.5f, colour, boundsMin, boundsMax);
+
+				for (int side = 0; side < sides; side++)
+				{
+					const float local[3] = { halfWidth * m_ringCos[side], y, halfWidth * m_ringSin[side] };
+
+					WriteVertex(vertices[vertex + 1 + side], world, local, localNormal,
+						0.5f + 0.5f * m_ringCos[side], 0.5f + 0.5f * m_ringSin[side], colour, boundsMin, boundsMax);
+				}
+
+				for (int side = 0; side < sides; side++)
+				{
+					const uint32_t current = vertex + 1 + side;
+					const uint32_t next = vertex + 1 + (side + 1) % sides;
+
+					if (cap == 0)
+					{
+						triangle(vertex, current, next);
+					}
+					else
+					{
+						triangle(vertex, next, current);
+					}
+				}
+
+				vertex += ring;
+			}
+		}
+
+		vertices += vertex;
+		baseVertex += vertex;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// Bakes groups of fractal obstacles into static, merged meshes.
+
+#include "Turtle.h"
+#include <cstdint>
+#include <vector>
+
+// Matches the layout of ModelClass::VertexType.
+struct BakedVertex
+{
+	float position[3];
+	float texture[2];
+	float normal[3];
+	float colour[4];
+};
+
+struct BakedMesh
+{
+	std::vector<BakedVertex> vertices;
+	std::vector<uint32_t> indices;
+	float boundsMin[3];
+	float boundsMax[3];
+
+	void clear();
+};
+
+struct ObstacleBakeInput
+{
+	const SegmentList* segments;
+	const float* segmentColours;	// RGBA per segment, or nullptr to use colour for every segment
+	float colour[4];
+};
+
+class ObstacleBaker
+{
+public:
+	enum class Shape { Box, Cylinder };
+
+public:
+	ObstacleBaker();
+
+	// Cross-section of the segment geometry before the segment's own thickness scale is applied;
+	// pass FractalObstacle::SegmentCrossSection to match the box model used by the instanced path.
+	void SetShape(Shape shape, float crossSection, int cylinderSides = 8);
+
+	int GetVerticesPerSegment() const;
+	int GetIndicesPerSegment() const;
+
+	// Bakes each group of obstacles into its own mesh; meshes is resized to groups.size().
+	void Bake(const std::vector<std::vector<ObstacleBakeInput>>& groups, std::vector<BakedMesh>& meshes) const;
+
+private:
+	void BakeSegments(const ObstacleBakeInput& input, BakedVertex* vertices, uint32_t* indices, uint32_t baseVertex,
+		float boundsMin[3], float boundsMax[3]) const;
+
+private:
+	Shape m_shape;
+	float m_crossSection;
+	int m_cylinderSides;
+	std::vector<float> m_ringCos, m_ringSin;	// m_cylinderSides + 1 entries, the last repeating the first
+};
@@ -0,0 +1,18 @@
+#include "ObstacleInstances.h"
+
+void PackSegmentInstance(const float centre[3], const float heading[3], const float right[3], const float up[3],
+	float length, float thickness, SegmentInstance& instance)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		instance.world[0][axis] = right[axis] * thickness;
+		instance.world[1][axis] = heading[axis] * length;
+		instance.world[2][axis] = up[axis] * thickness;
+		instance.world[3][axis] = centre[axis];
+	}
+
+	instance.world[0][3] = 0.0f;
+	instance.world[1][3] = 0.0f;
+	instance.world[2][3] = 0.0f;
+	instance.world[3][3] = 1.0f;
+}
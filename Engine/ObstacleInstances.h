@@ -0,0 +1,16 @@
+#pragma once
+
+// Per-instance world matrices for fractal obstacle segments, as read by light_instanced_vs.hlsl.
+
+#include <cstddef>
+
+struct SegmentInstance
+{
+	float world[4][4];
+};
+
+// World matrix of one segment of the unit, Y-aligned segment model centred on the origin:
+// X follows right and Z follows up, both scaled by thickness, Y follows heading scaled by length,
+// and the origin moves to centre. right x heading must equal up.
+void PackSegmentInstance(const float centre[3], const float heading[3], const float right[3], const float up[3],
+	float length, float thickness, SegmentInstance& instance);
@@ -0,0 +1,207 @@
+#pragma once
+
+// Fork/join over row ranges on a persistent pool of worker threads.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+inline int GetWorkerThreadCount()
+{
+	// Queried once: on some platforms hardware_concurrency reads system files on every call.
+	static const int workerThreadCount = []()
+	{
+		const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 0 ? static_cast<int>(hardwareThreads) : 1;
+	}();
+
+	return workerThreadCount;
+}
+
+class WorkerPool
+{
+public:
+	static WorkerPool& Get()
+	{
+		static WorkerPool pool;
+		return pool;
+	}
+
+	// Calls block(index) once for every index in [0, blockCount) and returns when all have finished.
+	void Run(int blockCount, const std::function<void(int)>& block)
+	{
+		if (IsInsideRun() || m_workers.empty())
+		{
+			for (int index = 0; index < blockCount; index++)
+			{
+				block(index);
+			}
+			return;
+		}
+
+		// One pass at a time; callers on other threads wait their turn.
+		std::lock_guard<std::mutex> runLock(m_runMutex);
+
+		Job job(block, blockCount);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = &job;
+			m_generation++;
+		}
+		m_wake.notify_all();
+
+		IsInsideRun() = true;
+		const int finished = RunBlocks(job);
+		IsInsideRun() = false;
+
+		// Workers hold a pointer to the job, so wait for them to let go of it as well.
+		std::unique_lock<std::mutex> lock(m_mutex);
+		job.pendingBlocks -= finished;
+		m_done.wait(lock, [&]() { return job.pendingBlocks == 0 && job.activeWorkers == 0; });
+		m_job = nullptr;
+	}
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+
+		for (auto& worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+private:
+	struct Job
+	{
+		Job(const std::function<void(int)>& block, int blockCount)
+			: block(block), blockCount(blockCount), nextBlock(0), pendingBlocks(blockCount), activeWorkers(0)
+		{
+		}
+
+		const std::function<void(int)>& block;
+		const int blockCount;
+		std::atomic<int> nextBlock;
+		int pendingBlocks;	// guarded by m_mutex
+		int activeWorkers;	// guarded by m_mutex
+	};
+
+	WorkerPool()
+		: m_job(nullptr), m_generation(0), m_stop(false)
+	{
+		// The calling thread is the last worker of every pass.
+		const int workerCount = GetWorkerThreadCount() - 1;
+		m_workers.reserve(std::max(0, workerCount));
+		for (int worker = 0; worker < workerCount; worker++)
+		{
+			m_workers.emplace_back([this]() { WorkerLoop(); });
+		}
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	static bool& IsInsideRun()
+	{
+		static thread_local bool insideRun = false;
+		return insideRun;
+	}
+
+	static int RunBlocks(Job& job)
+	{
+		int finished = 0;
+		for (int index = job.nextBlock++; index < job.blockCount; index = job.nextBlock++)
+		{
+			job.block(index);
+			finished++;
+		}
+		return finished;
+	}
+
+	void WorkerLoop()
+	{
+		IsInsideRun() = true;
+
+		unsigned long long seenGeneration = 0;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		for (;;)
+		{
+			m_wake.wait(lock, [&]() { return m_stop || m_generation != seenGeneration; });
+			if (m_stop)
+			{
+				return;
+			}
+
+			seenGeneration = m_generation;
+			Job* job = m_job;
+			if (!job)
+			{
+				continue;
+			}
+
+			job->activeWorkers++;
+			lock.unlock();
+
+			const int finished = RunBlocks(*job);
+
+			lock.lock();
+			job->pendingBlocks -= finished;
+			job->activeWorkers--;
+			if (job->pendingBlocks == 0 && job->activeWorkers == 0)
+			{
+				m_done.notify_all();
+			}
+		}
+	}
+
+private:
+	std::vector<std::thread> m_workers;
+	std::mutex m_runMutex;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	Job* m_job;
+	unsigned long long m_generation;
+	bool m_stop;
+};
+
+// Grain size for passes over the rows of a height plane, as minItemsPerThread: a thread gets at
+// least this many rows, so small maps run on fewer threads instead of waking all of them.
+const int DefaultMinRowsPerThread = 16;
+
+template <typename Function>
+void ParallelFor(int begin, int end, Function function, int minItemsPerThread = 1)
+{
+	const int itemCount = end - begin;
+	if (itemCount <= 0)
+	{
+		return;
+	}
+
+	const int maxThreads = std::max(1, itemCount / std::max(1, minItemsPerThread));
+	const int threadCount = std::min(GetWorkerThreadCount(), maxThreads);
+	if (threadCount <= 1)
+	{
+		function(begin, end);
+		return;
+	}
+
+	const int itemsPerThread = itemCount / threadCount;
+	const int remainder = itemCount % threadCount;
+
+	// The first remainder blocks take one extra item.
+	WorkerPool::Get().Run(threadCount, [&](int block)
+	{
+		const int blockBegin = begin + block * itemsPerThread + std::min(block, remainder);
+		const int blockEnd = blockBegin + itemsPerThread + (block < remainder ? 1 : 0);
+		function(blockBegin, blockEnd);
+	});
+}
@@ -0,0 +1,496 @@
+#include "PerlinNoise.h"
+#include "CpuFeatures.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PERLIN_NOISE_X86 1
+#include <immintrin.h>
+#endif
+
+// The SIMD kernels are only bit-identical to the scalar path if neither side is contracted into FMAs.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PERLIN_NOISE_TARGET_SSE2 __attribute__((target("sse2")))
+#define PERLIN_NOISE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PERLIN_NOISE_TARGET_SSE2
+#define PERLIN_NOISE_TARGET_AVX2
+#endif
+
+namespace
+{
+	float Lerp(float a, float b, float t)
+	{
+		return a + t * (b - a);
+	}
+
+	float Fade(float t)
+	{
+		// Smoothing function: 6t^5 - 15t^4 + 10t^3
+		return t * t * t * (t * (t * 6 - 15) + 10);
+	}
+
+	float Grad(int hash, float x, float y)
+	{
+		// Ensure hash is within the permutation table range
+		hash &= 255;  // Limit to 0-255
+
+		// Compute gradient based on hash
+		switch (hash & 3)
+		{
+		case 0:  return  x + y;
+		case 1:  return -x + y;
+		case 2:  return  x - y;
+		case 3:  return -x - y;
+		default: return 0;
+		}
+	}
+
+	float GetTotalAmplitude(int octaves)
+	{
+		float amplitude = 1.0f;
+		float totalAmplitude = 0.0f;
+
+		for (int o = 0; o < octaves; o++)
+		{
+			totalAmplitude += amplitude;
+			amplitude *= 0.5f;
+		}
+
+		return totalAmplitude;
+	}
+
+#if PERLIN_NOISE_X86
+	// SSE2 has no gather, so spill the indices and load the four entries individually.
+	PERLIN_NOISE_TARGET_SSE2 inline __m128i Gather4(const int* table, __m128i index)
+	{
+		alignas(16) int lanes[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(lanes), index);
+		return _mm_setr_epi32(table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]]);
+	}
+
+	// Branchless Grad: bit 0 of the hash negates x, bit 1 negates y.
+	PERLIN_NOISE_TARGET_SSE2 inline __m128 Grad4(__m128i hash, __m128 x, __m128 y)
+	{
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128i two = _mm_set1_epi32(2);
+		const __m128 signX = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(hash, one), 31));
+		const __m128 signY = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(hash, two), 30));
+		return _mm_add_ps(_mm_xor_ps(x, signX), _mm_xor_ps(y, signY));
+	}
+
+	PERLIN_NOISE_TARGET_SSE2 inline __m128 Fade4(__m128 t)
+	{
+		const __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+		return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+	}
+
+	PERLIN_NOISE_TARGET_SSE2 inline __m128 Lerp4(__m128 a, __m128 b, __m128 t)
+	{
+		return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+	}
+
+	// std::floor for |x| < 2^31 using SSE2 only (truncate, then step down where truncation rounded up).
+	PERLIN_NOISE_TARGET_SSE2 inline __m128 Floor4(__m128 x, __m128i& floorInt)
+	{
+		const __m128i truncated = _mm_cvttps_epi32(x);
+		const __m128 truncatedFloat = _mm_cvtepi32_ps(truncated);
+		const __m128 roundedUp = _mm_cmpgt_ps(truncatedFloat, x);
+		floorInt = _mm_add_epi32(truncated, _mm_castps_si128(roundedUp));
+		return _mm_sub_ps(truncatedFloat, _mm_and_ps(roundedUp, _mm_set1_ps(1.0f)));
+	}
+
+	PERLIN_NOISE_TARGET_SSE2 __m128 Noise4(const int* permutation, __m128 x, __m128 y)
+	{
+		const __m128i mask = _mm_set1_epi32(255);
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128 oneFloat = _mm_set1_ps(1.0f);
+
+		// Find unit grid cell containing point
+		__m128i X, Y;
+		const __m128 floorX = Floor4(x, X);
+		const __m128 floorY = Floor4(y, Y);
+		X = _mm_and_si128(X, mask);
+		Y = _mm_and_si128(Y, mask);
+
+		// Relative coordinates within the cell
+		x = _mm_sub_ps(x, floorX);
+		y = _mm_sub_ps(y, floorY);
+
+		// Compute fade curves for x and y
+		const __m128 u = Fade4(x);
+		const __m128 v = Fade4(y);
+
+		// Hash coordinates of the 4 square corners
+		const __m128i A = _mm_add_epi32(Gather4(permutation, X), Y);
+		const __m128i AA = Gather4(permutation, _mm_and_si128(A, mask));
+		const __m128i AB = Gather4(permutation, _mm_and_si128(_mm_add_epi32(A, one), mask));
+		const __m128i B = _mm_add_epi32(Gather4(permutation, _mm_and_si128(_mm_add_epi32(X, one), mask)), Y);
+		const __m128i BA = Gather4(permutation, _mm_and_si128(B, mask));
+		const __m128i BB = Gather4(permutation, _mm_and_si128(_mm_add_epi32(B, one), mask));
+
+		const __m128 xMinusOne = _mm_sub_ps(x, oneFloat);
+		const __m128 yMinusOne = _mm_sub_ps(y, oneFloat);
+
+		// Blend corner gradients (same argument order as the scalar Noise2D)
+		return Lerp4(v,
+			Lerp4(u,
+				Grad4(Gather4(permutation, AA), x, y),
+				Grad4(Gather4(permutation, BA), xMinusOne, y)
+			),
+			Lerp4(u,
+				Grad4(Gather4(permutation, AB), x, yMinusOne),
+				Grad4(Gather4(permutation, BB), xMinusOne, yMinusOne)
+			)
+		);
+	}
+
+	PERLIN_NOISE_TARGET_AVX2 inline __m256i Gather8(const int* table, __m256i index)
+	{
+		return _mm256_i32gather_epi32(table, index, 4);
+	}
+
+	PERLIN_NOISE_TARGET_AVX2 inline __m256 Grad8(__m256i hash, __m256 x, __m256 y)
+	{
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256i two = _mm256_set1_epi32(2);
+		const __m256 signX = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(hash, one), 31));
+		const __m256 signY = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(hash, two), 30));
+		return _mm256_add_ps(_mm256_xor_ps(x, signX), _mm256_xor_ps(y, signY));
+	}
+
+	PERLIN_NOISE_TARGET_AVX2 inline __m256 Fade8(__m256 t)
+	{
+		const __m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+		return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+	}
+
+	PERLIN_NOISE_TARGET_AVX2 inline __m256 Lerp8(__m256 a, __m256 b, __m256 t)
+	{
+		return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+	}
+
+	PERLIN_NOISE_TARGET_AVX2 __m256 Noise8(const int* permutation, __m256 x, __m256 y)
+	{
+		const __m256i mask = _mm256_set1_epi32(255);
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256 oneFloat = _mm256_set1_ps(1.0f);
+
+		// Find unit grid cell containing point
+		const __m256 floorX = _mm256_floor_ps(x);
+		const __m256 floorY = _mm256_floor_ps(y);
+		const __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(floorX), mask);
+		const __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(floorY), mask);
+
+		// Relative coordinates within the cell
+		x = _mm256_sub_ps(x, floorX);
+		y = _mm256_sub_ps(y, floorY);
+
+		// Compute fade curves for x and y
+		const __m256 u = Fade8(x);
+		const __m256 v = Fade8(y);
+
+		// Hash coordinates of the 4 square corners
+		const __m256i A = _mm256_add_epi32(Gather8(permutation, X), Y);
+		const __m256i AA = Gather8(permutation, _mm256_and_si256(A, mask));
+		const __m256i AB = Gather8(permutation, _mm256_and_si256(_mm256_add_epi32(A, one), mask));
+		const __m256i B = _mm256_add_epi32(Gather8(permutation, _mm256_and_si256(_mm256_add_epi32(X, one), mask)), Y);
+		const __m256i BA = Gather8(permutation, _mm256_and_si256(B, mask));
+		const __m256i BB = Gather8(permutation, _mm256_and_si256(_mm256_add_epi32(B, one), mask));
+
+		const __m256 xMinusOne = _mm256_sub_ps(x, oneFloat);
+		const __m256 yMinusOne = _mm256_sub_ps(y, oneFloat);
+
+		// Blend corner gradients (same argument order as the scalar Noise2D)
+		return Lerp8(v,
+			Lerp8(u,
+				Grad8(Gather8(permutation, AA), x, y),
+				Grad8(Gather8(permutation, BA), xMinusOne, y)
+			),
+			Lerp8(u,
+				Grad8(Gather8(permutation, AB), x, yMinusOne),
+				Grad8(Gather8(permutation, BB), xMinusOne, yMinusOne)
+			)
+		);
+	}
+#endif
+}
+
+PerlinNoise::PerlinNoise()
+{
+	RandomStream random;
+	GeneratePermutationTable(random);
+}
+
+void PerlinNoise::GeneratePermutationTable(RandomStream& random)
+{
+	// Create and shuffle permutation table
+	m_permutation.resize(512);
+	std::vector<int> basePermutation(256);
+
+	// Initialize base permutation
+	for (int i = 0; i < 256; i++)
+	{
+		basePermutation[i] = i;
+	}
+
+	// Shuffle the base permutation
+	random.Shuffle(basePermutation.begin(), basePermutation.end());
+
+	// Duplicate the permutation to avoid overflow
+	for (int i = 0; i < 256; i++)
+	{
+		m_permutation[i] = basePermutation[i];
+		m_permutation[i + 256] = basePermutation[i];
+	}
+}
+
+float PerlinNoise::Noise2D(float x, float y) const
+{
+	// Find unit grid cell containing point
+	int X = static_cast<int>(std::floor(x)) & 255;
+	int Y = static_cast<int>(std::floor(y)) & 255;
+
+	// Relative coordinates within the cell
+	x -= std::floor(x);
+	y -= std::floor(y);
+
+	// Compute fade curves for x and y
+	float u = Fade(x);
+	float v = Fade(y);
+
+	// Hash coordinates of the 4 square corners
+	int A = m_permutation[X] + Y;
+	int AA = m_permutation[A & 255];
+	int AB = m_permutation[(A + 1) & 255];
+	int B = m_permutation[(X + 1) & 255] + Y;
+	int BA = m_permutation[B & 255];
+	int BB = m_permutation[(B + 1) & 255];
+
+	// Blend corner gradients
+	return Lerp(v,
+		Lerp(u,
+			Grad(m_permutation[AA], x, y),
+			Grad(m_permutation[BA], x - 1, y)
+		),
+		Lerp(u,
+			Grad(m_permutation[AB], x, y - 1),
+			Grad(m_permutation[BB], x - 1, y - 1)
+		)
+	);
+}
+
+float PerlinNoise::Fbm(float x, float y, float scale, int octaves, float heightScale) const
+{
+	// Scale coordinates
+	x = x / scale;
+	y = y / scale;
+
+	float amplitude = 1.0f;
+	float frequency = 1.0f;
+	float noiseValue = 0.0f;
+	float totalAmplitude = 0.0f;
+
+	// Sum noise contributions (Fractal Brownian Motion)
+	for (int o = 0; o < octaves; o++)
+	{
+		noiseValue += Noise2D(x * frequency, y * frequency) * amplitude;
+		totalAmplitude += amplitude;
+
+		// Update parameters for the next octave
+		amplitude *= 0.5f;   // Reduce amplitude for higher octaves
+		frequency *= 2.0f;   // Increase frequency for higher octaves
+	}
+
+	// Normalize the noise value
+	if (totalAmplitude > 0.0f)
+	{
+		noiseValue /= totalAmplitude;
+	}
+
+	// Scale height to desired range
+	return noiseValue * heightScale;
+}
+
+void PerlinNoise::FbmRows(Kernel kernel, float* output, int width, int rowBegin, int rowEnd,
+	float scale, int octaves, float heightScale) const
+{
+#if PERLIN_NOISE_X86
+	if (kernel == Kernel::AVX2)
+	{
+		FbmRowsAVX2(output, width, rowBegin, rowEnd, scale, octaves, heightScale);
+		return;
+	}
+
+	if (kernel == Kernel::SSE2)
+	{
+		FbmRowsSSE2(output, width, rowBegin, rowEnd, scale, octaves, heightScale);
+		return;
+	}
+#endif
+
+	for (int j = rowBegin; j < rowEnd; j++)
+	{
+		float* row = output + (j * width);
+
+		for (int i = 0; i < width; i++)
+		{
+			row[i] = Fbm(static_cast<float>(i), static_cast<float>(j), scale, octaves, heightScale);
+		}
+	}
+}
+
+void PerlinNoise::GenerateFbm(Kernel kernel, float* output, int width, int height,
+	float scale, int octaves, float heightScale, bool parallel) const
+{
+	if (!parallel)
+	{
+		FbmRows(kernel, output, width, 0, height, scale, octaves, heightScale);
+		return;
+	}
+
+	// Keep at least a few thousand texels per thread so small maps don't pay for thread start-up.
+	const int minRowsPerThread = std::max(1, 4096 / std::max(1, width));
+
+	ParallelFor(0, height, [&](int rowBegin, int rowEnd)
+	{
+		FbmRows(kernel, output, width, rowBegin, rowEnd, scale, octaves, heightScale);
+	}, minRowsPerThread);
+}
+
+PerlinNoise::Kernel PerlinNoise::GetBestKernel()
+{
+#if PERLIN_NOISE_X86
+	static const Kernel bestKernel = CpuFeatures::HasAVX2() ? Kernel::AVX2 : Kernel::SSE2;
+	return bestKernel;
+#else
+	return Kernel::Scalar;
+#endif
+}
+
+const char* PerlinNoise::GetKernelName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::SSE2: return "SSE2";
+	case Kernel::AVX2: return "AVX2";
+	default:           return "Scalar";
+	}
+}
+
+#if PERLIN_NOISE_X86
+PERLIN_NOISE_TARGET_SSE2 void PerlinNoise::FbmRowsSSE2(float* output, int width, int rowBegin, int rowEnd,
+	float scale, int octaves, float heightScale) const
+{
+	const int* permutation = m_permutation.data();
+	const float totalAmplitude = GetTotalAmplitude(octaves);
+	const __m128 scaleVector = _mm_set1_ps(scale);
+	const __m128i laneOffsets = _mm_setr_epi32(0, 1, 2, 3);
+
+	for (int j = rowBegin; j < rowEnd; j++)
+	{
+		float* row = output + (j * width);
+		const __m128 y = _mm_div_ps(_mm_set1_ps(static_cast<float>(j)), scaleVector);
+
+		int i = 0;
+		for (; i + 4 <= width; i += 4)
+		{
+			const __m128 x = _mm_div_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i), laneOffsets)), scaleVector);
+
+			float amplitude = 1.0f;
+			float frequency = 1.0f;
+			__m128 noiseValue = _mm_setzero_ps();
+
+			for (int o = 0; o < octaves; o++)
+			{
+				const __m128 frequencyVector = _mm_set1_ps(frequency);
+				const __m128 noise = Noise4(permutation, _mm_mul_ps(x, frequencyVector), _mm_mul_ps(y, frequencyVector));
+				noiseValue = _mm_add_ps(noiseValue, _mm_mul_ps(noise, _mm_set1_ps(amplitude)));
+
+				amplitude *= 0.5f;
+				frequency *= 2.0f;
+			}
+
+			if (totalAmplitude > 0.0f)
+			{
+				noiseValue = _mm_div_ps(noiseValue, _mm_set1_ps(totalAmplitude));
+			}
+
+			_mm_storeu_ps(row + i, _mm_mul_ps(noiseValue, _mm_set1_ps(heightScale)));
+		}
+
+		// Remainder of the row
+		for (; i < width; i++)
+		{
+			row[i] = Fbm(static_cast<float>(i), static_cast<float>(j), scale, octaves, heightScale);
+		}
+	}
+}
+
+PERLIN_NOISE_TARGET_AVX2 void PerlinNoise::FbmRowsAVX2(float* output, int width, int rowBegin, int rowEnd,
+	float scale, int octaves, float heightScale) const
+{
+	const int* permutation = m_permutation.data();
+	const float totalAmplitude = GetTotalAmplitude(octaves);
+	const __m256 scaleVector = _mm256_set1_ps(scale);
+	const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+	for (int j = rowBegin; j < rowEnd; j++)
+	{
+		float* row = output + (j * width);
+		const __m256 y = _mm256_div_ps(_mm256_set1_ps(static_cast<float>(j)), scaleVector);
+
+		int i = 0;
+		for (; i + 8 <= width; i += 8)
+		{
+			const __m256 x = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i), laneOffsets)), scaleVector);
+
+			float amplitude = 1.0f;
+			float frequency = 1.0f;
+			__m256 noiseValue = _mm256_setzero_ps();
+
+			for (int o = 0; o < octaves; o++)
+			{
+				const __m256 frequencyVector = _mm256_set1_ps(frequency);
+				const __m256 noise = Noise8(permutation, _mm256_mul_ps(x, frequencyVector), _mm256_mul_ps(y, frequencyVector));
+				noiseValue = _mm256_add_ps(noiseValue, _mm256_mul_ps(noise, _mm256_set1_ps(amplitude)));
+
+				amplitude *= 0.5f;
+				frequency *= 2.0f;
+			}
+
+			if (totalAmplitude > 0.0f)
+			{
+				noiseValue = _mm256_div_ps(noiseValue, _mm256_set1_ps(totalAmplitude));
+			}
+
+			_mm256_storeu_ps(row + i, _mm256_mul_ps(noiseValue, _mm256_set1_ps(heightScale)));
+		}
+
+		// Remainder of the row
+		for (; i < width; i++)
+		{
+			row[i] = Fbm(static_cast<float>(i), static_cast<float>(j), scale, octaves, heightScale);
+		}
+	}
+}
+#else
+void PerlinNoise::FbmRowsSSE2(float* output, int width, int rowBegin, int rowEnd,
+	float scale, int octaves, float heightScale) const
+{
+	FbmRows(Kernel::Scalar, output, width, rowBegin, rowEnd, scale, octaves, heightScale);
+}
+
+void PerlinNoise::FbmRowsAVX2(float* output, int width, int rowBegin, int rowEnd,
+	float scale, int octaves, float heightScale) const
+{
+	FbmRows(Kernel::Scalar, output, width, rowBegin, rowEnd, scale, octaves, heightScale);
+}
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+
+// 2D Perlin noise and fBm, with SSE2 and AVX2 row kernels bit-identical to the scalar ones.
+
+#include "WorldGenContext.h"
+#include <vector>
+
+class PerlinNoise
+{
+public:
+	enum class Kernel
+	{
+		Scalar,
+		SSE2,
+		AVX2
+	};
+
+public:
+	// Starts from the table for seed 0; call GeneratePermutationTable to reseed.
+	PerlinNoise();
+
+	void GeneratePermutationTable(RandomStream& random);
+
+	float Noise2D(float x, float y) const;
+
+	// Normalised fBm at (x / scale, y / scale), multiplied by heightScale.
+	float Fbm(float x, float y, float scale, int octaves, float heightScale) const;
+
+	// Fills rows [rowBegin, rowEnd) of a row-major width x height grid with Fbm(i, j, ...).
+	void FbmRows(Kernel kernel, float* output, int width, int rowBegin, int rowEnd,
+		float scale, int octaves, float heightScale) const;
+
+	// Fills the whole grid, splitting rows across all cores when parallel is set.
+	void GenerateFbm(Kernel kernel, float* output, int width, int height,
+		float scale, int octaves, float heightScale, bool parallel = true) const;
+
+	// Widest kernel the current CPU supports.
+	static Kernel GetBestKernel();
+	static const char* GetKernelName(Kernel kernel);
+
+private:
+	void FbmRowsSSE2(float* output, int width, int rowBegin, int rowEnd,
+		float scale, int octaves, float heightScale) const;
+	void FbmRowsAVX2(float* output, int width, int rowBegin, int rowEnd,
+		float scale, int octaves, float heightScale) const;
+
+private:
+	// 512 entries: the shuffled 0-255 table duplicated to avoid overflow.
+	std::vector<int> m_permutation;
+};
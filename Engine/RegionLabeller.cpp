@@ -0,0 +1,131 @@
+#include "RegionLabeller.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+RegionLabeller::RegionLabeller()
+{
+	m_cellSize = 1.0f;
+	m_cellsX = 0;
+	m_cellsZ = 0;
+}
+
+void RegionLabeller::Build(const std::vector<Seed>& seeds, int width, int height)
+{
+	m_seeds = seeds;
+	m_cellStart.clear();
+	m_cellSeeds.clear();
+	m_cellsX = 0;
+	m_cellsZ = 0;
+
+	if (m_seeds.empty() || width <= 0 || height <= 0)
+	{
+		return;
+	}
+
+	// About two seeds per cell
+	const float area = static_cast<float>(width) * static_cast<float>(height);
+	m_cellSize = std::max(1.0f, std::sqrt(2.0f * area / static_cast<float>(m_seeds.size())));
+	m_cellsX = std::max(1, static_cast<int>(std::ceil(width / m_cellSize)));
+	m_cellsZ = std::max(1, static_cast<int>(std::ceil(height / m_cellSize)));
+
+	const auto cellOf = [&](const Seed& seed)
+	{
+		const int cellX = std::min(m_cellsX - 1, std::max(0, static_cast<int>(seed.x / m_cellSize)));
+		const int cellZ = std::min(m_cellsZ - 1, std::max(0, static_cast<int>(seed.z / m_cellSize)));
+		return cellZ * m_cellsX + cellX;
+	};
+
+	// Counting sort of the seeds by cell keeps each cell's seeds in ascending index order.
+	m_cellStart.assign(m_cellsX * m_cellsZ + 1, 0);
+	for (const auto& seed : m_seeds)
+	{
+		m_cellStart[cellOf(seed) + 1]++;
+	}
+	for (size_t cell = 1; cell < m_cellStart.size(); cell++)
+	{
+		m_cellStart[cell] += m_cellStart[cell - 1];
+	}
+
+	std::vector<int> cursor(m_cellStart.begin(), m_cellStart.end() - 1);
+	m_cellSeeds.resize(m_seeds.size());
+	for (int seed = 0; seed < static_cast<int>(m_seeds.size()); seed++)
+	{
+		m_cellSeeds[cursor[cellOf(m_seeds[seed])]++] = seed;
+	}
+}
+
+void RegionLabeller::SearchCell(int cellX, int cellZ, float x, float z, int& best, float& bestDistanceSquared) const
+{
+	if (cellX < 0 || cellX >= m_cellsX || cellZ < 0 || cellZ >= m_cellsZ)
+	{
+		return;
+	}
+
+	const int cell = cellZ * m_cellsX + cellX;
+	for (int n = m_cellStart[cell]; n < m_cellStart[cell + 1]; n++)
+	{
+		const int seed = m_cellSeeds[n];
+		const float dx = x - m_seeds[seed].x;
+		const float dz = z - m_seeds[seed].z;
+		const float distanceSquared = dx * dx + dz * dz;
+
+		if (distanceSquared < bestDistanceSquared || (distanceSquared == bestDistanceSquared && seed < best))
+		{
+			best = seed;
+			bestDistanceSquared = distanceSquared;
+		}
+	}
+}
+
+int RegionLabeller::FindNearest(float x, float z) const
+{
+	if (m_seeds.empty())
+	{
+		return -1;
+	}
+
+	const int cellX = std::min(m_cellsX - 1, std::max(0, static_cast<int>(x / m_cellSize)));
+	const int cellZ = std::min(m_cellsZ - 1, std::max(0, static_cast<int>(z / m_cellSize)));
+	const int maxRing = std::max(std::max(cellX, m_cellsX - 1 - cellX), std::max(cellZ, m_cellsZ - 1 - cellZ));
+
+	int best = -1;
+	float bestDistanceSquared = std::numeric_limits<float>::max();
+
+	for (int ring = 0; ring <= maxRing; ring++)
+	{
+		// Any seed outside the rings searched so far is at least this far from the query.
+		if (best >= 0 && ring > 0)
+		{
+			const float boxMinX = (cellX - ring + 1) * m_cellSize;
+			const float boxMaxX = (cellX + ring) * m_cellSize;
+			const float boxMinZ = (cellZ - ring + 1) * m_cellSize;
+			const float boxMaxZ = (cellZ + ring) * m_cellSize;
+			const float bound = std::min(std::min(x - boxMinX, boxMaxX - x), std::min(z - boxMinZ, boxMaxZ - z));
+
+			if (bound > 0.0f && bound * bound > bestDistanceSquared)
+			{
+				break;
+			}
+		}
+
+		if (ring == 0)
+		{
+			SearchCell(cellX, cellZ, x, z, best, bestDistanceSquared);
+			continue;
+		}
+
+		for (int offset = -ring; offset <= ring; offset++)
+		{
+			SearchCell(cellX + offset, cellZ - ring, x, z, best, bestDistanceSquared);
+			SearchCell(cellX + offset, cellZ + ring, x, z, best, bestDistanceSquared);
+		}
+		for (int offset = -ring + 1; offset <= ring - 1; offset++)
+		{
+			SearchCell(cellX - ring, cellZ + offset, x, z, best, bestDistanceSquared);
+			SearchCell(cellX + ring, cellZ + offset, x, z, best, bestDistanceSquared);
+		}
+	}
+
+	return best;
+}
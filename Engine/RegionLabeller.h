@@ -0,0 +1,35 @@
+#pragma once
+
+// Nearest-seed (Voronoi) labelling through a uniform grid of seeds.
+
+#include <vector>
+
+class RegionLabeller
+{
+public:
+	struct Seed
+	{
+		float x, z;
+	};
+
+public:
+	RegionLabeller();
+
+	// Buckets the seeds of a width x height grid.
+	void Build(const std::vector<Seed>& seeds, int width, int height);
+
+	// Index of the seed nearest to (x, z), or -1 if there are no seeds.
+	int FindNearest(float x, float z) const;
+
+	int GetSeedCount() const { return static_cast<int>(m_seeds.size()); }
+
+private:
+	void SearchCell(int cellX, int cellZ, float x, float z, int& best, float& bestDistanceSquared) const;
+
+private:
+	std::vector<Seed> m_seeds;
+	float m_cellSize;
+	int m_cellsX, m_cellsZ;
+	std::vector<int> m_cellStart;     // m_cellsX * m_cellsZ + 1 offsets into m_cellSeeds
+	std::vector<int> m_cellSeeds;     // seed indices, ascending within each cell
+};
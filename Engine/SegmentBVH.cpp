@@ -0,0 +1,526 @@
+#include "SegmentBVH.h"
+#include "Turtle.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	const int BinCount = 12;
+	const size_t MaxLeafSize = 4;
+
+	// Relative costs of visiting a node and testing a capsule, for the surface area heuristic.
+	const float TraversalCost = 1.0f;
+	const float IntersectionCost = 1.0f;
+
+	// Deeper nodes become leaves, so a fixed stack always fits.
+	const int MaxDepth = 48;
+	const int StackSize = MaxDepth + 2;
+
+	float Dot(const float a[3], const float b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	float SurfaceArea(const float boundsMin[3], const float boundsMax[3])
+	{
+		const float x = boundsMax[0] - boundsMin[0];
+		const float y = boundsMax[1] - boundsMin[1];
+		const float z = boundsMax[2] - boundsMin[2];
+		return 2.0f * (x * y + y * z + z * x);
+	}
+
+	void ResetBounds(float boundsMin[3], float boundsMax[3])
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = FLT_MAX;
+			boundsMax[axis] = -FLT_MAX;
+		}
+	}
+
+	void GrowBounds(float boundsMin[3], float boundsMax[3], const float otherMin[3], const float otherMax[3])
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], otherMin[axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], otherMax[axis]);
+		}
+	}
+
+	float SphereBoxDistanceSquared(const float centre[3], const float boundsMin[3], const float boundsMax[3])
+	{
+		float distanceSquared = 0.0f;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float d = std::max(std::max(boundsMin[axis] - centre[axis], 0.0f), centre[axis] - boundsMax[axis]);
+			distanceSquared += d * d;
+		}
+
+		return distanceSquared;
+	}
+
+	// Slab test; returns the entry distance, or FLT_MAX if the ray misses the box within maxDistance.
+	float RayBoxEntry(const float origin[3], const float inverseDirection[3], float maxDistance, const float boundsMin[3], const float boundsMax[3])
+	{
+		float entry = 0.0f;
+		float exit = maxDistance;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+			float t1 = (boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+
+			entry = t0 > entry ? t0 : entry;
+			exit = t1 < exit ? t1 : exit;
+		}
+
+		return entry <= exit ? entry : FLT_MAX;
+	}
+
+	// Entry distance of a ray into a sphere, negative if it misses or starts inside.
+	float RaycastSphere(const float origin[3], const float direction[3], const float centre[3], float radius)
+	{
+		const float offset[3] = { origin[0] - centre[0], origin[1] - centre[1], origin[2] - centre[2] };
+		const float b = Dot(direction, offset);
+		const float c = Dot(offset, offset) - radius * radius;
+		const float h = b * b - c;
+
+		return h >= 0.0f ? -b - std::sqrt(h) : -1.0f;
+	}
+}
+
+SegmentBVH::SegmentBVH()
+	: m_radius(0.0f), m_depth(0)
+{
+}
+
+void SegmentBVH::Clear()
+{
+	m_nodes.clear();
+	m_primitives.clear();
+	m_depth = 0;
+}
+
+void SegmentBVH::Build(const SegmentList& segments, float radius)
+{
+	Clear();
+	m_radius = radius;
+
+	const size_t count = segments.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::vector<BuildEntry> entries(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const float start[3] = { segments.startX[i], segments.startY[i], segments.startZ[i] };
+		const float direction[3] = { segments.directionX[i], segments.directionY[i], segments.directionZ[i] };
+
+		BuildEntry& entry = entries[i];
+		entry.segment = static_cast<int>(i);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			const float end = start[axis] + direction[axis] * segments.length[i];
+			entry.boundsMin[axis] = std::min(start[axis], end) - radius;
+			entry.boundsMax[axis] = std::max(start[axis], end) + radius;
+			entry.centroid[axis] = (start[axis] + end) * 0.5f;
+		}
+	}
+
+	// A binary tree with at least one primitive per leaf has fewer than 2n nodes
+	m_nodes.reserve(2 * count);
+	BuildNode(entries, 0, count, 0);
+
+	// Copy the segments into leaf order
+	m_primitives.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const int segment = entries[i].segment;
+		Primitive& primitive = m_primitives[i];
+		primitive.segment = segment;
+		primitive.start[0] = segments.startX[segment];
+		primitive.start[1] = segments.startY[segment];
+		primitive.start[2] = segments.startZ[segment];
+		primitive.end[0] = primitive.start[0] + segments.directionX[segment] * segments.length[segment];
+		primitive.end[1] = primitive.start[1] + segments.directionY[segment] * segments.length[segment];
+		primitive.end[2] = primitive.start[2] + segments.directionZ[segment] * segments.length[segment];
+	}
+}
+
+uint32_t SegmentBVH::BuildNode(std::vector<BuildEntry>& entries, size_t begin, size_t end, int depth)
+{
+	m_depth = std::max(m_depth, depth);
+
+	const uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.emplace_back();
+
+	float boundsMin[3], boundsMax[3], centroidMin[3], centroidMax[3];
+	ResetBounds(boundsMin, boundsMax);
+	ResetBounds(centroidMin, centroidMax);
+
+	for (size_t i = begin; i < end; i++)
+	{
+		GrowBounds(boundsMin, boundsMax, entries[i].boundsMin, entries[i].boundsMax);
+		GrowBounds(centroidMin, centroidMax, entries[i].centroid, entries[i].centroid);
+	}
+
+	std::copy(boundsMin, boundsMin + 3, m_nodes[nodeIndex].boundsMin);
+	std::copy(boundsMax, boundsMax + 3, m_nodes[nodeIndex].boundsMax);
+
+	const size_t count = end - begin;
+	const auto makeLeaf = [&]()
+	{
+		m_nodes[nodeIndex].offset = static_cast<uint32_t>(begin);
+		m_nodes[nodeIndex].count = static_cast<uint32_t>(count);
+		return nodeIndex;
+	};
+
+	if (count <= MaxLeafSize || depth >= MaxDepth)
+	{
+		return makeLeaf();
+	}
+
+	// Binned SAH: bucket the centroids along each axis and try a split between every pair of bins
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		const float binScale = BinCount / extent;
+		float binMin[BinCount][3], binMax[BinCount][3];
+		size_t binCounts[BinCount] = {};
+
+		for (int bin = 0; bin < BinCount; bin++)
+		{
+			ResetBounds(binMin[bin], binMax[bin]);
+		}
+
+		for (size_t i = begin; i < end; i++)
+		{
+			const int bin = std::min(BinCount - 1, static_cast<int>((entries[i].centroid[axis] - centroidMin[axis]) * binScale));
+			binCounts[bin]++;
+			GrowBounds(binMin[bin], binMax[bin], entries[i].boundsMin, entries[i].boundsMax);
+		}
+
+		// Sweep from the right to get the area and count right of every split
+		float rightAreas[BinCount];
+		size_t rightCounts[BinCount];
+		float sweepMin[3], sweepMax[3];
+		size_t sweepCount = 0;
+		ResetBounds(sweepMin, sweepMax);
+
+		for (int bin = BinCount - 1; bin > 0; bin--)
+		{
+			GrowBounds(sweepMin, sweepMax, binMin[bin], binMax[bin]);
+			sweepCount += binCounts[bin];
+			rightAreas[bin] = sweepCount > 0 ? SurfaceArea(sweepMin, sweepMax) : 0.0f;
+			rightCounts[bin] = sweepCount;
+		}
+
+		ResetBounds(sweepMin, sweepMax);
+		sweepCount = 0;
+
+		for (int split = 1; split < BinCount; split++)
+		{
+			GrowBounds(sweepMin, sweepMax, binMin[split - 1], binMax[split - 1]);
+			sweepCount += binCounts[split - 1];
+
+			if (sweepCount == 0 || rightCounts[split] == 0)
+			{
+				continue;
+			}
+
+			const float cost = SurfaceArea(sweepMin, sweepMax) * sweepCount + rightAreas[split] * rightCounts[split];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	size_t middle = begin;
+
+	if (bestAxis >= 0)
+	{
+		// Splitting must beat testing every capsule in one leaf
+		const float splitCost = TraversalCost + IntersectionCost * bestCost / SurfaceArea(boundsMin, boundsMax);
+		if (splitCost >= IntersectionCost * count)
+		{
+			return makeLeaf();
+		}
+
+		const float binScale = BinCount / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+		middle = std::partition(entries.begin() + begin, entries.begin() + end, [&](const BuildEntry& entry)
+		{
+			return std::min(BinCount - 1, static_cast<int>((entry.centroid[bestAxis] - centroidMin[bestAxis]) * binScale)) < bestSplit;
+		}) - entries.begin();
+	}
+
+	if (middle == begin || middle == end)
+	{
+		// All centroids coincide; halve the range so the tree still terminates
+		middle = begin + count / 2;
+	}
+
+	BuildNode(entries, begin, middle, depth + 1);
+	const uint32_t secondChild = BuildNode(entries, middle, end, depth + 1);
+
+	m_nodes[nodeIndex].offset = secondChild;
+	m_nodes[nodeIndex].count = 0;
+
+	return nodeIndex;
+}
+
+bool SegmentBVH::SegmentOverlapsSphere(const float start[3], const float end[3], float radius, const float centre[3], float sphereRadius)
+{
+	const float segment[3] = { end[0] - start[0], end[1] - start[1], end[2] - start[2] };
+	const float offset[3] = { centre[0] - start[0], centre[1] - start[1], centre[2] - start[2] };
+	const float lengthSquared = Dot(segment, segment);
+
+	// Closest point on the segment to the centre
+	float t = lengthSquared > 0.0f ? Dot(offset, segment) / lengthSquared : 0.0f;
+	t = std::max(0.0f, std::min(1.0f, t));
+
+	float distanceSquared = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float d = offset[axis] - segment[axis] * t;
+		distanceSquared += d * d;
+	}
+
+	const float reach = radius + sphereRadius;
+	return distanceSquared <= reach * reach;
+}
+
+float SegmentBVH::RaycastCapsule(const float origin[3], const float direction[3], const float start[3], const float end[3], float radius)
+{
+	if (SegmentOverlapsSphere(start, end, radius, origin, 0.0f))
+	{
+		return 0.0f;
+	}
+
+	float nearest = FLT_MAX;
+
+	// Cylinder between the caps, solved relative to the segment axis
+	const float axis[3] = { end[0] - start[0], end[1] - start[1], end[2] - start[2] };
+	const float offset[3] = { origin[0] - start[0], origin[1] - start[1], origin[2] - start[2] };
+	const float axisSquared = Dot(axis, axis);
+	const float axisDirection = Dot(axis, direction);
+	const float axisOffset = Dot(axis, offset);
+
+	const float a = axisSquared - axisDirection * axisDirection;
+	const float b = axisSquared * Dot(direction, offset) - axisOffset * axisDirection;
+	const float c = axisSquared * Dot(offset, offset) - axisOffset * axisOffset - radius * radius * axisSquared;
+	const float h = b * b - a * c;
+
+	// a is zero when the ray runs along the axis; then only the caps can be hit first
+	if (a > 1.0e-8f * axisSquared && h >= 0.0f)
+	{
+		const float t = (-b - std::sqrt(h)) / a;
+		const float y = axisOffset + t * axisDirection;
+
+		if (t >= 0.0f && y > 0.0f && y < axisSquared)
+		{
+			nearest = t;
+		}
+	}
+
+	for (const float* cap : { start, end })
+	{
+		const float t = RaycastSphere(origin, direction, cap, radius);
+		if (t >= 0.0f && t < nearest)
+		{
+			nearest = t;
+		}
+	}
+
+	return nearest < FLT_MAX ? nearest : -1.0f;
+}
+
+bool SegmentBVH::TraverseSphere(const float centre[3], float radius, std::vector<int>* results, QueryStats* stats) const
+{
+	if (m_nodes.empty())
+	{
+		return false;
+	}
+
+	uint32_t stack[StackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	bool found = false;
+
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+
+		if (stats)
+		{
+			stats->nodesVisited++;
+		}
+
+		if (SphereBoxDistanceSquared(centre, node.boundsMin, node.boundsMax) > radius * radius)
+		{
+			continue;
+		}
+
+		if (node.count == 0)
+		{
+			stack[stackSize++] = node.offset;
+			stack[stackSize++] = static_cast<uint32_t>(&node - m_nodes.data()) + 1;
+			continue;
+		}
+
+		for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+		{
+			const Primitive& primitive = m_primitives[i];
+
+			if (stats)
+			{
+				stats->segmentsTested++;
+			}
+
+			if (!SegmentOverlapsSphere(primitive.start, primitive.end, m_radius, centre, radius))
+			{
+				continue;
+			}
+
+			if (!results)
+			{
+				return true;
+			}
+
+			results->push_back(primitive.segment);
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+void SegmentBVH::QuerySphere(const float centre[3], float radius, std::vector<int>& results, QueryStats* stats) const
+{
+	TraverseSphere(centre, radius, &results, stats);
+}
+
+bool SegmentBVH::IntersectsSphere(const float centre[3], float radius, QueryStats* stats) const
+{
+	return TraverseSphere(centre, radius, nullptr, stats);
+}
+
+bool SegmentBVH::Raycast(const float origin[3], const float direction[3], float maxDistance, RayHit& hit, QueryStats* stats) const
+{
+	if (m_nodes.empty())
+	{
+		return false;
+	}
+
+	float inverseDirection[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// FLT_MAX rather than infinity, so a ray lying in a slab plane gives 0 instead of NaN
+		inverseDirection[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : FLT_MAX;
+	}
+
+	hit.segment = -1;
+	hit.distance = maxDistance;
+
+	struct StackEntry
+	{
+		uint32_t node;
+		float entry;
+	};
+
+	StackEntry stack[StackSize];
+	int stackSize = 0;
+
+	const float rootEntry = RayBoxEntry(origin, inverseDirection, maxDistance, m_nodes[0].boundsMin, m_nodes[0].boundsMax);
+	if (rootEntry != FLT_MAX)
+	{
+		stack[stackSize++] = { 0, rootEntry };
+	}
+
+	while (stackSize > 0)
+	{
+		const StackEntry current = stack[--stackSize];
+
+		// A closer hit may have been found since this node was pushed
+		if (current.entry > hit.distance)
+		{
+			continue;
+		}
+
+		const Node& node = m_nodes[current.node];
+
+		if (stats)
+		{
+			stats->nodesVisited++;
+		}
+
+		if (node.count == 0)
+		{
+			const uint32_t children[2] = { current.node + 1, node.offset };
+			float entries[2];
+
+			for (int child = 0; child < 2; child++)
+			{
+				const Node& childNode = m_nodes[children[child]];
+				entries[child] = RayBoxEntry(origin, inverseDirection, hit.distance, childNode.boundsMin, childNode.boundsMax);
+			}
+
+			// Push the farther child first so the nearer one is visited next
+			const int nearer = entries[0] <= entries[1] ? 0 : 1;
+			const int farther = 1 - nearer;
+
+			if (entries[farther] != FLT_MAX)
+			{
+				stack[stackSize++] = { children[farther], entries[farther] };
+			}
+			if (entries[nearer] != FLT_MAX)
+			{
+				stack[stackSize++] = { children[nearer], entries[nearer] };
+			}
+			continue;
+		}
+
+		for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+		{
+			const Primitive& primitive = m_primitives[i];
+
+			if (stats)
+			{
+				stats->segmentsTested++;
+			}
+
+			const float t = RaycastCapsule(origin, direction, primitive.start, primitive.end, m_radius);
+			if (t >= 0.0f && (t < hit.distance || (t == hit.distance && hit.segment < 0)))
+			{
+				hit.segment = primitive.segment;
+				hit.distance = t;
+			}
+		}
+	}
+
+	return hit.segment >= 0;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// Bounding volume hierarchy over the segments of one fractal obstacle, each treated as a capsule.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct SegmentList;
+
+class SegmentBVH
+{
+public:
+	struct RayHit
+	{
+		int segment;		// index into the SegmentList the tree was built from
+		float distance;		// along the ray, 0 if the origin is inside the capsule
+	};
+
+	// Optional counters, to see how much of the tree a query touched.
+	struct QueryStats
+	{
+		int nodesVisited = 0;
+		int segmentsTested = 0;
+	};
+
+public:
+	SegmentBVH();
+
+	void Build(const SegmentList& segments, float radius);
+	void Clear();
+
+	bool empty() const { return m_nodes.empty(); }
+	size_t GetNodeCount() const { return m_nodes.size(); }
+	int GetDepth() const { return m_depth; }
+
+	// Bounds of the whole obstacle, capsule radius included. Only valid when not empty.
+	const float* GetBoundsMin() const { return m_nodes[0].boundsMin; }
+	const float* GetBoundsMax() const { return m_nodes[0].boundsMax; }
+
+	// Appends the index of every segment whose capsule overlaps the sphere.
+	void QuerySphere(const float centre[3], float radius, std::vector<int>& results, QueryStats* stats = nullptr) const;
+	// Stops at the first overlapping segment.
+	bool IntersectsSphere(const float centre[3], float radius, QueryStats* stats = nullptr) const;
+
+	// direction must be unit length. Returns false if nothing is hit within maxDistance.
+	bool Raycast(const float origin[3], const float direction[3], float maxDistance, RayHit& hit, QueryStats* stats = nullptr) const;
+
+	// The exact tests the queries run per segment, exposed so callers can check results by brute force.
+	static bool SegmentOverlapsSphere(const float start[3], const float end[3], float radius, const float centre[3], float sphereRadius);
+	// Distance to the first hit, or a negative value if the ray misses.
+	static float RaycastCapsule(const float origin[3], const float direction[3], const float start[3], const float end[3], float radius);
+
+private:
+	struct Node
+	{
+		float boundsMin[3];
+		float boundsMax[3];
+		uint32_t offset;	// leaf: first primitive; inner: index of the second child
+		uint32_t count;		// primitives in a leaf, 0 for inner nodes
+	};
+
+	struct Primitive
+	{
+		float start[3];
+		float end[3];
+		int segment;
+	};
+
+	struct BuildEntry
+	{
+		float boundsMin[3];
+		float boundsMax[3];
+		float centroid[3];
+		int segment;
+	};
+
+	uint32_t BuildNode(std::vector<BuildEntry>& entries, size_t begin, size_t end, int depth);
+	bool TraverseSphere(const float centre[3], float radius, std::vector<int>* results, QueryStats* stats) const;
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<Primitive> m_primitives;
+	float m_radius;
+	int m_depth;
+};
@@ -11,7 +11,7 @@ Shader::~Shader()
 {
 }
 
-bool Shader::InitStandard(ID3D11Device * device, WCHAR * vsFilename, WCHAR * psFilename, const bool isPostProcess)
+bool Shader::InitStandard(ID3D11Device * device, WCHAR * vsFilename, WCHAR * psFilename, const bool isPostProcess, const bool isInstanced)
 {
 	D3D11_BUFFER_DESC	matrixBufferDesc;
 	D3D11_SAMPLER_DESC	samplerDesc;
@@ -45,6 +45,28 @@ bool Shader::InitStandard(ID3D11Device * device, WCHAR * vsFilename, WCHAR * psF
 		// Create the vertex input layout.
 		device->CreateInputLayout(polygonLayout, numElements, vertexShaderBuffer.data(), vertexShaderBuffer.size(), &m_layout);
 	}
+	else if (isInstanced)
+	{
+		// Slot 0 is the model's vertices, slot 1 holds one world matrix (four rows) per instance.
+		D3D11_INPUT_ELEMENT_DESC polygonLayout[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "COLOUR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+			{ "INSTANCEWORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEWORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEWORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEWORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+		};
+
+		// Get a count of the elements in the layout.
+		unsigned int numElements;
+		numElements = sizeof(polygonLayout) / sizeof(polygonLayout[0]);
+
+		// Create the vertex input layout.
+		device->CreateInputLayout(polygonLayout, numElements, vertexShaderBuffer.data(), vertexShaderBuffer.size(), &m_layout);
+	}
 	else
 	{
 		D3D11_INPUT_ELEMENT_DESC polygonLayout[] =
@@ -110,6 +132,28 @@ bool Shader::InitStandard(ID3D11Device * device, WCHAR * vsFilename, WCHAR * psF
 
 		device->CreateBuffer(&postProcessBufferDesc, NULL, &m_postProcessBuffer);
 	}
+	else
+	{
+		// Setup material buffer, starting out black (no tint)
+		D3D11_BUFFER_DESC materialBufferDesc;
+		materialBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		materialBufferDesc.ByteWidth = sizeof(MaterialBufferType);
+		materialBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		materialBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		materialBufferDesc.MiscFlags = 0;
+		materialBufferDesc.StructureByteStride = 0;
+
+		MaterialBufferType material;
+		material.colour = DirectX::SimpleMath::Vector4::Zero;
+
+		D3D11_SUBRESOURCE_DATA materialData;
+		materialData.pSysMem = &material;
+		materialData.SysMemPitch = 0;
+		materialData.SysMemSlicePitch = 0;
+
+		device->CreateBuffer(&materialBufferDesc, &materialData, &m_materialBuffer);
+		m_materialColour = material.colour;
+	}
 
 	// Create a texture sampler state description.
 	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
@@ -211,6 +255,28 @@ bool Shader::SetShaderParameters(ID3D11DeviceContext* context,
 	return false;
 }
 
+void Shader::SetMaterialColour(ID3D11DeviceContext* context, const DirectX::SimpleMath::Vector4& colour)
+{
+	if (!m_materialBuffer)
+	{
+		return;
+	}
+
+	// Recolouring a model is free; the buffer is only written when consecutive draws differ.
+	if (colour != m_materialColour)
+	{
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		context->Map(m_materialBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+		MaterialBufferType* materialPtr = (MaterialBufferType*)mappedResource.pData;
+		materialPtr->colour = colour;
+		context->Unmap(m_materialBuffer, 0);
+
+		m_materialColour = colour;
+	}
+
+	context->PSSetConstantBuffers(1, 1, &m_materialBuffer);
+}
+
 void Shader::EnableShader(ID3D11DeviceContext * context)
 {
 	context->IASetInputLayout(m_layout);							//set the input layout for the shader to match out geometry
@@ -13,7 +13,8 @@ public:
 
 	//we could extend this to load in only a vertex shader, only a pixel shader etc.  or specialised init for Geometry or domain shader. 
 	//All the methods here simply create new versions corresponding to your needs
-	bool InitStandard(ID3D11Device * device, WCHAR * vsFilename, WCHAR * psFilename, const bool isPostProcess = false);		//Loads the Vert / pixel Shader pair
+	//isInstanced adds a per-instance world matrix stream in input slot 1 (see light_instanced_vs.hlsl)
+	bool InitStandard(ID3D11Device * device, WCHAR * vsFilename, WCHAR * psFilename, const bool isPostProcess = false, const bool isInstanced = false);		//Loads the Vert / pixel Shader pair
 	bool SetShaderParameters(ID3D11DeviceContext* context,
 		DirectX::SimpleMath::Matrix* world, DirectX::SimpleMath::Matrix* view, DirectX::SimpleMath::Matrix* projection,
 		Light* sceneLight1, ID3D11ShaderResourceView* texture1);
@@ -21,6 +22,8 @@ public:
 		DirectX::SimpleMath::Matrix  *world, DirectX::SimpleMath::Matrix  *view, DirectX::SimpleMath::Matrix  *projection, 
 		Light *sceneLight1, ID3D11ShaderResourceView* texture1, int effectType, float vignetteIntensity);
 	void EnableShader(ID3D11DeviceContext * context);
+	//tints everything drawn until the next call, zero for none; only re-uploads when the colour changes
+	void SetMaterialColour(ID3D11DeviceContext * context, const DirectX::SimpleMath::Vector4& colour);
 
 private:
 	//standard matrix buffer supplied to all shaders
@@ -47,6 +50,12 @@ private:
 		float padding;
 	};
 
+	//per-draw material, in the slot the post process buffer uses for its own shader
+	struct MaterialBufferType
+	{
+		DirectX::SimpleMath::Vector4 colour;
+	};
+
 	struct PostProcessBufferType
 	{
 		int effectType;
@@ -62,5 +71,7 @@ private:
 	ID3D11SamplerState*														m_sampleState;
 	ID3D11Buffer*															m_lightBuffer;
 	ID3D11Buffer*														    m_postProcessBuffer;
+	ID3D11Buffer*															m_materialBuffer = nullptr;
+	DirectX::SimpleMath::Vector4											m_materialColour;		//what m_materialBuffer currently holds
 };
 
@@ -0,0 +1,301 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Entries covering more cells than this go in the large list, so one cannot flood the table.
+	const int MaxCellsPerAxis = 16;
+
+	int ToCell(float value, float inverseCellSize)
+	{
+		return static_cast<int>(std::floor(value * inverseCellSize));
+	}
+}
+
+SpatialHash::SpatialHash(float cellSize)
+	: m_bucketMask(0), m_queryStamp(0)
+{
+	SetCellSize(cellSize);
+	Clear();
+}
+
+void SpatialHash::SetCellSize(float cellSize)
+{
+	m_cellSize = cellSize > 0.0f ? cellSize : 1.0f;
+	m_inverseCellSize = 1.0f / m_cellSize;
+}
+
+void SpatialHash::Clear()
+{
+	m_boundsMin.clear();
+	m_boundsMax.clear();
+	m_records.clear();
+	m_largeEntries.clear();
+	m_bucketStarts.assign(2, 0);
+	m_bucketMask = 0;
+}
+
+int SpatialHash::Add(const float boundsMin[3], const float boundsMax[3])
+{
+	m_boundsMin.insert(m_boundsMin.end(), boundsMin, boundsMin + 3);
+	m_boundsMax.insert(m_boundsMax.end(), boundsMax, boundsMax + 3);
+
+	return GetEntryCount() - 1;
+}
+
+bool SpatialHash::GetCellRange(const float boundsMin[3], const float boundsMax[3], int cellMin[3], int cellMax[3]) const
+{
+	bool fits = true;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		cellMin[axis] = ToCell(boundsMin[axis], m_inverseCellSize);
+		cellMax[axis] = std::max(cellMin[axis], ToCell(boundsMax[axis], m_inverseCellSize));
+
+		if (cellMax[axis] - cellMin[axis] >= MaxCellsPerAxis)
+		{
+			cellMax[axis] = cellMin[axis] + MaxCellsPerAxis - 1;
+			fits = false;
+		}
+	}
+
+	return fits;
+}
+
+uint32_t SpatialHash::GetBucket(int x, int y, int z) const
+{
+	uint32_t hash = static_cast<uint32_t>(x) * 73856093u;
+	hash ^= static_cast<uint32_t>(y) * 19349663u;
+	hash ^= static_cast<uint32_t>(z) * 83492791u;
+	return (hash ^ (hash >> 16)) & m_bucketMask;
+}
+
+bool SpatialHash::Overlaps(int a, int b) const
+{
+	const float* minA = &m_boundsMin[a * 3];
+	const float* maxA = &m_boundsMax[a * 3];
+	const float* minB = &m_boundsMin[b * 3];
+	const float* maxB = &m_boundsMax[b * 3];
+
+	return minA[0] <= maxB[0] && minB[0] <= maxA[0] &&
+		minA[1] <= maxB[1] && minB[1] <= maxA[1] &&
+		minA[2] <= maxB[2] && minB[2] <= maxA[2];
+}
+
+void SpatialHash::Build()
+{
+	const int entryCount = GetEntryCount();
+
+	// One record per covered cell; first count them to size the table.
+	size_t recordCount = 0;
+	m_isLarge.assign(entryCount, 0);
+	m_largeEntries.clear();
+
+	for (int entry = 0; entry < entryCount; entry++)
+	{
+		int cellMin[3], cellMax[3];
+		if (!GetCellRange(&m_boundsMin[entry * 3], &m_boundsMax[entry * 3], cellMin, cellMax))
+		{
+			m_isLarge[entry] = 1;
+			m_largeEntries.push_back(entry);
+			continue;
+		}
+
+		recordCount += static_cast<size_t>(cellMax[0] - cellMin[0] + 1) * (cellMax[1] - cellMin[1] + 1) * (cellMax[2] - cellMin[2] + 1);
+	}
+
+	size_t bucketCount = 1;
+	while (bucketCount < recordCount * 2)
+	{
+		bucketCount *= 2;
+	}
+	m_bucketMask = static_cast<uint32_t>(bucketCount - 1);
+
+	// Counting sort of the records by bucket.
+	m_bucketStarts.assign(bucketCount + 1, 0);
+	m_records.resize(recordCount);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (int entry = 0; entry < entryCount; entry++)
+		{
+			if (m_isLarge[entry])
+			{
+				continue;
+			}
+
+			int cellMin[3], cellMax[3];
+			GetCellRange(&m_boundsMin[entry * 3], &m_boundsMax[entry * 3], cellMin, cellMax);
+
+			for (int z = cellMin[2]; z <= cellMax[2]; z++)
+			{
+				for (int y = cellMin[1]; y <= cellMax[1]; y++)
+				{
+					for (int x = cellMin[0]; x <= cellMax[0]; x++)
+					{
+						const uint32_t bucket = GetBucket(x, y, z);
+
+						if (pass == 0)
+						{
+							m_bucketStarts[bucket + 1]++;
+						}
+						else
+						{
+							Record& record = m_records[m_bucketStarts[bucket]++];
+							record.entry = entry;
+							record.cell[0] = x;
+							record.cell[1] = y;
+							record.cell[2] = z;
+						}
+					}
+				}
+			}
+		}
+
+		if (pass == 0)
+		{
+			// Prefix sum: each bucket's start, used as a fill cursor by the second pass.
+			for (size_t bucket = 0; bucket < bucketCount; bucket++)
+			{
+				m_bucketStarts[bucket + 1] += m_bucketStarts[bucket];
+			}
+		}
+	}
+
+	// The cursors have moved on to where each bucket ends; shift them back to the starts.
+	std::copy_backward(m_bucketStarts.begin(), m_bucketStarts.end() - 1, m_bucketStarts.end());
+	m_bucketStarts[0] = 0;
+
+	m_queryMarks.assign(entryCount, 0);
+	m_queryStamp = 0;
+}
+
+void SpatialHash::Query(const float boundsMin[3], const float boundsMax[3], std::vector<int>& results) const
+{
+	const auto overlapsBox = [&](int entry)
+	{
+		const float* entryMin = &m_boundsMin[entry * 3];
+		const float* entryMax = &m_boundsMax[entry * 3];
+
+		return entryMin[0] <= boundsMax[0] && boundsMin[0] <= entryMax[0] &&
+			entryMin[1] <= boundsMax[1] && boundsMin[1] <= entryMax[1] &&
+			entryMin[2] <= boundsMax[2] && boundsMin[2] <= entryMax[2];
+	};
+
+	int cellMin[3], cellMax[3];
+	if (!GetCellRange(boundsMin, boundsMax, cellMin, cellMax))
+	{
+		// Visiting that many cells would cost more than testing every entry.
+		for (int entry = 0; entry < GetEntryCount(); entry++)
+		{
+			if (overlapsBox(entry))
+			{
+				results.push_back(entry);
+			}
+		}
+		return;
+	}
+
+	for (int entry : m_largeEntries)
+	{
+		if (overlapsBox(entry))
+		{
+			results.push_back(entry);
+		}
+	}
+
+	if (m_records.empty())
+	{
+		return;
+	}
+
+	if (++m_queryStamp == 0)
+	{
+		std::fill(m_queryMarks.begin(), m_queryMarks.end(), 0);
+		m_queryStamp = 1;
+	}
+
+	for (int z = cellMin[2]; z <= cellMax[2]; z++)
+	{
+		for (int y = cellMin[1]; y <= cellMax[1]; y++)
+		{
+			for (int x = cellMin[0]; x <= cellMax[0]; x++)
+			{
+				const uint32_t bucket = GetBucket(x, y, z);
+
+				for (uint32_t i = m_bucketStarts[bucket]; i < m_bucketStarts[bucket + 1]; i++)
+				{
+					const int entry = m_records[i].entry;
+
+					if (m_queryMarks[entry] != m_queryStamp && overlapsBox(entry))
+					{
+						m_queryMarks[entry] = m_queryStamp;
+						results.push_back(entry);
+					}
+				}
+			}
+		}
+	}
+}
+
+void SpatialHash::FindPairs(std::vector<std::pair<int, int>>& pairs) const
+{
+	const size_t bucketCount = m_bucketStarts.size() - 1;
+
+	for (size_t bucket = 0; bucket < bucketCount; bucket++)
+	{
+		const uint32_t begin = m_bucketStarts[bucket];
+		const uint32_t end = m_bucketStarts[bucket + 1];
+
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const Record& a = m_records[i];
+
+			for (uint32_t j = i + 1; j < end; j++)
+			{
+				const Record& b = m_records[j];
+
+				if (a.cell[0] != b.cell[0] || a.cell[1] != b.cell[1] || a.cell[2] != b.cell[2] || !Overlaps(a.entry, b.entry))
+				{
+					continue;
+				}
+
+				// A pair sharing several cells is reported only from the cell holding the
+				// minimum corner of their overlap.
+				bool isOwner = true;
+				for (int axis = 0; axis < 3 && isOwner; axis++)
+				{
+					const float overlapMin = std::max(m_boundsMin[a.entry * 3 + axis], m_boundsMin[b.entry * 3 + axis]);
+					isOwner = a.cell[axis] == ToCell(overlapMin, m_inverseCellSize);
+				}
+
+				if (isOwner)
+				{
+					pairs.push_back(std::make_pair(std::min(a.entry, b.entry), std::max(a.entry, b.entry)));
+				}
+			}
+		}
+	}
+
+	// Large entries against everything else, each large/large pair once.
+	for (size_t i = 0; i < m_largeEntries.size(); i++)
+	{
+		const int large = m_largeEntries[i];
+
+		for (int entry = 0; entry < GetEntryCount(); entry++)
+		{
+			if (entry == large || !Overlaps(large, entry))
+			{
+				continue;
+			}
+
+			if (m_isLarge[entry] && entry < large)
+			{
+				continue;
+			}
+
+			pairs.push_back(std::make_pair(std::min(large, entry), std::max(large, entry)));
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Hashed-grid broad-phase over axis-aligned bounds, rebuilt whenever things move.
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class SpatialHash
+{
+public:
+	explicit SpatialHash(float cellSize = 1.0f);
+
+	// Takes effect at the next Build. Works best at about the size of a typical entry.
+	void SetCellSize(float cellSize);
+	float GetCellSize() const { return m_cellSize; }
+
+	void Clear();
+
+	// Returns the entry id, which is its insertion index since the last Clear.
+	int Add(const float boundsMin[3], const float boundsMax[3]);
+	int GetEntryCount() const { return static_cast<int>(m_boundsMin.size() / 3); }
+
+	void Build();
+
+	// Appends to results every entry whose bounds overlap the box, each once.
+	void Query(const float boundsMin[3], const float boundsMax[3], std::vector<int>& results) const;
+
+	// Appends every overlapping pair once, lower id first.
+	void FindPairs(std::vector<std::pair<int, int>>& pairs) const;
+
+private:
+	struct Record
+	{
+		int entry;
+		int cell[3];
+	};
+
+	// Returns false when the box spans more than MaxCellsPerAxis cells on some axis.
+	bool GetCellRange(const float boundsMin[3], const float boundsMax[3], int cellMin[3], int cellMax[3]) const;
+	uint32_t GetBucket(int x, int y, int z) const;
+	bool Overlaps(int a, int b) const;
+
+private:
+	float m_cellSize;
+	float m_inverseCellSize;
+
+	std::vector<float> m_boundsMin;	// xyz per entry
+	std::vector<float> m_boundsMax;
+
+	uint32_t m_bucketMask;
+	std::vector<uint32_t> m_bucketStarts;	// bucket count + 1 offsets into m_records
+	std::vector<Record> m_records;
+	std::vector<int> m_largeEntries;
+	std::vector<unsigned char> m_isLarge;	// per entry
+
+	// Per-entry marks so Query reports an entry spanning several cells once.
+	mutable std::vector<uint32_t> m_queryMarks;
+	mutable uint32_t m_queryStamp;
+};
@@ -1,14 +1,17 @@
 #include "pch.h"
 #include "Terrain.h"
-#include <random>
-#include "Utils.h"
+#include <cstring>
 
 Terrain::Terrain()
 {
-	m_terrainGeneratedToggle = false;
-
-	// Default random seed
-	m_randomSeed = static_cast<unsigned int>(std::time(nullptr));
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_uploadArena = 0;
+	m_uploadArenaSize = 0;
+	m_uploadCursor = 0;
+	m_mappedArena = nullptr;
+	m_vertexCount = 0;
+	m_indexCount = 0;
 }
 
 
@@ -19,55 +22,15 @@ Terrain::~Terrain()
 
 void Terrain::SetRandomSeed(unsigned int seed)
 {
-	m_randomSeed = seed;
+	m_heightfield.SetRandomSeed(seed);
 }
 
 bool Terrain::Initialize(ID3D11Device* device, int terrainWidth, int terrainHeight)
 {
-	int index;
-	float height = 0.0;
 	bool result;
 
-	FillVoronoiRegionColours();
-
-	// Save the dimensions of the terrain.
-	m_terrainWidth = terrainWidth;
-	m_terrainHeight = terrainHeight;
-
-	m_frequency = m_terrainWidth / 20;
-	m_amplitude = 3.0;
-	m_wavelength = 1;
-
-	// Create the structure to hold the terrain data.
-	m_heightMap = new HeightMapType[m_terrainWidth * m_terrainHeight];
-	if (!m_heightMap)
-	{
-		return false;
-	}
-
-	//this is how we calculate the texture coordinates first calculate the step size there will be between vertices. 
-	float textureCoordinatesStep = 5.0f / m_terrainWidth;  //tile 5 times across the terrain. 
-	// Initialise the data in the height map (flat).
-	for (int j = 0; j<m_terrainHeight; j++)
-	{
-		for (int i = 0; i<m_terrainWidth; i++)
-		{
-			index = (m_terrainHeight * j) + i;
-
-			m_heightMap[index].x = (float)i;
-			m_heightMap[index].y = (float)height;
-			m_heightMap[index].z = (float)j;
-
-			//and use this step to calculate the texture coordinates for this point on the terrain.
-			m_heightMap[index].u = (float)i * textureCoordinatesStep;
-			m_heightMap[index].v = (float)j * textureCoordinatesStep;
-
-		}
-	}
-
-	//even though we are generating a flat terrain, we still need to normalise it. 
-	// Calculate the normals for the terrain data.
-	result = CalculateNormals();
+	// Create the flat height map, including its normals.
+	result = m_heightfield.Initialize(terrainWidth, terrainHeight);
 	if (!result)
 	{
 		return false;
@@ -83,148 +46,30 @@ bool Terrain::Initialize(ID3D11Device* device, int terrainWidth, int terrainHeig
 	return true;
 }
 
-void Terrain::Render(ID3D11DeviceContext * deviceContext)
+void Terrain::Render(ID3D11DeviceContext * deviceContext, const DirectX::SimpleMath::Matrix& world,
+	const DirectX::SimpleMath::Matrix& view, const DirectX::SimpleMath::Matrix& projection,
+	const DirectX::SimpleMath::Vector3& cameraPosition)
 {
-	// Put the vertex and index buffers on the graphics pipeline to prepare them for drawing.
-	RenderBuffers(deviceContext);
-	deviceContext->DrawIndexed(m_indexCount, 0, 0);
+	// Cull and pick levels of detail in the terrain's local space.
+	const DirectX::SimpleMath::Matrix worldViewProjection = world * view * projection;
+	const DirectX::SimpleMath::Vector3 localCamera = DirectX::SimpleMath::Vector3::Transform(cameraPosition, world.Invert());
+	const float localCameraPosition[3] = { localCamera.x, localCamera.y, localCamera.z };
 
-	return;
-}
+	m_quadtree.SetLodDistance(m_lodDistance);
+	m_quadtree.Select(m_mesh, TerrainQuadtree::ExtractFrustum(&worldViewProjection._11), localCameraPosition, m_selection);
 
-bool Terrain::CalculateNormals()
-{
-	int i, j, index1, index2, index3, index, count;
-	float vertex1[3], vertex2[3], vertex3[3], vector1[3], vector2[3], sum[3], length;
-	DirectX::SimpleMath::Vector3* normals;
-	
-	// Create a temporary array to hold the un-normalized normal vectors.
-	normals = new DirectX::SimpleMath::Vector3[(m_terrainHeight - 1) * (m_terrainWidth - 1)];
-	if (!normals)
-	{
-		return false;
-	}
+	// Put the vertex and index buffers on the graphics pipeline to prepare them for drawing.
+	RenderBuffers(deviceContext);
 
-	// Go through all the faces in the mesh and calculate their normals.
-	for (j = 0; j<(m_terrainHeight - 1); j++)
+	// One draw per visible tile, sharing the index topology of every tile with the same shape and level.
+	for (const auto& draw : m_selection.draws)
 	{
-		for (i = 0; i<(m_terrainWidth - 1); i++)
-		{
-			index1 = (j * m_terrainHeight) + i;
-			index2 = (j * m_terrainHeight) + (i + 1);
-			index3 = ((j + 1) * m_terrainHeight) + i;
-
-			// Get three vertices from the face.
-			vertex1[0] = m_heightMap[index1].x;
-			vertex1[1] = m_heightMap[index1].y;
-			vertex1[2] = m_heightMap[index1].z;
-
-			vertex2[0] = m_heightMap[index2].x;
-			vertex2[1] = m_heightMap[index2].y;
-			vertex2[2] = m_heightMap[index2].z;
-
-			vertex3[0] = m_heightMap[index3].x;
-			vertex3[1] = m_heightMap[index3].y;
-			vertex3[2] = m_heightMap[index3].z;
-
-			// Calculate the two vectors for this face.
-			vector1[0] = vertex1[0] - vertex3[0];
-			vector1[1] = vertex1[1] - vertex3[1];
-			vector1[2] = vertex1[2] - vertex3[2];
-			vector2[0] = vertex3[0] - vertex2[0];
-			vector2[1] = vertex3[1] - vertex2[1];
-			vector2[2] = vertex3[2] - vertex2[2];
-
-			index = (j * (m_terrainHeight - 1)) + i;
-
-			// Calculate the cross product of those two vectors to get the un-normalized value for this face normal.
-			normals[index].x = (vector1[1] * vector2[2]) - (vector1[2] * vector2[1]);
-			normals[index].y = (vector1[2] * vector2[0]) - (vector1[0] * vector2[2]);
-			normals[index].z = (vector1[0] * vector2[1]) - (vector1[1] * vector2[0]);
-		}
+		const auto& tile = m_mesh.GetTiles()[draw.tile];
+		const auto& topology = m_mesh.GetTopology(tile, draw.lod);
+		deviceContext->DrawIndexed(topology.indexCount, topology.startIndex, tile.baseVertex);
 	}
 
-	// Now go through all the vertices and take an average of each face normal 	
-	// that the vertex touches to get the averaged normal for that vertex.
-	for (j = 0; j<m_terrainHeight; j++)
-	{
-		for (i = 0; i<m_terrainWidth; i++)
-		{
-			// Initialize the sum.
-			sum[0] = 0.0f;
-			sum[1] = 0.0f;
-			sum[2] = 0.0f;
-
-			// Initialize the count.
-			count = 0;
-
-			// Bottom left face.
-			if (((i - 1) >= 0) && ((j - 1) >= 0))
-			{
-				index = ((j - 1) * (m_terrainHeight - 1)) + (i - 1);
-
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-
-			// Bottom right face.
-			if ((i < (m_terrainWidth - 1)) && ((j - 1) >= 0))
-			{
-				index = ((j - 1) * (m_terrainHeight - 1)) + i;
-
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-
-			// Upper left face.
-			if (((i - 1) >= 0) && (j < (m_terrainHeight - 1)))
-			{
-				index = (j * (m_terrainHeight - 1)) + (i - 1);
-
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-
-			// Upper right face.
-			if ((i < (m_terrainWidth - 1)) && (j < (m_terrainHeight - 1)))
-			{
-				index = (j * (m_terrainHeight - 1)) + i;
-
-				sum[0] += normals[index].x;
-				sum[1] += normals[index].y;
-				sum[2] += normals[index].z;
-				count++;
-			}
-
-			// Take the average of the faces touching this vertex.
-			sum[0] = (sum[0] / (float)count);
-			sum[1] = (sum[1] / (float)count);
-			sum[2] = (sum[2] / (float)count);
-
-			// Calculate the length of this normal.
-			length = sqrt((sum[0] * sum[0]) + (sum[1] * sum[1]) + (sum[2] * sum[2]));
-
-			// Get an index to the vertex location in the height map array.
-			index = (j * m_terrainHeight) + i;
-
-			// Normalize the final shared normal for this vertex and store it in the height map array.
-			m_heightMap[index].nx = (sum[0] / length);
-			m_heightMap[index].ny = (sum[1] / length);
-			m_heightMap[index].nz = (sum[2] / length);
-		}
-	}
-
-	// Release the temporary normals.
-	delete[] normals;
-	normals = 0;
-
-	return true;
+	return;
 }
 
 void Terrain::Shutdown()
@@ -243,107 +88,52 @@ void Terrain::Shutdown()
 		m_vertexBuffer = 0;
 	}
 
+	// Release the upload arena used for edits.
+	if (m_uploadArena)
+	{
+		m_uploadArena->Release();
+		m_uploadArena = 0;
+	}
+	m_uploadArenaSize = 0;
+	m_uploadCursor = 0;
+
 	return;
 }
 
 bool Terrain::InitializeBuffers(ID3D11Device * device )
 {
-	VertexType* vertices;
-	unsigned long* indices;
 	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
 	D3D11_SUBRESOURCE_DATA vertexData, indexData;
 	HRESULT result;
-	int index, i, j;
-	int index1, index2, index3, index4; //geometric indices. 
 
-	// Calculate the number of vertices in the terrain mesh.
-	m_vertexCount = (m_terrainWidth - 1) * (m_terrainHeight - 1) * 6;
+	// Lay out the shared-vertex tiles. The index topology only changes with the grid size.
+	const bool topologyChanged = m_mesh.Build(m_heightfield.GetWidth(), m_heightfield.GetHeight());
 
-	// Set the index count to the same as the vertex count.
-	m_indexCount = m_vertexCount;
+	Heightfield::Rect changed;
+	const bool hasChanges = m_heightfield.ConsumeDirtyRect(changed);
 
-	// Create the vertex array.
-	vertices = new VertexType[m_vertexCount];
-	if (!vertices)
+	// Same layout as last time: only the vertices of tiles touching changed points need rewriting.
+	if (!topologyChanged && m_vertexBuffer && m_indexBuffer)
 	{
-		return false;
+		return hasChanges ? UpdateVertices(device, changed) : true;
 	}
 
-	// Create the index array.
-	indices = new unsigned long[m_indexCount];
-	if (!indices)
-	{
-		return false;
-	}
+	// Tile bounds for culling, which also give the depth of each tile's skirt.
+	m_quadtree.Build(m_mesh, m_heightfield);
 
-	// Initialize the index to the vertex buffer.
-	index = 0;
+	m_vertexCount = m_mesh.GetVertexCount();
+	m_indexCount = static_cast<int>(m_mesh.GetIndices().size());
 
-	for (j = 0; j < (m_terrainHeight - 1); j++)
+	// Copy every height map point into the vertex array once, in tile order.
+	m_vertices.resize(m_vertexCount);
+	for (int tile = 0; tile < static_cast<int>(m_mesh.GetTiles().size()); tile++)
 	{
-		for (i = 0; i < (m_terrainWidth - 1); i++)
-		{
-			index1 = (m_terrainHeight * j) + i;          // Bottom left.
-			index2 = (m_terrainHeight * j) + (i + 1);      // Bottom right.
-			index3 = (m_terrainHeight * (j + 1)) + i;      // Upper left.
-			index4 = (m_terrainHeight * (j + 1)) + (i + 1);  // Upper right.
-
-			// Upper left.
-			vertices[index].position = DirectX::SimpleMath::Vector3(m_heightMap[index3].x, m_heightMap[index3].y, m_heightMap[index3].z);
-			vertices[index].normal = DirectX::SimpleMath::Vector3(m_heightMap[index3].nx, m_heightMap[index3].ny, m_heightMap[index3].nz);
-			vertices[index].texture = DirectX::SimpleMath::Vector2(m_heightMap[index3].u, m_heightMap[index3].v);
-			//vertices[index].colour = GetColorByHeight(m_heightMap[index3].y);
-			vertices[index].colour = m_heightMap[index3].colour;
-			indices[index] = index;
-			index++;
-
-			// Upper right.
-			vertices[index].position = DirectX::SimpleMath::Vector3(m_heightMap[index4].x, m_heightMap[index4].y, m_heightMap[index4].z);
-			vertices[index].normal = DirectX::SimpleMath::Vector3(m_heightMap[index4].nx, m_heightMap[index4].ny, m_heightMap[index4].nz);
-			vertices[index].texture = DirectX::SimpleMath::Vector2(m_heightMap[index4].u, m_heightMap[index4].v);
-			//vertices[index].colour = GetColorByHeight(m_heightMap[index4].y);
-			vertices[index].colour = m_heightMap[index4].colour;
-			indices[index] = index;
-			index++;
-
-			// Bottom left.
-			vertices[index].position = DirectX::SimpleMath::Vector3(m_heightMap[index1].x, m_heightMap[index1].y, m_heightMap[index1].z);
-			vertices[index].normal = DirectX::SimpleMath::Vector3(m_heightMap[index1].nx, m_heightMap[index1].ny, m_heightMap[index1].nz);
-			vertices[index].texture = DirectX::SimpleMath::Vector2(m_heightMap[index1].u, m_heightMap[index1].v);
-			//vertices[index].colour = GetColorByHeight(m_heightMap[index1].y);
-			vertices[index].colour = m_heightMap[index1].colour;
-			indices[index] = index;
-			index++;
-
-			// Bottom left.
-			vertices[index].position = DirectX::SimpleMath::Vector3(m_heightMap[index1].x, m_heightMap[index1].y, m_heightMap[index1].z);
-			vertices[index].normal = DirectX::SimpleMath::Vector3(m_heightMap[index1].nx, m_heightMap[index1].ny, m_heightMap[index1].nz);
-			vertices[index].texture = DirectX::SimpleMath::Vector2(m_heightMap[index1].u, m_heightMap[index1].v);
-			//vertices[index].colour = GetColorByHeight(m_heightMap[index1].y);
-			vertices[index].colour = m_heightMap[index1].colour;
-			indices[index] = index;
-			index++;
-
-			// Upper right.
-			vertices[index].position = DirectX::SimpleMath::Vector3(m_heightMap[index4].x, m_heightMap[index4].y, m_heightMap[index4].z);
-			vertices[index].normal = DirectX::SimpleMath::Vector3(m_heightMap[index4].nx, m_heightMap[index4].ny, m_heightMap[index4].nz);
-			vertices[index].texture = DirectX::SimpleMath::Vector2(m_heightMap[index4].u, m_heightMap[index4].v);
-			//vertices[index].colour = GetColorByHeight(m_heightMap[index4].y);
-			vertices[index].colour = m_heightMap[index4].colour;
-			indices[index] = index;
-			index++;
-
-			// Bottom right.
-			vertices[index].position = DirectX::SimpleMath::Vector3(m_heightMap[index2].x, m_heightMap[index2].y, m_heightMap[index2].z);
-			vertices[index].normal = DirectX::SimpleMath::Vector3(m_heightMap[index2].nx, m_heightMap[index2].ny, m_heightMap[index2].nz);
-			vertices[index].texture = DirectX::SimpleMath::Vector2(m_heightMap[index2].u, m_heightMap[index2].v);
-			//vertices[index].colour = GetColorByHeight(m_heightMap[index2].y);
-			vertices[index].colour = m_heightMap[index2].colour;
-			indices[index] = index;
-			index++;
-		}
+		FillTileVertices(tile);
 	}
 
+	// Release any buffers built for the previous layout.
+	Shutdown();
+
 	// Set up the description of the static vertex buffer.
 	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
 	vertexBufferDesc.ByteWidth = sizeof(VertexType) * m_vertexCount;
@@ -353,7 +143,7 @@ bool Terrain::InitializeBuffers(ID3D11Device * device )
 	vertexBufferDesc.StructureByteStride = 0;
 
 	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices;
+	vertexData.pSysMem = m_vertices.data();
 	vertexData.SysMemPitch = 0;
 	vertexData.SysMemSlicePitch = 0;
 
@@ -364,16 +154,16 @@ bool Terrain::InitializeBuffers(ID3D11Device * device )
 		return false;
 	}
 
-	// Set up the description of the static index buffer.
+	// Set up the description of the static index buffer. Tiles are small enough for 16-bit indices.
 	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long) * m_indexCount;
+	indexBufferDesc.ByteWidth = sizeof(unsigned short) * m_indexCount;
 	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	indexBufferDesc.CPUAccessFlags = 0;
 	indexBufferDesc.MiscFlags = 0;
 	indexBufferDesc.StructureByteStride = 0;
 
 	// Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices;
+	indexData.pSysMem = m_mesh.GetIndices().data();
 	indexData.SysMemPitch = 0;
 	indexData.SysMemSlicePitch = 0;
 
@@ -384,785 +174,383 @@ bool Terrain::InitializeBuffers(ID3D11Device * device )
 		return false;
 	}
 
-	// Release the arrays now that the vertex and index buffers have been created and loaded.
-	delete[] vertices;
-	vertices = 0;
-
-	delete[] indices;
-	indices = 0;
-
-	return true;
-}
+	// Upload arena for later edits: a few MB at most, never more than the vertex buffer itself.
+	D3D11_BUFFER_DESC uploadArenaDesc = vertexBufferDesc;
+	uploadArenaDesc.Usage = D3D11_USAGE_DYNAMIC;
+	const UINT maxArenaBytes = UploadArenaBytes;
+	uploadArenaDesc.ByteWidth = std::min(maxArenaBytes, vertexBufferDesc.ByteWidth);
+	uploadArenaDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
 
-void Terrain::RenderBuffers(ID3D11DeviceContext * deviceContext)
-{
-	unsigned int stride;
-	unsigned int offset;
-
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType);
-	offset = 0;
-
-	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
-
-	// Set the index buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-
-	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
-	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	return;
-}
-
-bool Terrain::CalculateNormalsAndInitializeBuffers(ID3D11Device* device)
-{
-	bool result = false;
-
-	result = CalculateNormals();
-	if (!result)
+	result = device->CreateBuffer(&uploadArenaDesc, nullptr, &m_uploadArena);
+	if (FAILED(result))
 	{
 		return false;
 	}
 
-	result = InitializeBuffers(device);
-	if (!result)
-	{
-		return false;
-	}
+	// Start full, so the first edit maps with discard.
+	m_uploadArenaSize = uploadArenaDesc.ByteWidth;
+	m_uploadCursor = m_uploadArenaSize;
 
 	return true;
 }
 
-bool Terrain::GenerateHeightMap(ID3D11Device* device)
+bool Terrain::UpdateVertices(ID3D11Device* device, const Heightfield::Rect& changed)
 {
-	bool result = false;
-	int index = 0;
-	float height = 0.0;
-
-	m_frequency = (6.283/m_terrainHeight) / m_wavelength; //we want a wavelength of 1 to be a single wave over the whole terrain.  A single wave is 2 pi which is about 6.283
-
-	//loop through the terrain and set the hieghts how we want. This is where we generate the terrain
-	//in this case I will run a sin-wave through the terrain in one axis.
+	m_quadtree.Refit(m_mesh, m_heightfield, changed);
 
-	for (int j = 0; j<m_terrainHeight; j++)
+	// Collect the vertices to upload. Tiles are laid out in order, so ranges of neighbouring
+	// tiles often join up and are merged.
+	m_uploadRanges.clear();
+	const auto addRange = [&](int firstVertex, int lastVertex)
 	{
-		for (int i = 0; i<m_terrainWidth; i++)
+		if (!m_uploadRanges.empty() && m_uploadRanges.back().last == firstVertex)
 		{
-			index = (m_terrainHeight * j) + i;
-
-			m_heightMap[index].x = (float)i;
-			m_heightMap[index].y = (float)(sin((float)i *(m_frequency))*m_amplitude); 
-			m_heightMap[index].z = (float)j;
+			m_uploadRanges.back().last = lastVertex;
 		}
-	}
-
-	result = CalculateNormalsAndInitializeBuffers(device);
-	return result;
-}
-
-bool Terrain::GenerateRandomHeightMap(ID3D11Device* device)
-{
-	bool result = false;
-	int index = 0;
-
-	// Create random engine with the stored seed
-	std::mt19937 randomEngine(m_randomSeed);
-
-	// Create a uniform distribution
-	std::uniform_real_distribution<float> heightDistribution(0.0f, m_amplitude);
-
-	// Loop through the terrain and set random heights
-	for (int j = 0; j < m_terrainHeight; j++)
-	{
-		for (int i = 0; i < m_terrainWidth; i++)
+		else
 		{
-			index = (m_terrainHeight * j) + i;
-
-			// Generate random height
-			float randomHeight = heightDistribution(randomEngine);
-
-			m_heightMap[index].x = (float)i;
-			m_heightMap[index].y = randomHeight;
-			m_heightMap[index].z = (float)j;
+			m_uploadRanges.push_back({ firstVertex, lastVertex });
 		}
-	}
+	};
 
-	result = CalculateNormalsAndInitializeBuffers(device);
-	return result;
-}
-
-bool Terrain::SmoothTerrain(ID3D11Device* device, float smoothFactor)
-{
-	// Resize the smoothed heights vector if needed
-	m_smoothedHeights.resize(m_terrainWidth * m_terrainHeight);
-
-	// Create a copy of current heights for smooth calculation
-	for (int j = 0; j < m_terrainHeight; j++)
+	for (int tileIndex = 0; tileIndex < static_cast<int>(m_mesh.GetTiles().size()); tileIndex++)
 	{
-		for (int i = 0; i < m_terrainWidth; i++)
+		const auto& tile = m_mesh.GetTiles()[tileIndex];
+		if (!TerrainQuadtree::Overlaps(tile, changed))
 		{
-			int index = (m_terrainHeight * j) + i;
-			m_smoothedHeights[index] = m_heightMap[index].y;
+			continue;
 		}
-	}
 
-	// Smoothing algorithm (average neighboring heights)
-	for (int j = 1; j < m_terrainHeight - 1; j++)
-	{
-		for (int i = 1; i < m_terrainWidth - 1; i++)
-		{
-			int index = (m_terrainHeight * j) + i;
-
-			// Calculate average of neighboring heights
-			float neighborHeights[8] = {
-				m_heightMap[(m_terrainHeight * (j - 1)) + (i - 1)].y,  // top-left
-				m_heightMap[(m_terrainHeight * (j - 1)) + i].y,      // top
-				m_heightMap[(m_terrainHeight * (j - 1)) + (i + 1)].y, // top-right
-				m_heightMap[(m_terrainHeight * j) + (i - 1)].y,      // left
-				m_heightMap[(m_terrainHeight * j) + (i + 1)].y,      // right
-				m_heightMap[(m_terrainHeight * (j + 1)) + (i - 1)].y, // bottom-left
-				m_heightMap[(m_terrainHeight * (j + 1)) + i].y,      // bottom
-				m_heightMap[(m_terrainHeight * (j + 1)) + (i + 1)].y  // bottom-right
-			};
-
-			// Calculate average
-			float avgHeight = 0.0f;
-			for (float height : neighborHeights)
-			{
-				avgHeight += height;
-			}
-			avgHeight /= 8.0f;
+		FillTileVertices(tileIndex);
 
-			// Interpolate between current height and average
-			m_smoothedHeights[index] =
-				m_heightMap[index].y * (1.0f - smoothFactor) +
-				avgHeight * smoothFactor;
-		}
-	}
+		// The changed rows of the tile's grid, then its whole skirt ring (which follows its lowest point).
+		const int rowStride = tile.quadsX + 1;
+		const int firstRow = std::max(changed.minZ, tile.firstQuadZ) - tile.firstQuadZ;
+		const int lastRow = std::min(changed.maxZ, tile.firstQuadZ + tile.quadsZ) - tile.firstQuadZ;
+		const int gridVertexCount = TerrainMesh::GetGridVertexCount(tile);
 
-	// Update height map with smoothed heights
-	for (int j = 0; j < m_terrainHeight; j++)
-	{
-		for (int i = 0; i < m_terrainWidth; i++)
-		{
-			int index = (m_terrainHeight * j) + i;
-			m_heightMap[index].y = m_smoothedHeights[index];
-		}
+		addRange(tile.baseVertex + firstRow * rowStride, tile.baseVertex + (lastRow + 1) * rowStride);
+		addRange(tile.baseVertex + gridVertexCount, tile.baseVertex + TerrainMesh::GetTileVertexCount(tile));
 	}
 
-	// Recalculate normals and buffers
-	bool result = CalculateNormals();
-	if (!result)
+	if (m_uploadRanges.empty())
 	{
-		return false;
+		return true;
 	}
 
-	result = InitializeBuffers(device);
-	if (!result)
-	{
-		return false;
-	}
+	ID3D11DeviceContext* deviceContext;
+	device->GetImmediateContext(&deviceContext);
 
-	return true;
-}
+	const bool result = UploadRanges(deviceContext);
 
-bool Terrain::GenerateFaultTerrain(ID3D11Device* device)
-{
-	// Number of fault iterations
-	int numIterations = 1000;  // Adjust for more complex terrain
+	deviceContext->Release();
 
-	// Random number generator setup
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_real_distribution<> disX(0, m_terrainWidth);
-	std::uniform_real_distribution<> disZ(0, m_terrainHeight);
+	return result;
+}
 
-	for (int iteration = 0; iteration < numIterations; iteration++)
+bool Terrain::UploadRanges(ID3D11DeviceContext* deviceContext)
+{
+	for (const auto& range : m_uploadRanges)
 	{
-		// Generate random fault line
-		float pointX1 = disX(gen);
-		float pointZ1 = disZ(gen);
-		float pointX2 = disX(gen);
-		float pointZ2 = disZ(gen);
-
-		// Determine fault line direction
-		float A = pointZ1 - pointZ2;
-		float B = pointX2 - pointX1;
-		float C = pointX1 * pointZ2 - pointX2 * pointZ1;
-
-		// Height displacement
-		float displacement = 0.1f;  // Adjust for terrain roughness
-
-		// Apply fault to terrain
-		for (int z = 0; z < m_terrainHeight; z++)
+		const unsigned char* source = reinterpret_cast<const unsigned char*>(&m_vertices[range.first]);
+		UINT vertexBufferOffset = static_cast<UINT>(range.first * sizeof(VertexType));
+		UINT remaining = static_cast<UINT>((range.last - range.first) * sizeof(VertexType));
+
+		// Ranges larger than what is left of the arena go in several pieces.
+		while (remaining > 0)
 		{
-			for (int x = 0; x < m_terrainWidth; x++)
+			if (!m_mappedArena || m_uploadCursor == m_uploadArenaSize)
 			{
-				int index = z * m_terrainWidth + x;
-
-				// Determine which side of fault line
-				if ((A * x + B * z + C) > 0)
+				FlushUploadArena(deviceContext);
+
+				// Append after the data earlier copies may still be reading, or start a fresh arena when full.
+				const bool isFull = m_uploadCursor == m_uploadArenaSize;
+				D3D11_MAPPED_SUBRESOURCE mappedResource;
+				const HRESULT result = deviceContext->Map(m_uploadArena, 0,
+					isFull ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mappedResource);
+				if (FAILED(result))
 				{
-					m_heightMap[index].y += displacement;
+					m_pendingCopies.clear();
+					return false;
 				}
-				else
+
+				m_mappedArena = static_cast<unsigned char*>(mappedResource.pData);
+				if (isFull)
 				{
-					m_heightMap[index].y -= displacement;
+					m_uploadCursor = 0;
 				}
 			}
+
+			const UINT bytes = std::min(remaining, m_uploadArenaSize - m_uploadCursor);
+			std::memcpy(m_mappedArena + m_uploadCursor, source, bytes);
+			m_pendingCopies.push_back({ m_uploadCursor, vertexBufferOffset, bytes });
+
+			m_uploadCursor += bytes;
+			vertexBufferOffset += bytes;
+			source += bytes;
+			remaining -= bytes;
 		}
 	}
 
-	// Normalize and update terrain
-	CalculateNormals();
-	InitializeBuffers(device);
+	FlushUploadArena(deviceContext);
 
 	return true;
 }
 
-bool Terrain::GenerateParticleDepositionTerrain(ID3D11Device* device)
+void Terrain::FlushUploadArena(ID3D11DeviceContext* deviceContext)
 {
-	// Reset height map
-	for (int i = 0; i < m_terrainWidth * m_terrainHeight; i++)
+	if (!m_mappedArena)
 	{
-		m_heightMap[i].y = 0.0f;
+		return;
 	}
 
-	// Particle deposition parameters
-	int numParticles = 100000;  // Number of particles to drop
-	float particleDropHeight = 10.0f;  // Initial drop height
-	float erosionFactor = 0.01f;  // How much particles spread
+	deviceContext->Unmap(m_uploadArena, 0);
+	m_mappedArena = nullptr;
 
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_real_distribution<> disX(0, m_terrainWidth - 1);
-	std::uniform_real_distribution<> disZ(0, m_terrainHeight - 1);
-
-	for (int particle = 0; particle < numParticles; particle++)
+	// Copy the written pieces into the vertex buffer on the GPU.
+	for (const auto& copy : m_pendingCopies)
 	{
-		// Random drop location
-		int x = static_cast<int>(disX(gen));
-		int z = static_cast<int>(disZ(gen));
+		D3D11_BOX box;
+		box.left = copy.arenaOffset;
+		box.right = copy.arenaOffset + copy.bytes;
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
 
-		float currentHeight = particleDropHeight;
+		deviceContext->CopySubresourceRegion(m_vertexBuffer, 0, copy.vertexBufferOffset, 0, 0, m_uploadArena, 0, &box);
+	}
 
-		while (currentHeight > 0)
-		{
-			int index = z * m_terrainWidth + x;
+	m_pendingCopies.clear();
+}
 
-			// Deposit particle
-			m_heightMap[index].y += currentHeight;
+void Terrain::FillTileVertices(int tile)
+{
+	const float skirtHeight = m_quadtree.GetTileMinHeight(tile);
 
-			// Find lowest neighboring point
-			float lowestHeight = m_heightMap[index].y;
-			int lowestX = x, lowestZ = z;
+	// Skirt vertices drop to the lowest point of their tile, which covers any gap to a coarser neighbour.
+	m_mesh.ForEachTileVertex(tile, [&](int vertexIndex, int x, int z, int, bool isSkirt)
+	{
+		VertexType& vertex = m_vertices[vertexIndex];
+		const int heightMapIndex = m_heightfield.GetIndex(x, z);
+		const auto position = m_heightfield.GetPosition(x, z);
+		const auto texture = m_heightfield.GetTextureCoordinates(x, z);
+		const auto normal = m_heightfield.GetNormal(heightMapIndex);
+		const auto colour = m_heightfield.GetColour(heightMapIndex);
 
-			for (int dx = -1; dx <= 1; dx++)
-			{
-				for (int dz = -1; dz <= 1; dz++)
-				{
-					if (dx == 0 && dz == 0) continue; // Skip the current particle's position
-
-					int neighborX = x + dx;
-					int neighborZ = z + dz;
-
-					// Ensure we stay within bounds of the height map
-					if (neighborX >= 0 && neighborX < m_terrainWidth &&
-						neighborZ >= 0 && neighborZ < m_terrainHeight)
-					{
-						int neighborIndex = neighborZ * m_terrainWidth + neighborX;
-
-						// Check if this neighbor is lower
-						if (m_heightMap[neighborIndex].y < lowestHeight)
-						{
-							lowestHeight = m_heightMap[neighborIndex].y;
-							lowestX = neighborX;
-							lowestZ = neighborZ;
-						}
-					}
-				}
+		vertex.position = DirectX::SimpleMath::Vector3(position.x, isSkirt ? skirtHeight : position.y, position.z);
+		vertex.normal = DirectX::SimpleMath::Vector3(normal.x, normal.y, normal.z);
+		vertex.texture = DirectX::SimpleMath::Vector2(texture.x, texture.y);
+		vertex.colour = DirectX::SimpleMath::Vector4(colour.x, colour.y, colour.z, colour.w);
+	});
+}
 
-				// Move the particle to the lowest neighbor position
-				x = lowestX;
-				z = lowestZ;
+void Terrain::RenderBuffers(ID3D11DeviceContext * deviceContext)
+{
+	unsigned int stride;
+	unsigned int offset;
 
-				// Reduce height of the particle for spreading
-				currentHeight -= erosionFactor;
-			}
-		}
+	// Set vertex buffer stride and offset.
+	stride = sizeof(VertexType);
+	offset = 0;
 
-		// Normalize and update terrain
-		CalculateNormals();
-		InitializeBuffers(device);
+	// Set the vertex buffer to active in the input assembler so it can be rendered.
+	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
 
-		return true;
-	}
+	// Set the index buffer to active in the input assembler so it can be rendered.
+	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R16_UINT, 0);
+
+	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	return;
 }
 
-void Terrain::GeneratePermutationTable()
+bool Terrain::GenerateHeightMap(ID3D11Device* device)
 {
-	// Create and shuffle permutation table
-	m_permutation.resize(512);
-	std::vector<int> basePermutation(256);
-
-	// Initialize base permutation
-	for (int i = 0; i < 256; i++)
+	if (!m_heightfield.GenerateHeightMap())
 	{
-		basePermutation[i] = i;
+		return false;
 	}
 
-	// Shuffle the base permutation
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::shuffle(basePermutation.begin(), basePermutation.end(), gen);
+	return InitializeBuffers(device);
+}
 
-	// Duplicate the permutation to avoid overflow
-	for (int i = 0; i < 256; i++)
+bool Terrain::GenerateRandomHeightMap(ID3D11Device* device)
+{
+	if (!m_heightfield.GenerateRandomHeightMap())
 	{
-		m_permutation[i] = basePermutation[i];
-		m_permutation[i + 256] = basePermutation[i];
+		return false;
 	}
-}
 
-float Terrain::Fade(float t)
-{
-	// Smoothing function: 6t^5 - 15t^4 + 10t^3
-	return t * t * t * (t * (t * 6 - 15) + 10);
+	return InitializeBuffers(device);
 }
 
-float Terrain::Grad(int hash, float x, float y)
+bool Terrain::ApplyBrush(ID3D11Device* device, float x, float z, float radius, float strength)
 {
-	// Ensure hash is within the permutation table range
-	hash &= 255;  // Limit to 0-255
-
-	// Compute gradient based on hash
-	switch (hash & 3)
+	if (!m_heightfield.ApplyBrush(x, z, radius, strength))
 	{
-	case 0:  return  x + y;
-	case 1:  return -x + y;
-	case 2:  return  x - y;
-	case 3:  return -x - y;
-	default: return 0;
+		return false;
 	}
+
+	return InitializeBuffers(device);
 }
 
-float Terrain::PerlinNoise2D(float x, float y)
+bool Terrain::SmoothTerrain(ID3D11Device* device, float smoothFactor, int iterations)
 {
-	// Ensure we have a permutation table
-	if (m_permutation.empty())
+	if (!m_heightfield.SmoothTerrain(smoothFactor, iterations))
 	{
-		GeneratePermutationTable();
+		return false;
 	}
 
-	// Find unit grid cell containing point
-	int X = static_cast<int>(std::floor(x)) & 255;
-	int Y = static_cast<int>(std::floor(y)) & 255;
-
-	// Relative coordinates within the cell
-	x -= std::floor(x);
-	y -= std::floor(y);
-
-	// Compute fade curves for x and y
-	float u = Fade(x);
-	float v = Fade(y);
-
-	// Hash coordinates of the 4 square corners
-	int A = m_permutation[X] + Y;
-	int AA = m_permutation[A & 255];
-	int AB = m_permutation[(A + 1) & 255];
-	int B = m_permutation[(X + 1) & 255] + Y;
-	int BA = m_permutation[B & 255];
-	int BB = m_permutation[(B + 1) & 255];
-
-	// Blend corner gradients
-	return Utils::Lerp(v,
-		Utils::Lerp(u,
-			Grad(m_permutation[AA], x, y),
-			Grad(m_permutation[BA], x - 1, y)
-		),
-		Utils::Lerp(u,
-			Grad(m_permutation[AB], x, y - 1),
-			Grad(m_permutation[BB], x - 1, y - 1)
-		)
-	);
+	return InitializeBuffers(device);
 }
 
-bool Terrain::GeneratePerlinNoiseTerrain(ID3D11Device* device, float scale, int octaves)
+bool Terrain::BlurTerrain(ID3D11Device* device, float sigma, int iterations)
 {
-	bool result = false;
-
-	// Clamp octaves to prevent excessive computation
-	octaves = std::max(1, std::min(octaves, 8));
-
-	// Initialize the height map
-	for (int j = 0; j < m_terrainHeight; j++)
+	if (!m_heightfield.BlurTerrain(sigma, iterations))
 	{
-		for (int i = 0; i < m_terrainWidth; i++)
-		{
-			int index = (m_terrainHeight * j) + i;
-
-			// Scale coordinates
-			float x = static_cast<float>(i) / scale;
-			float y = static_cast<float>(j) / scale;
-
-			float amplitude = 1.0f;
-			float frequency = 1.0f;
-			float noiseValue = 0.0f;
-			float totalAmplitude = 0.0f;
-
-			// Sum noise contributions (Fractal Brownian Motion)
-			for (int o = 0; o < octaves; o++)
-			{
-				noiseValue += PerlinNoise2D(x * frequency, y * frequency) * amplitude;
-				totalAmplitude += amplitude;
-
-				// Update parameters for the next octave
-				amplitude *= 0.5f;   // Reduce amplitude for higher octaves
-				frequency *= 2.0f;   // Increase frequency for higher octaves
-			}
+		return false;
+	}
 
-			// Normalize the noise value
-			if (totalAmplitude > 0.0f)
-			{
-				noiseValue /= totalAmplitude;
-			}
+	return InitializeBuffers(device);
+}
 
-			// Scale height to desired range (adjust as needed)
-			m_heightMap[index].y = noiseValue * m_amplitude;
-		}
+bool Terrain::ApplyThermalErosion(ID3D11Device* device, float talus, float rate, int iterations)
+{
+	if (!m_heightfield.ApplyThermalErosion(talus, rate, iterations))
+	{
+		return false;
 	}
 
-	result = CalculateNormalsAndInitializeBuffers(device);
-	return result;
-
-	return true;
+	return InitializeBuffers(device);
 }
 
-DirectX::SimpleMath::Vector4 Terrain::GetColorByHeight(float height)
+bool Terrain::GenerateFaultTerrain(ID3D11Device* device, const FaultFormation::Settings& settings)
 {
-	// Define your height ranges and color mappings
-	// Adjust these values as necessary for your desired effect
-	if (height < -1.0f) return DirectX::Colors::Blue;     // Low heights (water)
-	else if (height < 0.0f) return DirectX::Colors::LightBlue; // Land below sea level
-	else if (height < 1.0f) return DirectX::Colors::Green;   // Low land
-	else if (height < 3.0f) return DirectX::Colors::DarkGreen; // Hills
-	else if (height < 5.0f) return DirectX::Colors::Brown;    // Mountains
-	else return DirectX::Colors::White;                      // Snow-capped peaks
+	if (!m_heightfield.GenerateFaultTerrain(settings))
+	{
+		return false;
+	}
+
+	return InitializeBuffers(device);
 }
 
-bool Terrain::GenerateVoronoiRegions(ID3D11Device* device, int numRegions)
+bool Terrain::GenerateParticleDepositionTerrain(ID3D11Device* device)
 {
-	bool result = false;
+	if (!m_heightfield.GenerateParticleDepositionTerrain())
+	{
+		return false;
+	}
 
-	m_randomVoronoiRegionColours.clear();
+	return InitializeBuffers(device);
+}
 
-	for each (auto voronoiRegionColour in m_voronoiRegionColours)
+bool Terrain::ErodeHydraulicDroplets(ID3D11Device* device, const HydraulicErosion::DropletSettings& settings)
+{
+	if (!m_heightfield.ErodeHydraulicDroplets(settings))
 	{
-		m_randomVoronoiRegionColours.push_back(voronoiRegionColour.first);
+		return false;
 	}
 
-	// Clear existing regions
-	m_voronoiRegions.clear();
-
-	// Random number generator setup
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_real_distribution<> disX(0, m_terrainWidth - 1);
-	std::uniform_real_distribution<> disZ(0, m_terrainHeight - 1);
-	std::uniform_real_distribution<> disHeight(-1.0f, 1.0f);
+	return InitializeBuffers(device);
+}
 
-	// Generate seed points for each region
-	for (int i = 0; i < numRegions; i++)
+bool Terrain::ErodeHydraulicGrid(ID3D11Device* device, const HydraulicErosion::GridSettings& settings)
+{
+	if (!m_heightfield.ErodeHydraulicGrid(settings))
 	{
-		VoronoiRegion region;
-		region.seedPoint = DirectX::SimpleMath::Vector2(
-			static_cast<float>(disX(gen)),
-			static_cast<float>(disZ(gen))
-		);
-		region.colour = GetRandomColour();
-		region.colourVector = m_voronoiRegionColours[region.colour];
-
-		const auto regionSize = 30.0f; // Adjust based on the terrain size
-		region.minX = std::max(0.0f, region.seedPoint.x - regionSize / 2);
-		region.maxX = std::min(static_cast<float>(m_terrainWidth - 1), region.seedPoint.x + regionSize / 2);
-		region.minZ = std::max(0.0f, region.seedPoint.y - regionSize / 2);
-		region.maxZ = std::min(static_cast<float>(m_terrainHeight - 1), region.seedPoint.y + regionSize / 2);
-		
-		region.heightOffset = disHeight(gen);
-
-		m_voronoiRegions.push_back(region);
+		return false;
 	}
 
-	// Assign regions and modify terrain
-	for (int j = 0; j < m_terrainHeight; j++)
+	return InitializeBuffers(device);
+}
+
+bool Terrain::GenerateWorld(ID3D11Device* device, const Heightfield::WorldSettings& settings)
+{
+	// A cache hit skips generation entirely and only re-uploads the geometry.
+	if (!m_worldCache.Restore(settings, m_heightfield))
 	{
-		for (int i = 0; i < m_terrainWidth; i++)
+		if (!m_heightfield.GenerateWorld(settings))
 		{
-			int index = (m_terrainHeight * j) + i;
-
-			// Find the closest region seed point
-			float minDistance = std::numeric_limits<float>::max();
-			VoronoiRegion* closestRegion = nullptr;
-
-			for (auto& region : m_voronoiRegions)
-			{
-				float distance = CalculateDistance(
-					static_cast<float>(i), static_cast<float>(j),
-					region.seedPoint.x, region.seedPoint.y
-				);
-
-				if (distance < minDistance)
-				{
-					minDistance = distance;
-					closestRegion = &region;
-				}
-			}
-
-			// Modify terrain based on closest region
-			if (closestRegion)
-			{
-				// Color coding
-				m_heightMap[index].colour = closestRegion->colourVector;
-
-				// Optional height modification
-				m_heightMap[index].y += closestRegion->heightOffset * 0.5f;
-			}
+			return false;
 		}
-	}
 
-	for (auto& region : m_voronoiRegions)
-	{
-		region.position = GetRegionPosition(&region);
+		m_worldCache.Store(settings, m_heightfield);
 	}
 
-	result = CalculateNormalsAndInitializeBuffers(device);
-	return result;
+	return InitializeBuffers(device);
 }
 
-float Terrain::CalculateDistance(float x1, float y1, float x2, float y2) const
+bool Terrain::GeneratePerlinNoiseTerrain(ID3D11Device* device, float scale, int octaves)
 {
-	float dx = x1 - x2;
-	float dy = y1 - y2;
-	return std::sqrt(dx * dx + dy * dy);
-}
+	if (!m_heightfield.GeneratePerlinNoiseTerrain(scale, octaves))
+	{
+		return false;
+	}
 
-void Terrain::FillVoronoiRegionColours()
-{
-	m_voronoiRegionColours[Enums::COLOUR::White] = DirectX::Colors::White;
-	m_voronoiRegionColours[Enums::COLOUR::Red] = DirectX::Colors::Red;
-	m_voronoiRegionColours[Enums::COLOUR::Blue] = DirectX::Colors::Blue;
-	m_voronoiRegionColours[Enums::COLOUR::Green] = DirectX::Colors::Green;
-	m_voronoiRegionColours[Enums::COLOUR::Goldenrod] = DirectX::Colors::Goldenrod;
-	m_voronoiRegionColours[Enums::COLOUR::Yellow] = DirectX::Colors::Yellow;
-	m_voronoiRegionColours[Enums::COLOUR::Orange] = DirectX::Colors::Orange;
-	m_voronoiRegionColours[Enums::COLOUR::Pink] = DirectX::Colors::Pink;
-	m_voronoiRegionColours[Enums::COLOUR::SlateGray] = DirectX::Colors::SlateGray;
-	m_voronoiRegionColours[Enums::COLOUR::Violet] = DirectX::Colors::Violet;
-	m_voronoiRegionColours[Enums::COLOUR::RosyBrown] = DirectX::Colors::RosyBrown;
+	return InitializeBuffers(device);
 }
 
-const Enums::COLOUR& Terrain::GetRandomColour()
+bool Terrain::GenerateVoronoiRegions(ID3D11Device* device, int numRegions)
 {
-	//std::random_device rd;
-	//std::mt19937 gen(rd());
-	//std::uniform_real_distribution<> dis(0.0f, 1.0f);
-
-	//return DirectX::SimpleMath::Vector4(
-	//	dis(gen),  // Red
-	//	dis(gen),  // Green
-	//	dis(gen),  // Blue
-	//	1.0f       // Full opacity
-	//);
-
-	const auto voronoiRegionColourCount = m_randomVoronoiRegionColours.size();
-	const auto randomIndex = Utils::GetRandomInt(0, voronoiRegionColourCount - 1);
-	const auto randomColour = m_randomVoronoiRegionColours[randomIndex];
-
-	for (int i = 0; i < m_randomVoronoiRegionColours.size(); i++)
+	if (!m_heightfield.GenerateVoronoiRegions(numRegions))
 	{
-		if (i != randomIndex)
-		{
-			continue;
-		}
-
-		m_randomVoronoiRegionColours.erase(m_randomVoronoiRegionColours.begin() + i);
-		break;
+		return false;
 	}
 
-	return randomColour;
+	return InitializeBuffers(device);
 }
 
 bool Terrain::Update()
 {
-	return true; 
+	return true;
 }
 
 float* Terrain::GetWavelength()
 {
-	return &m_wavelength;
+	return m_heightfield.GetWavelength();
 }
 
 float* Terrain::GetAmplitude()
 {
-	return &m_amplitude;
+	return m_heightfield.GetAmplitude();
 }
 
-const Enums::COLOUR& Terrain::GetRandomVoronoiRegionColour() const
+const Enums::COLOUR& Terrain::GetRandomVoronoiRegionColour()
 {
-	const auto voronoiRegionsCount = m_voronoiRegions.size();
-	const auto randomIndex = Utils::GetRandomInt(0, voronoiRegionsCount - 1);
-	const auto randomRegion = m_voronoiRegions[randomIndex];
-
-	return randomRegion.colour;
+	return m_heightfield.GetRandomVoronoiRegionColour();
 }
 
-const Enums::COLOUR& Terrain::GetRegionColourAtPosition(const float x, const float z)
+const Enums::COLOUR& Terrain::GetRegionColourAtPosition(const float x, const float z) const
 {
-	float minDistance = std::numeric_limits<float>::max();
-	VoronoiRegion* closestRegion = nullptr;
-
-	for (auto& region : m_voronoiRegions)
-	{
-		const float distance = CalculateDistance(x, z, region.position.x, region.position.z);
-
-		if (distance < minDistance)
-		{
-			closestRegion = &region;
-			minDistance = distance;
-		}
-	}
-
-	if (!closestRegion)
-	{
-		return Enums::COLOUR::White;
-	}
-
-	return closestRegion->colour;
-
-	//const float EPSILON = 0.001f; // Tolerance for floating-point precision
-
-	//for (const auto& region : m_voronoiRegions)
-	//{
-	//	// Check if (x,z) is within the region's bounds (with tolerance)
-	//	const bool withinX = (x >= region.minX - EPSILON) && (x <= region.maxX + EPSILON);
-	//	const bool withinZ = (z >= region.minZ - EPSILON) && (z <= region.maxZ + EPSILON);
-
-	//	if (withinX && withinZ)
-	//	{
-	//		return region.colour;
-	//	}
-	//}
-
-	//// Fallback: Return default colour if no region found
-	//static Enums::COLOUR defaultColour = Enums::COLOUR::White;
-	//return defaultColour;
+	return m_heightfield.GetRegionColourAtPosition(x, z);
 }
 
-const DirectX::SimpleMath::Vector4& Terrain::GetVoronoiRegionColourVector(const Enums::COLOUR& colour) const
+void Terrain::GetRegionColoursAtPositions(const std::vector<Heightfield::Float2>& localPositions, std::vector<Enums::COLOUR>& colours) const
 {
-	return m_voronoiRegionColours.at(colour);
+	colours.resize(localPositions.size());
+	m_heightfield.GetRegionColoursAtPositions(localPositions.data(), static_cast<int>(localPositions.size()), colours.data());
 }
 
-const DirectX::SimpleMath::Vector3& Terrain::GetRegionPosition(VoronoiRegion* region) const
+DirectX::SimpleMath::Vector4 Terrain::GetVoronoiRegionColourVector(const Enums::COLOUR& colour) const
 {
-	DirectX::SimpleMath::Vector3 regionPosition(0.0f, 0.0f, 0.0f);
-	int pointCount = 0;
-
-	// Iterate through terrain height map
-	for (int j = 0; j < m_terrainHeight; j++)
-	{
-		for (int i = 0; i < m_terrainWidth; i++)
-		{
-			int index = (m_terrainHeight * j) + i;
-
-			// Check if point belongs to this region
-			if (IsPointInRegion(i, j, region))
-			{
-				regionPosition.x += m_heightMap[index].x;
-				regionPosition.y += m_heightMap[index].y;
-				regionPosition.z += m_heightMap[index].z;
-				pointCount++;
-			}
-		}
-	}
-
-	// Calculate average if points found
-	if (pointCount > 0)
-	{
-		regionPosition.x /= pointCount;
-		regionPosition.y /= pointCount;
-		regionPosition.z /= pointCount;
-	}
-
-	return regionPosition;
-}
-
-const bool Terrain::IsPointInRegion(int x, int z, VoronoiRegion* region) const
-{
-	//const bool withinBounds = (x >= region->minX && x <= region->maxX &&
-	//							z >= region->minZ && z <= region->maxZ);
-	//return withinBounds;
-
-	float distance = CalculateDistance(
-		static_cast<float>(x),
-		static_cast<float>(z),
-		region->seedPoint.x,
-		region->seedPoint.y
-	);
-
-	// Use bounding box size as maximum distance
-	float maxDistance = std::max(
-		region->maxX - region->minX,
-		region->maxZ - region->minZ
-	) / 2.0f;
-
-	return distance <= maxDistance;
+	const auto& colourVector = m_heightfield.GetVoronoiRegionColourVector(colour);
+	return DirectX::SimpleMath::Vector4(colourVector.x, colourVector.y, colourVector.z, colourVector.w);
 }
 
 float Terrain::GetHeightAt(float x, float z) const
 {
-	// Clamp x and z to terrain grid coordinates
-	x = Utils::Clamp(x, 0.0f, static_cast<float>(m_terrainWidth - 1));
-	z = Utils::Clamp(z, 0.0f, static_cast<float>(m_terrainHeight - 1));
-
-	int x0 = static_cast<int>(x);
-	int z0 = static_cast<int>(z);
-	float fracX = x - x0;
-	float fracZ = z - z0;
-
-	int x1 = std::min(x0 + 1, m_terrainWidth - 1);
-	int z1 = std::min(z0 + 1, m_terrainHeight - 1);
-
-	// Access height values using the same indexing as in Initialize()
-	float h00 = m_heightMap[z0 * m_terrainHeight + x0].y;
-	float h10 = m_heightMap[z0 * m_terrainHeight + x1].y;
-	float h01 = m_heightMap[z1 * m_terrainHeight + x0].y;
-	float h11 = m_heightMap[z1 * m_terrainHeight + x1].y;
-
-	// Bilinear interpolation
-	float h = (1 - fracX) * (1 - fracZ) * h00 +
-		fracX * (1 - fracZ) * h10 +
-		(1 - fracX) * fracZ * h01 +
-		fracX * fracZ * h11;
-
-	return h;
+	return m_heightfield.GetHeightAt(x, z);
 }
 
-const DirectX::SimpleMath::Vector3& Terrain::GetRandomPosition() const
+DirectX::SimpleMath::Vector3 Terrain::GetRandomPosition()
 {
-	DirectX::SimpleMath::Vector3 randomPosition(0.0f, 0.0f, 0.0f);
-	const auto randomHeightIndex = Utils::GetRandomInt(0, m_terrainHeight - 1);
-	const auto randomWidthIndex = Utils::GetRandomInt(0, m_terrainWidth - 1);
-
-	const int randomIndex = (m_terrainHeight * randomHeightIndex) + randomWidthIndex;
-
-	randomPosition.x += m_heightMap[randomIndex].x;
-	randomPosition.y += m_heightMap[randomIndex].y;
-	randomPosition.z += m_heightMap[randomIndex].z;
+	const auto localPosition = m_heightfield.GetRandomPosition();
+	DirectX::SimpleMath::Vector3 randomPosition(localPosition.x, localPosition.y, localPosition.z);
 
 	//Convert from local to world position
 	randomPosition = (randomPosition * m_Scale) + m_Translation;
 
 	return randomPosition;
-}
\ No newline at end of file
+}
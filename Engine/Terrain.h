@@ -1,7 +1,10 @@
 #pragma once
 
 #include "Enums.h"
-#include <map>
+#include "Heightfield.h"
+#include "TerrainMesh.h"
+#include "TerrainQuadtree.h"
+#include "WorldCache.h"
 
 using namespace DirectX;
 
@@ -16,31 +19,16 @@ private:
 		DirectX::SimpleMath::Vector4 colour;
 	};
 
-	struct HeightMapType
-	{
-		float x, y, z;
-		float nx, ny, nz;
-		float u, v;
-		DirectX::SimpleMath::Vector4 colour;
-	};
-
-	struct VoronoiRegion
-	{
-		DirectX::SimpleMath::Vector2 seedPoint;
-		DirectX::SimpleMath::Vector4 colourVector;
-		DirectX::SimpleMath::Vector3 position;
-		Enums::COLOUR colour;
-		float minX, maxX;
-		float minZ, maxZ;
-		float heightOffset;
-	};
-
 public:
+	using VoronoiRegion = Heightfield::VoronoiRegion;
+
 	Terrain();
 	~Terrain();
 
 	bool Initialize(ID3D11Device*, int terrainWidth, int terrainHeight);
-	void Render(ID3D11DeviceContext*);
+	// Draws the tiles inside the view frustum, each at a level of detail chosen from its distance to the camera.
+	void Render(ID3D11DeviceContext*, const DirectX::SimpleMath::Matrix& world, const DirectX::SimpleMath::Matrix& view,
+		const DirectX::SimpleMath::Matrix& projection, const DirectX::SimpleMath::Vector3& cameraPosition);
 	bool Update();
 
 	float* GetWavelength();
@@ -52,77 +40,96 @@ public:
 	void SetTranslation(const DirectX::SimpleMath::Vector3& translation) { m_Translation = translation; }
 	const DirectX::SimpleMath::Vector3& GetTranslation() const { return m_Translation; }
 
-	// For random height map
+	// Reseeds every terrain generator
 	void SetRandomSeed(unsigned int seed);
+	WorldGenContext& GetWorldGenContext() { return m_heightfield.GetWorldGenContext(); }
+
+	// Generates (or restores from the cache) the world for these settings.
+	bool GenerateWorld(ID3D11Device* device, const Heightfield::WorldSettings& settings);
+	const WorldCache& GetWorldCache() const { return m_worldCache; }
+
 	bool GenerateRandomHeightMap(ID3D11Device*);
 
 	bool GenerateHeightMap(ID3D11Device*);
 	bool GeneratePerlinNoiseTerrain(ID3D11Device* device, float scale = 1.0f, int octaves = 4);
 	bool GenerateVoronoiRegions(ID3D11Device* device, int numRegions);
 
-	const Enums::COLOUR& GetRandomVoronoiRegionColour() const;
-	const Enums::COLOUR& GetRegionColourAtPosition(const float x, const float z);
-	const DirectX::SimpleMath::Vector4& GetVoronoiRegionColourVector(const Enums::COLOUR& colour) const;
-	const std::vector<VoronoiRegion>& GetVoronoiRegions() const { return m_voronoiRegions; }
+	const Enums::COLOUR& GetRandomVoronoiRegionColour();
+	const Enums::COLOUR& GetRegionColourAtPosition(const float x, const float z) const;
+	void GetRegionColoursAtPositions(const std::vector<Heightfield::Float2>& localPositions, std::vector<Enums::COLOUR>& colours) const;
+	DirectX::SimpleMath::Vector4 GetVoronoiRegionColourVector(const Enums::COLOUR& colour) const;
+	const std::vector<VoronoiRegion>& GetVoronoiRegions() const { return m_heightfield.GetVoronoiRegions(); }
 
 	float GetHeightAt(float x, float z) const;
-	int GetWidth() const { return m_terrainWidth; }
-	int GetHeight() const { return m_terrainHeight; }
+	int GetWidth() const { return m_heightfield.GetWidth(); }
+	int GetHeight() const { return m_heightfield.GetHeight(); }
+
+	DirectX::SimpleMath::Vector3 GetRandomPosition();
 
-	const DirectX::SimpleMath::Vector3& GetRandomPosition() const;
+	bool SmoothTerrain(ID3D11Device* device, float smoothFactor, int iterations = 1);
+	bool BlurTerrain(ID3D11Device* device, float sigma, int iterations = 1);
+	bool ApplyThermalErosion(ID3D11Device* device, float talus, float rate, int iterations);
 
-	bool SmoothTerrain(ID3D11Device* device, float smoothFactor);
-	bool GenerateFaultTerrain(ID3D11Device* device);
+	// Local deformation in heightfield space; only the touched tiles are re-uploaded.
+	bool ApplyBrush(ID3D11Device* device, float x, float z, float radius, float strength);
+	bool GenerateFaultTerrain(ID3D11Device* device, const FaultFormation::Settings& settings = FaultFormation::Settings());
 	bool GenerateParticleDepositionTerrain(ID3D11Device* device);
+	bool ErodeHydraulicDroplets(ID3D11Device* device, const HydraulicErosion::DropletSettings& settings);
+	bool ErodeHydraulicGrid(ID3D11Device* device, const HydraulicErosion::GridSettings& settings);
+
+	// Tiles drawn by the last Render call
+	const TerrainQuadtree::Selection& GetSelection() const { return m_selection; }
+	float* GetLodDistance() { return &m_lodDistance; }
+
+	// Height, normal and colour data this terrain uploads to the GPU.
+	Heightfield& GetHeightfield() { return m_heightfield; }
+	const Heightfield& GetHeightfield() const { return m_heightfield; }
 
 private:
-	bool CalculateNormals();
 	void Shutdown();
-	void ShutdownBuffers();
 	bool InitializeBuffers(ID3D11Device*);
+	bool UpdateVertices(ID3D11Device*, const Heightfield::Rect& changed);
+	bool UploadRanges(ID3D11DeviceContext*);
+	void FlushUploadArena(ID3D11DeviceContext*);
+	void FillTileVertices(int tile);
 	void RenderBuffers(ID3D11DeviceContext*);
-	bool CalculateNormalsAndInitializeBuffers(ID3D11Device* device);
 
-	// Perlin Noise helper methods
-	float PerlinNoise2D(float x, float y);
-	float Fade(float t);
-	float Grad(int hash, float x, float y);
-	void GeneratePermutationTable();
+private:
+	// Half-open range of vertices to upload
+	struct VertexRange
+	{
+		int first, last;
+	};
 
-	DirectX::SimpleMath::Vector4 GetColorByHeight(float height);
-	float CalculateDistance(float x1, float y1, float x2, float y2) const;
-	const Enums::COLOUR& GetRandomColour();
-	void FillVoronoiRegionColours();
-	const DirectX::SimpleMath::Vector3& GetRegionPosition(VoronoiRegion* region) const;
-	const bool IsPointInRegion(int x, int z, VoronoiRegion* region) const;
+	// Bytes of arena waiting to be copied into the vertex buffer
+	struct PendingCopy
+	{
+		UINT arenaOffset;
+		UINT vertexBufferOffset;
+		UINT bytes;
+	};
 
-private:
-	bool m_terrainGeneratedToggle;
-	int m_terrainWidth, m_terrainHeight;
+	// Edits are appended to a fixed-size dynamic upload arena and copied across on the GPU. The
+	// arena is mapped without overwriting what earlier copies may still read, and discarded
+	// (renamed by the driver) when full, so an edit never waits for the GPU.
+	static const UINT UploadArenaBytes = 4 * 1024 * 1024;
+
+	Heightfield m_heightfield;
+	WorldCache m_worldCache;
+	TerrainMesh m_mesh;
+	TerrainQuadtree m_quadtree;
+	TerrainQuadtree::Selection m_selection;
+	float m_lodDistance = 2.0f * TerrainMesh::TileQuads;
+	std::vector<VertexType> m_vertices;
 	ID3D11Buffer * m_vertexBuffer, *m_indexBuffer;
+	ID3D11Buffer* m_uploadArena;
+	UINT m_uploadArenaSize, m_uploadCursor;
+	unsigned char* m_mappedArena;
+	std::vector<VertexRange> m_uploadRanges;
+	std::vector<PendingCopy> m_pendingCopies;
 	int m_vertexCount, m_indexCount;
-	float m_frequency, m_amplitude, m_wavelength;
-	HeightMapType* m_heightMap;
-	
+
 	float m_Scale = 0.0f;
 	DirectX::SimpleMath::Vector3 m_Translation = DirectX::SimpleMath::Vector3(0.0f, 0.0f, 0.0f);
-
-	//arrays for our generated objects Made by directX
-	std::vector<VertexPositionNormalTexture> preFabVertices;
-	std::vector<uint16_t> preFabIndices;
-
-	// Random number generator for random height map
-	unsigned int m_randomSeed;
-
-	// Noise generation parameters
-	std::vector<int> m_permutation;
-
-	std::vector<VoronoiRegion> m_voronoiRegions;
-	std::map<Enums::COLOUR, DirectX::SimpleMath::Vector4> m_voronoiRegionColours;
-	std::vector<Enums::COLOUR> m_randomVoronoiRegionColours;
-
-	// Smoothing-related members
-	std::vector<float> m_smoothedHeights;
-	float m_smoothingIntensity = 0.5f;
 };
 
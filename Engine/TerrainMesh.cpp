@@ -0,0 +1,159 @@
+#include "TerrainMesh.h"
+#include <algorithm>
+
+namespace
+{
+	// Vertex columns (or rows) used at a level of detail: every step-th one, always including the last.
+	std::vector<int> GetSamples(int quads, int step)
+	{
+		std::vector<int> samples;
+		for (int i = 0; i < quads; i += step)
+		{
+			samples.push_back(i);
+		}
+		samples.push_back(quads);
+
+		return samples;
+	}
+}
+
+TerrainMesh::TerrainMesh()
+{
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesZ = 0;
+	m_vertexCount = 0;
+}
+
+bool TerrainMesh::Build(int width, int height)
+{
+	if (width == m_width && height == m_height)
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = 0;
+	m_tilesZ = 0;
+	m_vertexCount = 0;
+	m_tiles.clear();
+	m_topologies.clear();
+	m_indices.clear();
+
+	for (int z = 0; z < height - 1; z += TileQuads)
+	{
+		m_tilesZ++;
+		m_tilesX = 0;
+
+		for (int x = 0; x < width - 1; x += TileQuads)
+		{
+			m_tilesX++;
+
+			Tile tile;
+			tile.firstQuadX = x;
+			tile.firstQuadZ = z;
+			tile.quadsX = std::min(TileQuads, width - 1 - x);
+			tile.quadsZ = std::min(TileQuads, height - 1 - z);
+			tile.baseVertex = m_vertexCount;
+			tile.topology = FindOrAddTopologies(tile.quadsX, tile.quadsZ);
+
+			m_vertexCount += GetTileVertexCount(tile);
+			m_tiles.push_back(tile);
+		}
+	}
+
+	return true;
+}
+
+int TerrainMesh::FindOrAddTopologies(int quadsX, int quadsZ)
+{
+	for (int i = 0; i < static_cast<int>(m_topologies.size()); i += LodCount)
+	{
+		if (m_topologies[i].quadsX == quadsX && m_topologies[i].quadsZ == quadsZ)
+		{
+			return i;
+		}
+	}
+
+	const int first = static_cast<int>(m_topologies.size());
+	for (int lod = 0; lod < LodCount; lod++)
+	{
+		AddTopology(quadsX, quadsZ, lod);
+	}
+
+	return first;
+}
+
+void TerrainMesh::AddTopology(int quadsX, int quadsZ, int lod)
+{
+	Topology topology;
+	topology.quadsX = quadsX;
+	topology.quadsZ = quadsZ;
+	topology.lod = lod;
+	topology.startIndex = static_cast<int>(m_indices.size());
+
+	const int step = 1 << lod;
+	const std::vector<int> columns = GetSamples(quadsX, step);
+	const std::vector<int> rows = GetSamples(quadsZ, step);
+
+	const int rowStride = quadsX + 1;
+	const int gridCount = rowStride * (quadsZ + 1);
+	const auto grid = [&](int x, int z) { return static_cast<unsigned short>(z * rowStride + x); };
+
+	for (size_t j = 0; j + 1 < rows.size(); j++)
+	{
+		for (size_t i = 0; i + 1 < columns.size(); i++)
+		{
+			const unsigned short bottomLeft = grid(columns[i], rows[j]);
+			const unsigned short bottomRight = grid(columns[i + 1], rows[j]);
+			const unsigned short upperLeft = grid(columns[i], rows[j + 1]);
+			const unsigned short upperRight = grid(columns[i + 1], rows[j + 1]);
+
+			// Same winding as the original per-quad triangles.
+			m_indices.push_back(upperLeft);
+			m_indices.push_back(upperRight);
+			m_indices.push_back(bottomLeft);
+
+			m_indices.push_back(bottomLeft);
+			m_indices.push_back(upperRight);
+			m_indices.push_back(bottomRight);
+		}
+	}
+
+	// Skirts, walking each edge so that the triangles face out of the tile.
+	const auto addSkirtEdge = [&](int count, bool reverse, int skirtOffset,
+		const std::vector<int>& samples, bool alongX, int fixedCoordinate)
+	{
+		for (int n = 0; n + 1 < count; n++)
+		{
+			const int a = reverse ? samples[count - 1 - n] : samples[n];
+			const int b = reverse ? samples[count - 2 - n] : samples[n + 1];
+
+			const unsigned short gridA = alongX ? grid(a, fixedCoordinate) : grid(fixedCoordinate, a);
+			const unsigned short gridB = alongX ? grid(b, fixedCoordinate) : grid(fixedCoordinate, b);
+			const unsigned short skirtA = static_cast<unsigned short>(gridCount + skirtOffset + a);
+			const unsigned short skirtB = static_cast<unsigned short>(gridCount + skirtOffset + b);
+
+			m_indices.push_back(gridA);
+			m_indices.push_back(gridB);
+			m_indices.push_back(skirtA);
+
+			m_indices.push_back(skirtA);
+			m_indices.push_back(gridB);
+			m_indices.push_back(skirtB);
+		}
+	};
+
+	const int columnCount = static_cast<int>(columns.size());
+	const int rowCount = static_cast<int>(rows.size());
+
+	addSkirtEdge(columnCount, false, 0, columns, true, 0);                                        // bottom, +x
+	addSkirtEdge(rowCount, false, 2 * (quadsX + 1) + (quadsZ + 1), rows, false, quadsX);          // right, +z
+	addSkirtEdge(columnCount, true, quadsX + 1, columns, true, quadsZ);                           // top, -x
+	addSkirtEdge(rowCount, true, 2 * (quadsX + 1), rows, false, 0);                               // left, -z
+
+	topology.indexCount = static_cast<int>(m_indices.size()) - topology.startIndex;
+	m_topologies.push_back(topology);
+}
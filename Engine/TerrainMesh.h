@@ -0,0 +1,109 @@
+#pragma once
+
+// Tile (chunk) layout of the terrain mesh, with skirts and shared index topologies per level of detail.
+
+#include <vector>
+
+class TerrainMesh
+{
+public:
+	static const int TileQuads = 64;
+
+	// Level n samples every 2^n-th vertex of the tile.
+	static const int LodCount = 5;
+
+	struct Tile
+	{
+		int firstQuadX, firstQuadZ;   // grid position of the tile's first vertex
+		int quadsX, quadsZ;
+		int baseVertex;               // first vertex of the tile in the vertex stream
+		int topology;                 // index into GetTopologies() of the tile's level 0 topology
+	};
+
+	struct Topology
+	{
+		int quadsX, quadsZ;
+		int lod;
+		int startIndex, indexCount;
+	};
+
+public:
+	TerrainMesh();
+
+	// Lays out a width x height vertex grid. Returns true if the layout (and so the
+	// index topology) changed, false if the cached layout was kept.
+	bool Build(int width, int height);
+
+	int GetVertexCount() const { return m_vertexCount; }
+	int GetTilesX() const { return m_tilesX; }
+	int GetTilesZ() const { return m_tilesZ; }
+
+	// Row-major by tile (z * GetTilesX() + x).
+	const std::vector<Tile>& GetTiles() const { return m_tiles; }
+	const std::vector<Topology>& GetTopologies() const { return m_topologies; }
+	const std::vector<unsigned short>& GetIndices() const { return m_indices; }
+
+	const Topology& GetTopology(const Tile& tile, int lod) const { return m_topologies[tile.topology + lod]; }
+
+	// Number of grid vertices in a tile; its skirt vertices follow them.
+	static int GetGridVertexCount(const Tile& tile) { return (tile.quadsX + 1) * (tile.quadsZ + 1); }
+	static int GetTileVertexCount(const Tile& tile) { return GetGridVertexCount(tile) + 2 * (tile.quadsX + 1) + 2 * (tile.quadsZ + 1); }
+
+	// Calls function(vertex, x, z, tile, isSkirt) for every vertex in vertex stream order.
+	template <typename Function>
+	void ForEachVertex(Function function) const
+	{
+		for (int tileIndex = 0; tileIndex < static_cast<int>(m_tiles.size()); tileIndex++)
+		{
+			ForEachTileVertex(tileIndex, function);
+		}
+	}
+
+	// Same, for the vertices of a single tile.
+	template <typename Function>
+	void ForEachTileVertex(int tileIndex, Function function) const
+	{
+		const Tile& tile = m_tiles[tileIndex];
+		const int x0 = tile.firstQuadX;
+		const int z0 = tile.firstQuadZ;
+		int vertex = tile.baseVertex;
+
+		for (int z = 0; z <= tile.quadsZ; z++)
+		{
+			for (int x = 0; x <= tile.quadsX; x++)
+			{
+				function(vertex++, x0 + x, z0 + z, tileIndex, false);
+			}
+		}
+
+		// Skirt ring: bottom, top, left and right edges.
+		for (int x = 0; x <= tile.quadsX; x++)
+		{
+			function(vertex++, x0 + x, z0, tileIndex, true);
+		}
+		for (int x = 0; x <= tile.quadsX; x++)
+		{
+			function(vertex++, x0 + x, z0 + tile.quadsZ, tileIndex, true);
+		}
+		for (int z = 0; z <= tile.quadsZ; z++)
+		{
+			function(vertex++, x0, z0 + z, tileIndex, true);
+		}
+		for (int z = 0; z <= tile.quadsZ; z++)
+		{
+			function(vertex++, x0 + tile.quadsX, z0 + z, tileIndex, true);
+		}
+	}
+
+private:
+	int FindOrAddTopologies(int quadsX, int quadsZ);
+	void AddTopology(int quadsX, int quadsZ, int lod);
+
+private:
+	int m_width, m_height;
+	int m_tilesX, m_tilesZ;
+	int m_vertexCount;
+	std::vector<Tile> m_tiles;
+	std::vector<Topology> m_topologies;
+	std::vector<unsigned short> m_indices;
+};
@@ -0,0 +1,347 @@
+#include "TerrainQuadtree.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	const int AllPlanes = (1 << 6) - 1;
+}
+
+TerrainQuadtree::TerrainQuadtree()
+{
+	m_root = -1;
+	m_lodDistance = 2.0f * TerrainMesh::TileQuads;
+}
+
+void TerrainQuadtree::Build(const TerrainMesh& mesh, const Heightfield& heightfield)
+{
+	m_nodes.clear();
+	m_tileNodes.assign(mesh.GetTiles().size(), -1);
+	m_root = -1;
+
+	if (mesh.GetTiles().empty())
+	{
+		return;
+	}
+
+	m_root = BuildNode(mesh, 0, 0, mesh.GetTilesX(), mesh.GetTilesZ());
+	Refit(mesh, heightfield);
+}
+
+int TerrainQuadtree::BuildNode(const TerrainMesh& mesh, int tileX0, int tileZ0, int tileX1, int tileZ1)
+{
+	const int nodeIndex = static_cast<int>(m_nodes.size());
+	m_nodes.push_back(Node());
+
+	Node node = {};
+	node.tile = -1;
+	std::fill(std::begin(node.children), std::end(node.children), -1);
+
+	if (tileX1 - tileX0 == 1 && tileZ1 - tileZ0 == 1)
+	{
+		node.tile = tileZ0 * mesh.GetTilesX() + tileX0;
+		m_tileNodes[node.tile] = nodeIndex;
+	}
+	else
+	{
+		// Split each axis in half where it spans more than one tile.
+		const int midX = (tileX1 - tileX0 > 1) ? (tileX0 + tileX1) / 2 : tileX1;
+		const int midZ = (tileZ1 - tileZ0 > 1) ? (tileZ0 + tileZ1) / 2 : tileZ1;
+		const int ranges[4][4] =
+		{
+			{ tileX0, tileZ0, midX, midZ },
+			{ midX, tileZ0, tileX1, midZ },
+			{ tileX0, midZ, midX, tileZ1 },
+			{ midX, midZ, tileX1, tileZ1 }
+		};
+
+		int childCount = 0;
+		for (const auto& range : ranges)
+		{
+			if (range[0] < range[2] && range[1] < range[3])
+			{
+				node.children[childCount++] = BuildNode(mesh, range[0], range[1], range[2], range[3]);
+			}
+		}
+	}
+
+	m_nodes[nodeIndex] = node;
+	return nodeIndex;
+}
+
+void TerrainQuadtree::Refit(const TerrainMesh& mesh, const Heightfield& heightfield)
+{
+	Refit(mesh, heightfield, { 0, 0, heightfield.GetWidth() - 1, heightfield.GetHeight() - 1 });
+}
+
+void TerrainQuadtree::Refit(const TerrainMesh& mesh, const Heightfield& heightfield, const Heightfield::Rect& changed)
+{
+	if (m_root >= 0)
+	{
+		FitNode(m_root, mesh, heightfield, changed);
+	}
+}
+
+bool TerrainQuadtree::Overlaps(const TerrainMesh::Tile& tile, const Heightfield::Rect& rect)
+{
+	return rect.minX <= tile.firstQuadX + tile.quadsX && rect.maxX >= tile.firstQuadX &&
+		rect.minZ <= tile.firstQuadZ + tile.quadsZ && rect.maxZ >= tile.firstQuadZ;
+}
+
+void TerrainQuadtree::FitNode(int nodeIndex, const TerrainMesh& mesh, const Heightfield& heightfield,
+	const Heightfield::Rect& changed)
+{
+	Node& node = m_nodes[nodeIndex];
+
+	if (node.tile >= 0)
+	{
+		const TerrainMesh::Tile& tile = mesh.GetTiles()[node.tile];
+		if (!Overlaps(tile, changed))
+		{
+			return;
+		}
+		const auto& heights = heightfield.GetHeights();
+
+		float minY = std::numeric_limits<float>::max();
+		float maxY = std::numeric_limits<float>::lowest();
+		for (int z = tile.firstQuadZ; z <= tile.firstQuadZ + tile.quadsZ; z++)
+		{
+			const float* row = &heights[heightfield.GetIndex(tile.firstQuadX, z)];
+			for (int x = 0; x <= tile.quadsX; x++)
+			{
+				minY = std::min(minY, row[x]);
+				maxY = std::max(maxY, row[x]);
+			}
+		}
+
+		node.minX = static_cast<float>(tile.firstQuadX);
+		node.maxX = static_cast<float>(tile.firstQuadX + tile.quadsX);
+		node.minZ = static_cast<float>(tile.firstQuadZ);
+		node.maxZ = static_cast<float>(tile.firstQuadZ + tile.quadsZ);
+		node.minY = minY;
+		node.maxY = maxY;
+		return;
+	}
+
+	node.minX = node.minY = node.minZ = std::numeric_limits<float>::max();
+	node.maxX = node.maxY = node.maxZ = std::numeric_limits<float>::lowest();
+
+	for (int child : node.children)
+	{
+		if (child < 0)
+		{
+			continue;
+		}
+
+		FitNode(child, mesh, heightfield, changed);
+
+		const Node& childNode = m_nodes[child];
+		node.minX = std::min(node.minX, childNode.minX);
+		node.maxX = std::max(node.maxX, childNode.maxX);
+		node.minY = std::min(node.minY, childNode.minY);
+		node.maxY = std::max(node.maxY, childNode.maxY);
+		node.minZ = std::min(node.minZ, childNode.minZ);
+		node.maxZ = std::max(node.maxZ, childNode.maxZ);
+	}
+}
+
+void TerrainQuadtree::Select(const TerrainMesh& mesh, const Frustum& frustum, const float cameraPosition[3],
+	Selection& selection) const
+{
+	selection.draws.clear();
+	selection.visibleTiles = 0;
+	selection.culledTiles = 0;
+	selection.triangleCount = 0;
+	std::fill(std::begin(selection.tilesPerLod), std::end(selection.tilesPerLod), 0);
+
+	if (m_root >= 0)
+	{
+		SelectNode(m_root, mesh, frustum, AllPlanes, cameraPosition, selection);
+	}
+}
+
+void TerrainQuadtree::SelectNode(int nodeIndex, const TerrainMesh& mesh, const Frustum& frustum, int planeMask,
+	const float cameraPosition[3], Selection& selection) const
+{
+	const Node& node = m_nodes[nodeIndex];
+
+	// Test the box against every plane it is not already known to be inside of.
+	for (int i = 0; i < 6; i++)
+	{
+		if ((planeMask & (1 << i)) == 0)
+		{
+			continue;
+		}
+
+		const Plane& plane = frustum.planes[i];
+
+		// Corner furthest along the plane normal, and the one furthest against it.
+		const float farX = plane.a >= 0.0f ? node.maxX : node.minX;
+		const float farY = plane.b >= 0.0f ? node.maxY : node.minY;
+		const float farZ = plane.c >= 0.0f ? node.maxZ : node.minZ;
+		const float nearX = plane.a >= 0.0f ? node.minX : node.maxX;
+		const float nearY = plane.b >= 0.0f ? node.minY : node.maxY;
+		const float nearZ = plane.c >= 0.0f ? node.minZ : node.maxZ;
+
+		if (plane.a * farX + plane.b * farY + plane.c * farZ + plane.d < 0.0f)
+		{
+			int culled = 0;
+			CountTiles(nodeIndex, culled);
+			selection.culledTiles += culled;
+			return;
+		}
+
+		if (plane.a * nearX + plane.b * nearY + plane.c * nearZ + plane.d >= 0.0f)
+		{
+			planeMask &= ~(1 << i);
+		}
+	}
+
+	if (node.tile < 0)
+	{
+		for (int child : node.children)
+		{
+			if (child >= 0)
+			{
+				SelectNode(child, mesh, frustum, planeMask, cameraPosition, selection);
+			}
+		}
+		return;
+	}
+
+	// Distance from the camera to the closest point of the tile's box.
+	const float dx = std::max(std::max(node.minX - cameraPosition[0], 0.0f), cameraPosition[0] - node.maxX);
+	const float dy = std::max(std::max(node.minY - cameraPosition[1], 0.0f), cameraPosition[1] - node.maxY);
+	const float dz = std::max(std::max(node.minZ - cameraPosition[2], 0.0f), cameraPosition[2] - node.maxZ);
+	const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+	int lod = 0;
+	if (m_lodDistance > 0.0f && distance > m_lodDistance)
+	{
+		lod = static_cast<int>(std::log2(distance / m_lodDistance)) + 1;
+		lod = std::min(lod, TerrainMesh::LodCount - 1);
+	}
+
+	const TerrainMesh::Tile& tile = mesh.GetTiles()[node.tile];
+	selection.draws.push_back({ node.tile, lod });
+	selection.visibleTiles++;
+	selection.tilesPerLod[lod]++;
+	selection.triangleCount += mesh.GetTopology(tile, lod).indexCount / 3;
+}
+
+void TerrainQuadtree::CountTiles(int nodeIndex, int& count) const
+{
+	const Node& node = m_nodes[nodeIndex];
+	if (node.tile >= 0)
+	{
+		count++;
+		return;
+	}
+
+	for (int child : node.children)
+	{
+		if (child >= 0)
+		{
+			CountTiles(child, count);
+		}
+	}
+}
+
+TerrainQuadtree::Frustum TerrainQuadtree::ExtractFrustum(const float viewProjection[16])
+{
+	// Clip = (x, y, z, 1) * M, so each clip coordinate is a dot product with a column of M.
+	const auto column = [&](int c) -> Plane
+	{
+		return { viewProjection[c], viewProjection[4 + c], viewProjection[8 + c], viewProjection[12 + c] };
+	};
+	const auto combine = [](const Plane& w, float sign, const Plane& p) -> Plane
+	{
+		return { w.a + sign * p.a, w.b + sign * p.b, w.c + sign * p.c, w.d + sign * p.d };
+	};
+
+	const Plane x = column(0);
+	const Plane y = column(1);
+	const Plane z = column(2);
+	const Plane w = column(3);
+
+	Frustum frustum;
+	frustum.planes[0] = combine(w, 1.0f, x);    // left:   w + x >= 0
+	frustum.planes[1] = combine(w, -1.0f, x);   // right:  w - x >= 0
+	frustum.planes[2] = combine(w, 1.0f, y);    // bottom: w + y >= 0
+	frustum.planes[3] = combine(w, -1.0f, y);   // top:    w - y >= 0
+	frustum.planes[4] = z;                      // near:   z >= 0
+	frustum.planes[5] = combine(w, -1.0f, z);   // far:    w - z >= 0
+
+	return frustum;
+}
+
+TerrainQuadtree::Frustum TerrainQuadtree::MakeFrustum(const float eye[3], const float target[3], float fieldOfViewY,
+	float aspectRatio, float nearPlane, float farPlane)
+{
+	const auto normalize = [](float v[3])
+	{
+		const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+		if (length > 0.0f)
+		{
+			v[0] /= length;
+			v[1] /= length;
+			v[2] /= length;
+		}
+	};
+	const auto cross = [](const float a[3], const float b[3], float out[3])
+	{
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	};
+	const auto dot = [](const float a[3], const float b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+
+	// Right-handed view basis: the camera looks down -zAxis.
+	float zAxis[3] = { eye[0] - target[0], eye[1] - target[1], eye[2] - target[2] };
+	normalize(zAxis);
+
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	float xAxis[3];
+	cross(up, zAxis, xAxis);
+	normalize(xAxis);
+
+	float yAxis[3];
+	cross(zAxis, xAxis, yAxis);
+
+	const float view[16] =
+	{
+		xAxis[0], yAxis[0], zAxis[0], 0.0f,
+		xAxis[1], yAxis[1], zAxis[1], 0.0f,
+		xAxis[2], yAxis[2], zAxis[2], 0.0f,
+		-dot(xAxis, eye), -dot(yAxis, eye), -dot(zAxis, eye), 1.0f
+	};
+
+	const float yScale = 1.0f / std::tan(fieldOfViewY * 0.5f);
+	const float xScale = yScale / aspectRatio;
+	const float range = farPlane / (nearPlane - farPlane);
+
+	const float projection[16] =
+	{
+		xScale, 0.0f, 0.0f, 0.0f,
+		0.0f, yScale, 0.0f, 0.0f,
+		0.0f, 0.0f, range, -1.0f,
+		0.0f, 0.0f, range * nearPlane, 0.0f
+	};
+
+	float viewProjection[16];
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			float sum = 0.0f;
+			for (int k = 0; k < 4; k++)
+			{
+				sum += view[row * 4 + k] * projection[k * 4 + column];
+			}
+			viewProjection[row * 4 + column] = sum;
+		}
+	}
+
+	return ExtractFrustum(viewProjection);
+}
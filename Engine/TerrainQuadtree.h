@@ -0,0 +1,92 @@
+#pragma once
+
+// Quadtree over the terrain tiles that picks the visible tiles and their levels of detail.
+
+#include "Heightfield.h"
+#include "TerrainMesh.h"
+#include <vector>
+
+class TerrainQuadtree
+{
+public:
+	// a*x + b*y + c*z + d >= 0 inside
+	struct Plane
+	{
+		float a, b, c, d;
+	};
+
+	struct Frustum
+	{
+		Plane planes[6];
+	};
+
+	struct Draw
+	{
+		int tile;
+		int lod;
+	};
+
+	struct Selection
+	{
+		std::vector<Draw> draws;
+		int visibleTiles;
+		int culledTiles;
+		int triangleCount;
+		int tilesPerLod[TerrainMesh::LodCount];
+	};
+
+public:
+	TerrainQuadtree();
+
+	// Rebuilds the tree for a new tile layout and fits its bounds to the heights.
+	void Build(const TerrainMesh& mesh, const Heightfield& heightfield);
+
+	// Refits the height bounds after the heights changed but the layout did not.
+	void Refit(const TerrainMesh& mesh, const Heightfield& heightfield);
+
+	// Same, rescanning only the tiles that overlap the changed grid points.
+	void Refit(const TerrainMesh& mesh, const Heightfield& heightfield, const Heightfield::Rect& changed);
+
+	static bool Overlaps(const TerrainMesh::Tile& tile, const Heightfield::Rect& rect);
+
+	// Tiles closer than this use level 0; every doubling of the distance drops one level.
+	void SetLodDistance(float distance) { m_lodDistance = distance; }
+	float GetLodDistance() const { return m_lodDistance; }
+
+	float GetTileMinHeight(int tile) const { return m_nodes[m_tileNodes[tile]].minY; }
+
+	void Select(const TerrainMesh& mesh, const Frustum& frustum, const float cameraPosition[3],
+		Selection& selection) const;
+
+	// Planes from a row-major view-projection matrix in the row-vector (DirectX) convention,
+	// with clip space depth in [0, w]. Include the world matrix to get local-space planes.
+	static Frustum ExtractFrustum(const float viewProjection[16]);
+
+	// Local-space frustum for a right-handed look-at camera with a perspective projection,
+	// matching SimpleMath's CreateLookAt and CreatePerspectiveFieldOfView. Lets a camera pose
+	// be evaluated headlessly.
+	static Frustum MakeFrustum(const float eye[3], const float target[3], float fieldOfViewY,
+		float aspectRatio, float nearPlane, float farPlane);
+
+private:
+	struct Node
+	{
+		float minX, maxX;
+		float minY, maxY;
+		float minZ, maxZ;
+		int tile;                // -1 for inner nodes
+		int children[4];         // -1 where absent
+	};
+
+	int BuildNode(const TerrainMesh& mesh, int tileX0, int tileZ0, int tileX1, int tileZ1);
+	void FitNode(int node, const TerrainMesh& mesh, const Heightfield& heightfield, const Heightfield::Rect& changed);
+	void SelectNode(int node, const TerrainMesh& mesh, const Frustum& frustum, int planeMask,
+		const float cameraPosition[3], Selection& selection) const;
+	void CountTiles(int node, int& count) const;
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<int> m_tileNodes;
+	int m_root;
+	float m_lodDistance;
+};
@@ -0,0 +1,170 @@
+#include "Turtle.h"
+#include <cmath>
+
+namespace
+{
+	const float DegreesToRadians = 3.14159265358979f / 180.0f;
+	const float BranchLengthScale = 0.8f;
+
+	void Normalise(float v[3])
+	{
+		const float lengthSquared = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+		if (lengthSquared > 0.0f)
+		{
+			const float inverseLength = 1.0f / std::sqrt(lengthSquared);
+			v[0] *= inverseLength;
+			v[1] *= inverseLength;
+			v[2] *= inverseLength;
+		}
+	}
+}
+
+void SegmentList::clear()
+{
+	startX.clear();
+	startY.clear();
+	startZ.clear();
+	directionX.clear();
+	directionY.clear();
+	directionZ.clear();
+	length.clear();
+	world.clear();
+}
+
+Turtle::Turtle(const float startPosition[3], float angleDegrees, float segmentLength, float thickness)
+{
+	// Grow along +Y; '+' turns about +Z, as the original 2D turtle did.
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_state.position[axis] = startPosition[axis];
+		m_state.heading[axis] = axis == 1 ? 1.0f : 0.0f;
+		m_state.right[axis] = axis == 0 ? 1.0f : 0.0f;
+		m_state.up[axis] = axis == 2 ? 1.0f : 0.0f;
+	}
+
+	m_state.segmentLength = segmentLength;
+
+	m_cosAngle = std::cos(angleDegrees * DegreesToRadians);
+	m_sinAngle = std::sin(angleDegrees * DegreesToRadians);
+	m_thickness = thickness;
+}
+
+void Turtle::Interpret(const char* symbols, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		Interpret(symbols[i]);
+	}
+}
+
+void Turtle::Interpret(char symbol)
+{
+	switch (symbol)
+	{
+	case 'F':
+		AddSegment();
+		break;
+	case '+':	// Turn
+		Rotate(m_state.heading, m_state.right, -1.0f);
+		break;
+	case '-':
+		Rotate(m_state.heading, m_state.right, 1.0f);
+		break;
+	case '&':	// Pitch
+		Rotate(m_state.heading, m_state.up, 1.0f);
+		break;
+	case '^':
+		Rotate(m_state.heading, m_state.up, -1.0f);
+		break;
+	case '\\':	// Roll
+		Rotate(m_state.right, m_state.up, -1.0f);
+		break;
+	case '/':
+		Rotate(m_state.right, m_state.up, 1.0f);
+		break;
+	case '|':	// Turn around
+		for (int axis = 0; axis < 3; axis++)
+		{
+			m_state.heading[axis] = -m_state.heading[axis];
+			m_state.right[axis] = -m_state.right[axis];
+		}
+		break;
+	case '[':
+		m_stack.push_back(m_state);
+		m_state.segmentLength *= BranchLengthScale;
+		break;
+	case ']':
+		if (!m_stack.empty())
+		{
+			m_state = m_stack.back();
+			m_stack.pop_back();
+		}
+		break;
+	}
+}
+
+void Turtle::Rotate(float a[3], float b[3], float sign)
+{
+	const float s = m_sinAngle * sign;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float rotatedA = a[axis] * m_cosAngle + b[axis] * s;
+		const float rotatedB = b[axis] * m_cosAngle - a[axis] * s;
+		a[axis] = rotatedA;
+		b[axis] = rotatedB;
+	}
+
+	Orthonormalise();
+}
+
+void Turtle::Orthonormalise()
+{
+	// Keeps rounding from accumulating along long runs of rotations.
+	float* heading = m_state.heading;
+	float* right = m_state.right;
+	float* up = m_state.up;
+
+	Normalise(heading);
+
+	const float projection = heading[0] * right[0] + heading[1] * right[1] + heading[2] * right[2];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		right[axis] -= heading[axis] * projection;
+	}
+
+	Normalise(right);
+
+	// up = right x heading
+	up[0] = right[1] * heading[2] - right[2] * heading[1];
+	up[1] = right[2] * heading[0] - right[0] * heading[2];
+	up[2] = right[0] * heading[1] - right[1] * heading[0];
+}
+
+void Turtle::AddSegment()
+{
+	const State& state = m_state;
+	const float length = state.segmentLength;
+
+	float centre[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		centre[axis] = state.position[axis] + state.heading[axis] * length * 0.5f;
+	}
+
+	m_segments.startX.push_back(state.position[0]);
+	m_segments.startY.push_back(state.position[1]);
+	m_segments.startZ.push_back(state.position[2]);
+	m_segments.directionX.push_back(state.heading[0]);
+	m_segments.directionY.push_back(state.heading[1]);
+	m_segments.directionZ.push_back(state.heading[2]);
+	m_segments.length.push_back(length);
+
+	m_segments.world.emplace_back();
+	PackSegmentInstance(centre, state.heading, state.right, state.up, length, m_thickness, m_segments.world.back());
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_state.position[axis] += state.heading[axis] * length;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// 3D turtle that interprets L-system strings into obstacle segments.
+
+#include "ObstacleInstances.h"
+#include <vector>
+
+struct SegmentList
+{
+	// Start point, unit direction and length of each segment
+	std::vector<float> startX, startY, startZ;
+	std::vector<float> directionX, directionY, directionZ;
+	std::vector<float> length;
+
+	// Cached world matrix of each segment
+	std::vector<SegmentInstance> world;
+
+	size_t size() const { return length.size(); }
+	bool empty() const { return length.empty(); }
+	void clear();
+};
+
+class Turtle
+{
+public:
+	Turtle(const float startPosition[3], float angleDegrees, float segmentLength, float thickness);
+
+	// F draws a segment and moves to its end; + - turn, & ^ pitch, \ / roll, | turns around,
+	// [ ] push and pop the state (branches are 0.8x shorter).
+	void Interpret(char symbol);
+	void Interpret(const char* symbols, size_t count);
+
+	const SegmentList& GetSegments() const { return m_segments; }
+
+private:
+	struct State
+	{
+		float position[3];
+		float heading[3];
+		float right[3];
+		float up[3];
+		float segmentLength;
+	};
+
+	// Rotates a towards b by the turtle angle (sign +1 or -1) in the plane they span.
+	void Rotate(float a[3], float b[3], float sign);
+	void Orthonormalise();
+	void AddSegment();
+
+private:
+	State m_state;
+	std::vector<State> m_stack;
+	float m_cosAngle, m_sinAngle;
+	float m_thickness;
+	SegmentList m_segments;
+};
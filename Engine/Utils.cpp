@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Utils.h"
+#include <chrono>
 #include <random>
 
 namespace Utils
@@ -71,5 +72,160 @@ namespace Utils
 
             return dxA.Intersects(dxB);
         }
+
+        OBBShape ToOBBShape(const ModelClass::OBB& obb)
+        {
+            // Rows of the rotation matrix are the box's local axes in world space
+            const auto rotation = DirectX::SimpleMath::Matrix::CreateFromQuaternion(obb.orientation);
+            const DirectX::SimpleMath::Vector3 axes[3] = { rotation.Right(), rotation.Up(), rotation.Backward() };
+
+            OBBShape shape;
+            shape.centre[0] = obb.center.x;
+            shape.centre[1] = obb.center.y;
+            shape.centre[2] = obb.center.z;
+            shape.extents[0] = obb.extents.x;
+            shape.extents[1] = obb.extents.y;
+            shape.extents[2] = obb.extents.z;
+
+            for (int i = 0; i < 3; i++)
+            {
+                shape.axes[i][0] = axes[i].x;
+                shape.axes[i][1] = axes[i].y;
+                shape.axes[i][2] = axes[i].z;
+            }
+
+            return shape;
+        }
+
+        std::vector<BatchValidationResult> ValidateBatchKernels(int trials, int batchSize)
+        {
+            using Clock = std::chrono::high_resolution_clock;
+
+            struct Trial
+            {
+                ModelClass::BoundingSphere sphere;
+                ModelClass::OBB obb;
+                std::vector<ModelClass::BoundingSphere> spheres;
+                std::vector<ModelClass::OBB> obbs;
+                SphereBatch sphereBatch;
+                OBBBatch obbBatch;
+                std::vector<unsigned char> sphereExpected;
+                std::vector<unsigned char> obbExpected;
+            };
+
+            // Fixed seed so a mismatch can be reproduced
+            std::mt19937 engine(505);
+            std::uniform_real_distribution<float> position(-8.0f, 8.0f);
+            std::uniform_real_distribution<float> size(0.25f, 2.0f);
+            std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+            const auto randomSphere = [&]()
+            {
+                ModelClass::BoundingSphere sphere;
+                sphere.center = DirectX::SimpleMath::Vector3(position(engine), position(engine), position(engine));
+                sphere.radius = size(engine);
+                return sphere;
+            };
+
+            const auto randomOBB = [&]()
+            {
+                ModelClass::OBB obb;
+                obb.center = DirectX::SimpleMath::Vector3(position(engine), position(engine), position(engine));
+                obb.extents = DirectX::SimpleMath::Vector3(size(engine), size(engine), size(engine));
+                obb.orientation = DirectX::SimpleMath::Quaternion(unit(engine), unit(engine), unit(engine), unit(engine));
+                obb.orientation.Normalize();
+                return obb;
+            };
+
+            std::vector<Trial> trialData(trials);
+            const size_t pairs = static_cast<size_t>(trials) * batchSize;
+
+            for (auto& trial : trialData)
+            {
+                trial.sphere = randomSphere();
+                trial.obb = randomOBB();
+
+                for (int i = 0; i < batchSize; i++)
+                {
+                    trial.spheres.push_back(randomSphere());
+                    trial.sphereBatch.Add(&trial.spheres.back().center.x, trial.spheres.back().radius);
+
+                    trial.obbs.push_back(randomOBB());
+                    trial.obbBatch.Add(ToOBBShape(trial.obbs.back()));
+                }
+            }
+
+            // Reference results, one pair at a time
+            const auto pairwiseStart = Clock::now();
+
+            for (auto& trial : trialData)
+            {
+                trial.sphereExpected.resize(batchSize);
+                trial.obbExpected.resize(batchSize);
+
+                for (int i = 0; i < batchSize; i++)
+                {
+                    trial.sphereExpected[i] = SphereSphere(trial.sphere, trial.spheres[i]) ? 1 : 0;
+                    trial.obbExpected[i] = OBBOBB(trial.obb, trial.obbs[i]) ? 1 : 0;
+                }
+            }
+
+            const double pairwiseSeconds = std::chrono::duration<double>(Clock::now() - pairwiseStart).count();
+
+            std::vector<BatchValidationResult> results;
+            std::vector<BatchKernel> kernels = { BatchKernel::Scalar };
+
+            if (GetBestBatchKernel() != BatchKernel::Scalar)
+            {
+                kernels.push_back(BatchKernel::SSE2);
+            }
+
+            if (GetBestBatchKernel() == BatchKernel::AVX)
+            {
+                kernels.push_back(BatchKernel::AVX);
+            }
+
+            std::vector<std::vector<uint32_t>> sphereMasks(trials), obbMasks(trials);
+
+            for (const BatchKernel kernel : kernels)
+            {
+                const auto batchStart = Clock::now();
+
+                for (int t = 0; t < trials; t++)
+                {
+                    const Trial& trial = trialData[t];
+                    const OBBShape query = ToOBBShape(trial.obb);
+
+                    SphereSphereBatch(kernel, &trial.sphere.center.x, trial.sphere.radius, trial.sphereBatch, sphereMasks[t]);
+                    OBBOBBBatch(kernel, query, trial.obbBatch, obbMasks[t]);
+                }
+
+                const double batchSeconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+
+                BatchValidationResult result = {};
+                result.kernel = kernel;
+                result.pairs = pairs;
+                result.batchNanosecondsPerPair = pairs > 0 ? batchSeconds * 1.0e9 / pairs : 0.0;
+                result.pairwiseNanosecondsPerPair = pairs > 0 ? pairwiseSeconds * 1.0e9 / pairs : 0.0;
+
+                for (int t = 0; t < trials; t++)
+                {
+                    for (int i = 0; i < batchSize; i++)
+                    {
+                        const bool sphereHit = IsHit(sphereMasks[t], i);
+                        const bool obbHit = IsHit(obbMasks[t], i);
+
+                        result.sphereHits += sphereHit ? 1 : 0;
+                        result.obbHits += obbHit ? 1 : 0;
+                        result.sphereMismatches += (sphereHit != (trialData[t].sphereExpected[i] != 0)) ? 1 : 0;
+                        result.obbMismatches += (obbHit != (trialData[t].obbExpected[i] != 0)) ? 1 : 0;
+                    }
+                }
+
+                results.push_back(result);
+            }
+
+            return results;
+        }
     }
 }
\ No newline at end of file
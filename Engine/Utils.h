@@ -1,5 +1,6 @@
 #pragma once
 #include "modelclass.h"
+#include "CollisionBatch.h"
 
 namespace Utils
 {
@@ -18,6 +19,25 @@ namespace Utils
     {
         bool SphereSphere(const ModelClass::BoundingSphere& a, const ModelClass::BoundingSphere& b);
         bool OBBOBB(const ModelClass::OBB& a, const ModelClass::OBB& b);
+
+        // Converts to the plain layout the batch kernels in CollisionBatch.h take.
+        OBBShape ToOBBShape(const ModelClass::OBB& obb);
+
+        struct BatchValidationResult
+        {
+            BatchKernel kernel;
+            size_t pairs;                         // pairs tested per shape type
+            size_t sphereHits;
+            size_t obbHits;
+            size_t sphereMismatches;              // disagreements with SphereSphere
+            size_t obbMismatches;                 // disagreements with OBBOBB
+            double batchNanosecondsPerPair;       // sphere and OBB batch tests together
+            double pairwiseNanosecondsPerPair;    // SphereSphere and OBBOBB one pair at a time
+        };
+
+        // Tests random shapes against random batches with every available kernel and compares the
+        // hits with the pairwise functions above.
+        std::vector<BatchValidationResult> ValidateBatchKernels(int trials, int batchSize);
     }
 }
 
@@ -0,0 +1,84 @@
+#include "WorldCache.h"
+#include <algorithm>
+
+bool WorldCache::Key::operator==(const Key& other) const
+{
+	return settings.seed == other.settings.seed &&
+		settings.noiseScale == other.settings.noiseScale &&
+		settings.noiseOctaves == other.settings.noiseOctaves &&
+		settings.numRegions == other.settings.numRegions &&
+		width == other.width &&
+		height == other.height &&
+		amplitude == other.amplitude;
+}
+
+WorldCache::WorldCache(int capacity)
+{
+	m_capacity = std::max(1, capacity);
+	m_useCounter = 0;
+	m_hitCount = 0;
+	m_missCount = 0;
+}
+
+WorldCache::Key WorldCache::MakeKey(const Heightfield::WorldSettings& settings, const Heightfield& heightfield)
+{
+	return { settings, heightfield.GetWidth(), heightfield.GetHeight(), heightfield.GetAmplitude() };
+}
+
+bool WorldCache::Restore(const Heightfield::WorldSettings& settings, Heightfield& heightfield)
+{
+	const Key key = MakeKey(settings, heightfield);
+
+	for (auto& entry : m_entries)
+	{
+		if (entry.key == key)
+		{
+			if (!heightfield.Restore(entry.snapshot))
+			{
+				break;
+			}
+
+			entry.lastUsed = ++m_useCounter;
+			m_hitCount++;
+			return true;
+		}
+	}
+
+	m_missCount++;
+	return false;
+}
+
+void WorldCache::Store(const Heightfield::WorldSettings& settings, const Heightfield& heightfield)
+{
+	const Key key = MakeKey(settings, heightfield);
+
+	for (auto& entry : m_entries)
+	{
+		if (entry.key == key)
+		{
+			heightfield.Save(entry.snapshot);
+			entry.lastUsed = ++m_useCounter;
+			return;
+		}
+	}
+
+	if (static_cast<int>(m_entries.size()) < m_capacity)
+	{
+		m_entries.push_back({ key, Heightfield::WorldSnapshot(), ++m_useCounter });
+		heightfield.Save(m_entries.back().snapshot);
+		return;
+	}
+
+	// Evict the least recently used world
+	auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+		[](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+	oldest->key = key;
+	heightfield.Save(oldest->snapshot);
+	oldest->lastUsed = ++m_useCounter;
+}
+
+void WorldCache::Clear()
+{
+	m_entries.clear();
+}
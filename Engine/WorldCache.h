@@ -0,0 +1,45 @@
+#pragma once
+
+// Least-recently-used cache of generated worlds, keyed by world settings.
+
+#include "Heightfield.h"
+#include <vector>
+
+class WorldCache
+{
+public:
+	explicit WorldCache(int capacity = 4);
+
+	// Copies the cached world into heightfield and returns true on a hit; the grid is marked dirty.
+	bool Restore(const Heightfield::WorldSettings& settings, Heightfield& heightfield);
+	void Store(const Heightfield::WorldSettings& settings, const Heightfield& heightfield);
+	void Clear();
+
+	int GetHitCount() const { return m_hitCount; }
+	int GetMissCount() const { return m_missCount; }
+
+private:
+	struct Key
+	{
+		Heightfield::WorldSettings settings;
+		int width, height;
+		float amplitude;
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct Entry
+	{
+		Key key;
+		Heightfield::WorldSnapshot snapshot;
+		unsigned int lastUsed;
+	};
+
+	static Key MakeKey(const Heightfield::WorldSettings& settings, const Heightfield& heightfield);
+
+private:
+	int m_capacity;
+	unsigned int m_useCounter;
+	int m_hitCount, m_missCount;
+	std::vector<Entry> m_entries;
+};
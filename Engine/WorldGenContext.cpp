@@ -0,0 +1,48 @@
+#include "WorldGenContext.h"
+#include <cstdint>
+
+namespace
+{
+	// SplitMix64 finaliser, used to derive well separated per-stream seeds from the world seed.
+	unsigned int MixSeed(unsigned int seed, unsigned int stream)
+	{
+		uint64_t z = (static_cast<uint64_t>(seed) << 32) + stream + 0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z = z ^ (z >> 31);
+		return static_cast<unsigned int>(z);
+	}
+}
+
+float RandomStream::NextFloat(float min, float max)
+{
+	// Top 24 bits give every float in [0, 1) with equal spacing.
+	const float unit = (NextUInt() >> 8) * (1.0f / 16777216.0f);
+	return min + (max - min) * unit;
+}
+
+int RandomStream::NextInt(int min, int max)
+{
+	if (max <= min)
+	{
+		return min;
+	}
+
+	const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+	return static_cast<int>(min + static_cast<int64_t>((NextUInt() * range) >> 32));
+}
+
+WorldGenContext::WorldGenContext(unsigned int seed)
+{
+	SetSeed(seed);
+}
+
+void WorldGenContext::SetSeed(unsigned int seed)
+{
+	m_seed = seed;
+
+	for (int stream = 0; stream < static_cast<int>(Stream::Count); stream++)
+	{
+		m_streams[stream] = RandomStream(MixSeed(seed, static_cast<unsigned int>(stream)));
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// Seeded randomness for world generation: one stream per generator, all from a single world seed.
+
+#include <random>
+
+class RandomStream
+{
+public:
+	explicit RandomStream(unsigned int seed = 0) : m_engine(seed) {}
+
+	unsigned int NextUInt() { return static_cast<unsigned int>(m_engine()); }
+
+	// Uniform in [min, max)
+	float NextFloat(float min, float max);
+
+	// Uniform in [min, max] (inclusive)
+	int NextInt(int min, int max);
+
+	// Fisher-Yates shuffle
+	template <typename Iterator>
+	void Shuffle(Iterator first, Iterator last)
+	{
+		const int count = static_cast<int>(last - first);
+		for (int i = count - 1; i > 0; i--)
+		{
+			const int j = NextInt(0, i);
+			std::swap(first[i], first[j]);
+		}
+	}
+
+private:
+	std::mt19937 m_engine;
+};
+
+class WorldGenContext
+{
+public:
+	enum class Stream
+	{
+		Permutation,
+		HeightMap,
+		Fault,
+		Deposition,
+		Voronoi,
+		Placement,
+		Erosion,
+		Count
+	};
+
+public:
+	explicit WorldGenContext(unsigned int seed = 0);
+
+	// Restarts every stream from the new seed.
+	void SetSeed(unsigned int seed);
+	unsigned int GetSeed() const { return m_seed; }
+
+	RandomStream& GetStream(Stream stream) { return m_streams[static_cast<int>(stream)]; }
+
+private:
+	unsigned int m_seed;
+	RandomStream m_streams[static_cast<int>(Stream::Count)];
+};
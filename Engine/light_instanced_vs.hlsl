@@ -0,0 +1,61 @@
+// Instanced light vertex shader
+// Same as light_vs, but the world matrix comes from the per-instance stream (one per obstacle segment)
+
+cbuffer MatrixBuffer : register(b0)
+{
+    matrix worldMatrix;
+    matrix viewMatrix;
+    matrix projectionMatrix;
+};
+
+struct InputType
+{
+    float4 position : POSITION;
+    float2 tex : TEXCOORD0;
+    float3 normal : NORMAL;
+    float4 colour : COLOUR;
+    float4 worldRow0 : INSTANCEWORLD0;
+    float4 worldRow1 : INSTANCEWORLD1;
+    float4 worldRow2 : INSTANCEWORLD2;
+    float4 worldRow3 : INSTANCEWORLD3;
+};
+
+struct OutputType
+{
+    float4 position : SV_POSITION;
+    float2 tex : TEXCOORD0;
+    float3 normal : NORMAL;
+	float3 position3D : TEXCOORD2;
+    float4 colour : COLOUR;
+};
+
+OutputType main(InputType input)
+{
+    OutputType output;
+
+    // Instance rows are packed row-major, matching the row-vector mul below.
+    float4x4 instanceWorld = float4x4(input.worldRow0, input.worldRow1, input.worldRow2, input.worldRow3);
+
+    input.position.w = 1.0f;
+
+    // Calculate the position of the vertex against the instance world, view, and projection matrices.
+    float4 worldPosition = mul(input.position, instanceWorld);
+    output.position = mul(worldPosition, viewMatrix);
+    output.position = mul(output.position, projectionMatrix);
+
+    // Store the texture coordinates for the pixel shader.
+    output.tex = input.tex;
+
+	 // Calculate the normal vector against the instance world matrix only.
+    output.normal = mul(input.normal, (float3x3)instanceWorld);
+
+    // Normalize the normal vector.
+    output.normal = normalize(output.normal);
+
+	// world position of vertex (for point light)
+	output.position3D = worldPosition.xyz;
+
+    output.colour = input.colour;
+
+    return output;
+}
@@ -13,6 +13,12 @@ cbuffer LightBuffer : register(b0)
     float padding;
 };
 
+// Per-draw tint; black leaves the vertex colour in charge.
+cbuffer MaterialBuffer : register(b1)
+{
+    float4 materialColour;
+};
+
 struct InputType
 {
     float4 position : SV_POSITION;
@@ -44,11 +50,13 @@ float4 main(InputType input) : SV_TARGET
 	textureColor = shaderTexture.Sample(SampleType, input.tex);
 	color = color * textureColor;
     
-    isBlack = input.colour.r == 0.0f && input.colour.g == 0.0f && input.colour.b == 0.0f;
+    float4 tint = any(materialColour.rgb) ? materialColour : input.colour;
+
+    isBlack = tint.r == 0.0f && tint.g == 0.0f && tint.b == 0.0f;
     
     if (!isBlack)
     {
-        color *= input.colour;
+        color *= tint;
     }
 
     return color;
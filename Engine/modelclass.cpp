@@ -4,73 +4,66 @@
 #include "pch.h"
 #include "modelclass.h"
 #include "Utils.h"
+#include "MeshOptimizer.h"
 
 using namespace DirectX;
 
 ModelClass::ModelClass()
 {
-	m_vertexBuffer = 0;
-	m_indexBuffer = 0;
-
 }
 ModelClass::~ModelClass()
 {
 }
 
 
-bool ModelClass::InitializeModel(ID3D11Device *device, char* filename, bool isColoured)
+bool ModelClass::InitializeModel(ID3D11Device *device, char* filename)
 {
-	LoadModel(filename, isColoured);
-	InitializeBuffers(device, isColoured);
-	return false;
+	SetMesh(MeshRegistry::Acquire(device, filename));
+
+	return m_mesh != nullptr;
 }
 
 bool ModelClass::InitializeTeapot(ID3D11Device* device)
 {
-	GeometricPrimitive::CreateTeapot(preFabVertices, preFabIndices, 1, 8, false);
-	m_vertexCount	= preFabVertices.size();
-	m_indexCount	= preFabIndices.size();
+	std::vector<VertexPositionNormalTexture> vertices;
+	std::vector<uint16_t> indices;
+	GeometricPrimitive::CreateTeapot(vertices, indices, 1, 8, false);
 
-	bool result;
 	// Initialize the vertex and index buffers.
-	result = InitializeBuffers(device);
-	if(!result)
-	{
-		return false;
-	}
-	return true;
+	return InitializeBuffers(device, vertices, indices);
 }
 
 bool ModelClass::InitializeSphere(ID3D11Device *device)
 {
-	GeometricPrimitive::CreateSphere(preFabVertices, preFabIndices, 1, 8, false);
-	m_vertexCount = preFabVertices.size();
-	m_indexCount = preFabIndices.size();
+	std::vector<VertexPositionNormalTexture> vertices;
+	std::vector<uint16_t> indices;
+	GeometricPrimitive::CreateSphere(vertices, indices, 1, 8, false);
 
-	bool result;
 	// Initialize the vertex and index buffers.
-	result = InitializeBuffers(device);
-	if (!result)
-	{
-		return false;
-	}
-	return true;
+	return InitializeBuffers(device, vertices, indices);
 }
 
 bool ModelClass::InitializeBox(ID3D11Device * device, float xwidth, float yheight, float zdepth)
 {
-	GeometricPrimitive::CreateBox(preFabVertices, preFabIndices,
+	std::vector<VertexPositionNormalTexture> vertices;
+	std::vector<uint16_t> indices;
+	GeometricPrimitive::CreateBox(vertices, indices,
 		DirectX::SimpleMath::Vector3(xwidth, yheight, zdepth),false);
-	m_vertexCount = preFabVertices.size();
-	m_indexCount = preFabIndices.size();
 
-	bool result;
 	// Initialize the vertex and index buffers.
-	result = InitializeBuffers(device);
-	if (!result)
+	return InitializeBuffers(device, vertices, indices);
+}
+
+bool ModelClass::InitializeMesh(ID3D11Device* device, const void* vertices, int vertexCount, const uint32_t* indices, int indexCount)
+{
+	auto mesh = std::make_shared<MeshAsset>();
+	if (!mesh->Create(device, vertices, sizeof(VertexType), vertexCount, indices, indexCount))
 	{
 		return false;
 	}
+
+	SetMesh(std::move(mesh));
+
 	return true;
 }
 
@@ -81,18 +74,41 @@ void ModelClass::Shutdown()
 	// Shutdown the vertex and index buffers.
 	ShutdownBuffers();
 
-	// Release the model data.
-	ReleaseModel();
-
 	return;
 }
 
 
 void ModelClass::Render(ID3D11DeviceContext* deviceContext)
 {
+	if (!m_mesh)
+	{
+		return;
+	}
+
 	// Put the vertex and index buffers on the graphics pipeline to prepare them for drawing.
 	RenderBuffers(deviceContext);
-	deviceContext->DrawIndexed(m_indexCount, 0, 0);
+	deviceContext->DrawIndexed(m_mesh->indexCount, 0, 0);
+
+	return;
+}
+
+void ModelClass::RenderInstanced(ID3D11DeviceContext* deviceContext, ID3D11Buffer* instanceBuffer, unsigned int instanceStride, unsigned int instanceCount)
+{
+	if (!m_mesh)
+	{
+		return;
+	}
+
+	ID3D11Buffer* buffers[2] = { m_mesh->vertexBuffer.Get(), instanceBuffer };
+	unsigned int strides[2] = { sizeof(VertexType), instanceStride };
+	unsigned int offsets[2] = { 0, 0 };
+
+	// Model vertices in slot 0, one instance record per draw in slot 1.
+	deviceContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	deviceContext->IASetIndexBuffer(m_mesh->indexBuffer.Get(), m_mesh->indexFormat, 0);
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	deviceContext->DrawIndexedInstanced(m_mesh->indexCount, instanceCount, 0, 0, 0);
 
 	return;
 }
@@ -100,121 +116,49 @@ void ModelClass::Render(ID3D11DeviceContext* deviceContext)
 
 int ModelClass::GetIndexCount()
 {
-	return m_indexCount;
+	return m_mesh ? m_mesh->indexCount : 0;
 }
 
 
-bool ModelClass::InitializeBuffers(ID3D11Device* device, const bool isColoured)
+bool ModelClass::InitializeBuffers(ID3D11Device* device, const std::vector<VertexPositionNormalTexture>& preFabVertices, const std::vector<uint16_t>& preFabIndices)
 {
-	VertexType* vertices;
-	unsigned long* indices;
-	D3D11_BUFFER_DESC vertexBufferDesc, indexBufferDesc;
-    D3D11_SUBRESOURCE_DATA vertexData, indexData;
-	HRESULT result;
-	int i;
+	// Generated meshes are built per model and not registered, as nothing else loads them by name.
+	std::vector<VertexType> vertices(preFabVertices.size());
+	std::vector<uint32_t> indices(preFabIndices.begin(), preFabIndices.end());
 
-	// Create the vertex array.
-	vertices = new VertexType[m_vertexCount];
-	if(!vertices)
-	{
-		return false;
-	}
-
-	// Create the index array.
-	indices = new unsigned long[m_indexCount];
-	if(!indices)
-	{
-		return false;
-	}
-	
-	// Load the vertex array and index array with data from the pre-fab
-	for (i = 0; i < m_vertexCount; i++)
-	{
-		if (isColoured)
-		{
-			vertices[i].position = DirectX::SimpleMath::Vector3(preFabColouredVertices[i].position.x, preFabColouredVertices[i].position.y, preFabColouredVertices[i].position.z);
-			vertices[i].texture = DirectX::SimpleMath::Vector2(preFabColouredVertices[i].textureCoordinate.x, preFabColouredVertices[i].textureCoordinate.y);
-			vertices[i].normal = DirectX::SimpleMath::Vector3(preFabColouredVertices[i].normal.x, preFabColouredVertices[i].normal.y, preFabColouredVertices[i].normal.z);
-			vertices[i].colour = DirectX::SimpleMath::Vector4(preFabColouredVertices[i].color.x, preFabColouredVertices[i].color.y, preFabColouredVertices[i].color.z, preFabColouredVertices[i].color.w);
-		}
-		else
-		{
-			vertices[i].position = DirectX::SimpleMath::Vector3(preFabVertices[i].position.x, preFabVertices[i].position.y, preFabVertices[i].position.z);
-			vertices[i].texture = DirectX::SimpleMath::Vector2(preFabVertices[i].textureCoordinate.x, preFabVertices[i].textureCoordinate.y);
-			vertices[i].normal = DirectX::SimpleMath::Vector3(preFabVertices[i].normal.x, preFabVertices[i].normal.y, preFabVertices[i].normal.z);
-		}
-	}
-	for (i = 0; i < m_indexCount; i++)
+	// Load the vertex array with data from the pre-fab
+	for (size_t i = 0; i < vertices.size(); i++)
 	{
-		indices[i] = preFabIndices[i];
+		vertices[i].position = DirectX::SimpleMath::Vector3(preFabVertices[i].position.x, preFabVertices[i].position.y, preFabVertices[i].position.z);
+		vertices[i].texture = DirectX::SimpleMath::Vector2(preFabVertices[i].textureCoordinate.x, preFabVertices[i].textureCoordinate.y);
+		vertices[i].normal = DirectX::SimpleMath::Vector3(preFabVertices[i].normal.x, preFabVertices[i].normal.y, preFabVertices[i].normal.z);
+		vertices[i].colour = DirectX::SimpleMath::Vector4::Zero;
 	}
 
-	// Set up the description of the static vertex buffer.
-    vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    vertexBufferDesc.ByteWidth = sizeof(VertexType) * m_vertexCount;
-    vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    vertexBufferDesc.CPUAccessFlags = 0;
-    vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-
-	// Give the subresource structure a pointer to the vertex data.
-    vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
-
-	// Now create the vertex buffer.
-    result = device->CreateBuffer(&vertexBufferDesc, &vertexData, &m_vertexBuffer);
-	if(FAILED(result))
-	{
-		return false;
-	}
+	size_t vertexCount = vertices.size();
+	MeshOptimizer::OptimizeMesh(vertices.data(), sizeof(VertexType), vertexCount, indices.data(), indices.size());
 
-	// Set up the description of the static index buffer.
-    indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    indexBufferDesc.ByteWidth = sizeof(unsigned long) * m_indexCount;
-    indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    indexBufferDesc.CPUAccessFlags = 0;
-    indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-
-	// Give the subresource structure a pointer to the index data.
-    indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-
-	// Create the index buffer.
-	result = device->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer);
-	if(FAILED(result))
-	{
-		return false;
-	}
+	return InitializeMesh(device, vertices.data(), static_cast<int>(vertexCount), indices.data(), static_cast<int>(indices.size()));
+}
 
-	// Release the arrays now that the vertex and index buffers have been created and loaded.
-	delete [] vertices;
-	vertices = 0;
 
-	delete [] indices;
-	indices = 0;
+void ModelClass::SetMesh(std::shared_ptr<const MeshAsset> mesh)
+{
+	m_mesh = std::move(mesh);
 
-	return true;
+	if (m_mesh)
+	{
+		m_originalRadius = m_mesh->boundingRadius;
+		m_originalExtents = m_mesh->extents;
+		m_isTransformDirty = true;
+	}
 }
 
 
 void ModelClass::ShutdownBuffers()
 {
-	// Release the index buffer.
-	if(m_indexBuffer)
-	{
-		m_indexBuffer->Release();
-		m_indexBuffer = 0;
-	}
-
-	// Release the vertex buffer.
-	if(m_vertexBuffer)
-	{
-		m_vertexBuffer->Release();
-		m_vertexBuffer = 0;
-	}
+	// Let go of the mesh; its buffers are released once no other model holds it.
+	m_mesh.reset();
 
 	return;
 }
@@ -224,16 +168,17 @@ void ModelClass::RenderBuffers(ID3D11DeviceContext* deviceContext)
 {
 	unsigned int stride;
 	unsigned int offset;
+	ID3D11Buffer* vertexBuffer = m_mesh->vertexBuffer.Get();
 
 	// Set vertex buffer stride and offset.
 	stride = sizeof(VertexType); 
 	offset = 0;
     
 	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
 
     // Set the index buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetIndexBuffer(m_mesh->indexBuffer.Get(), m_mesh->indexFormat, 0);
 
     // Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
 	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -241,184 +186,10 @@ void ModelClass::RenderBuffers(ID3D11DeviceContext* deviceContext)
 	return;
 }
 
-
-bool ModelClass::LoadModel(char* filename, bool isColoured)
-{
-	std::vector<XMFLOAT3> verts;
-	std::vector<XMFLOAT3> norms;
-	std::vector<XMFLOAT2> texCs;
-	std::vector<unsigned int> faces;
-
-	FILE* file;// = fopen(filename, "r");
-	errno_t err;
-	err = fopen_s(&file, filename, "r");
-	if (err != 0)
-		//if (file == NULL)
-	{
-		return false;
-	}
-
-	while (true)
-	{
-		char lineHeader[128];
-
-		// Read first word of the line
-		int res = fscanf_s(file, "%s", lineHeader, sizeof(lineHeader));
-		if (res == EOF)
-		{
-			break; // exit loop
-		}
-		else // Parse
-		{
-			if (strcmp(lineHeader, "v") == 0) // Vertex
-			{
-				XMFLOAT3 vertex;
-				fscanf_s(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-				verts.push_back(vertex);
-			}
-			else if (strcmp(lineHeader, "vt") == 0) // Tex Coord
-			{
-				XMFLOAT2 uv;
-				fscanf_s(file, "%f %f\n", &uv.x, &uv.y);
-				texCs.push_back(uv);
-			}
-			else if (strcmp(lineHeader, "vn") == 0) // Normal
-			{
-				XMFLOAT3 normal;
-				fscanf_s(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-				norms.push_back(normal);
-			}
-			else if (strcmp(lineHeader, "f") == 0) // Face
-			{
-				unsigned int face[9];
-				int matches = fscanf_s(file, "%d/%d/%d %d/%d/%d %d/%d/%d\n", &face[0], &face[1], &face[2],
-					&face[3], &face[4], &face[5],
-					&face[6], &face[7], &face[8]);
-				if (matches != 9)
-				{
-					// Parser error, or not triangle faces
-					return false;
-				}
-
-				for (int i = 0; i < 9; i++)
-				{
-					faces.push_back(face[i]);
-				}
-
-
-			}
-		}
-	}
-
-	int vIndex = 0, nIndex = 0, tIndex = 0;
-	int numFaces = (int)faces.size() / 9;
-
-	//// Create the model using the vertex count that was read in.
-	m_vertexCount = numFaces * 3;
-//	model = new ModelType[vertexCount];
-
-	// "Unroll" the loaded obj information into a list of triangles.
-	for (int f = 0; f < (int)faces.size(); f += 3)
-	{
-		//increase index count
-		if (isColoured)
-		{
-			VertexPositionNormalColorTexture tempVertex;
-			tempVertex.position.x = verts[(faces[f + 0] - 1)].x;
-			tempVertex.position.y = verts[(faces[f + 0] - 1)].y;
-			tempVertex.position.z = verts[(faces[f + 0] - 1)].z;
-
-			tempVertex.textureCoordinate.x = texCs[(faces[f + 1] - 1)].x;
-			tempVertex.textureCoordinate.y = texCs[(faces[f + 1] - 1)].y;
-
-			tempVertex.normal.x = norms[(faces[f + 2] - 1)].x;
-			tempVertex.normal.y = norms[(faces[f + 2] - 1)].y;
-			tempVertex.normal.z = norms[(faces[f + 2] - 1)].z;
-
-			preFabColouredVertices.push_back(tempVertex);
-		}
-		else
-		{
-			VertexPositionNormalTexture tempVertex;
-			tempVertex.position.x = verts[(faces[f + 0] - 1)].x;
-			tempVertex.position.y = verts[(faces[f + 0] - 1)].y;
-			tempVertex.position.z = verts[(faces[f + 0] - 1)].z;
-
-			tempVertex.textureCoordinate.x = texCs[(faces[f + 1] - 1)].x;
-			tempVertex.textureCoordinate.y = texCs[(faces[f + 1] - 1)].y;
-
-			tempVertex.normal.x = norms[(faces[f + 2] - 1)].x;
-			tempVertex.normal.y = norms[(faces[f + 2] - 1)].y;
-			tempVertex.normal.z = norms[(faces[f + 2] - 1)].z;
-
-			preFabVertices.push_back(tempVertex);
-		}
-		
-		int tempIndex;
-		tempIndex = vIndex;
-		preFabIndices.push_back(tempIndex);
-		vIndex++;
-	}
-
-	// Calculate bounding radius
-	float maxDistance = 0.0f;
-	if (isColoured)
-	{
-		for (const auto& vertex : preFabColouredVertices)
-		{
-			XMVECTOR pos = XMLoadFloat3(&vertex.position);
-			float distance = XMVectorGetX(XMVector3Length(pos));
-			maxDistance = std::max(maxDistance, distance);
-		}
-	}
-	else
-	{
-		for (const auto& vertex : preFabVertices)
-		{
-			XMVECTOR pos = XMLoadFloat3(&vertex.position);
-			float distance = XMVectorGetX(XMVector3Length(pos));
-			maxDistance = std::max(maxDistance, distance);
-		}
-	}
-
-	m_originalRadius = maxDistance;
-
-	// Compute bounding box extents
-	DirectX::SimpleMath::Vector3 minBounds(FLT_MAX, FLT_MAX, FLT_MAX);
-	DirectX::SimpleMath::Vector3 maxBounds(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-	
-	for (const auto& vertex : preFabVertices)
-	{
-		minBounds.x = std::min(minBounds.x, vertex.position.x);
-		minBounds.y = std::min(minBounds.y, vertex.position.y);
-		minBounds.z = std::min(minBounds.z, vertex.position.z);
-
-		maxBounds.x = std::max(maxBounds.x, vertex.position.x);
-		maxBounds.y = std::max(maxBounds.y, vertex.position.y);
-		maxBounds.z = std::max(maxBounds.z, vertex.position.z);
-	}
-
-	// Store original extents (half the size of the bounding box)
-	m_originalExtents = (maxBounds - minBounds) * 0.5f;
-
-	m_indexCount = vIndex;
-
-	verts.clear();
-	norms.clear();
-	texCs.clear();
-	faces.clear();
-	return true;
-}
-
-
-void ModelClass::ReleaseModel()
-{
-	return;
-}
-
 void ModelClass::SetScale(const DirectX::SimpleMath::Vector3& scale)
 {
 	m_scale = scale;
+	m_isTransformDirty = true;
 }
 
 const DirectX::SimpleMath::Vector3& ModelClass::GetScale() const
@@ -429,6 +200,7 @@ const DirectX::SimpleMath::Vector3& ModelClass::GetScale() const
 void ModelClass::SetPosition(const DirectX::SimpleMath::Vector3& position)
 {
 	m_position = position;
+	m_isTransformDirty = true;
 }
 
 const DirectX::SimpleMath::Vector3& ModelClass::GetPosition() const
@@ -448,18 +220,16 @@ const DirectX::SimpleMath::Vector3& ModelClass::GetLocalPosition() const
 
 const DirectX::SimpleMath::Vector3& ModelClass::GetWorldPosition() const
 {
-	const auto localPosition = GetPosition();
-	const auto worldMatrix = GetWorldMatrix();
-	//const auto worldMatrix = DirectX::SimpleMath::Matrix::CreateTranslation(localPosition);
-	const auto worldPosition = DirectX::SimpleMath::Vector3::Transform(localPosition, worldMatrix);
+	UpdateTransformCache();
 
-	return worldPosition;
+	return m_worldPosition;
 }
 
 // Add methods for rotation
 void ModelClass::SetRotation(const DirectX::SimpleMath::Vector3& rotation)
 {
 	m_rotation = rotation;
+	m_isTransformDirty = true;
 }
 
 const DirectX::SimpleMath::Vector3& ModelClass::GetRotation() const
@@ -470,28 +240,43 @@ const DirectX::SimpleMath::Vector3& ModelClass::GetRotation() const
 // Method to get world matrix based on scale, rotation and position
 DirectX::SimpleMath::Matrix ModelClass::GetWorldMatrix() const
 {
+	UpdateTransformCache();
+
+	return m_worldMatrix;
+}
+
+void ModelClass::UpdateTransformCache() const
+{
+	if (!m_isTransformDirty)
+	{
+		return;
+	}
+
 	// Create world matrix using scale, rotation and position
-	return DirectX::SimpleMath::Matrix::CreateScale(m_scale) * 
+	m_worldMatrix = DirectX::SimpleMath::Matrix::CreateScale(m_scale) * 
 		DirectX::SimpleMath::Matrix::CreateFromYawPitchRoll(
 		m_rotation.y * 3.14159f / 180.0f,  // Yaw
 		m_rotation.x * 3.14159f / 180.0f,  // Pitch
 		m_rotation.z * 3.14159f / 180.0f   // Roll
 	) * DirectX::SimpleMath::Matrix::CreateTranslation(m_position);
+
+	m_worldPosition = DirectX::SimpleMath::Vector3::Transform(m_position, m_worldMatrix);
+
+	m_obb.center = m_worldPosition;
+	m_obb.extents = m_originalExtents * m_scale;
+
+	// Decompose the world matrix into scale, rotation (quaternion), and translation
+	DirectX::SimpleMath::Vector3 scale;
+	DirectX::SimpleMath::Vector3 translation;
+	m_worldMatrix.Decompose(scale, m_obb.orientation, translation);
+
+	m_isTransformDirty = false;
 }
 
-void ModelClass::ChangeColour(ID3D11Device* device, const Enums::COLOUR& colour, const DirectX::SimpleMath::Vector4& colourVector)
+void ModelClass::ChangeColour(const Enums::COLOUR& colour, const DirectX::SimpleMath::Vector4& colourVector)
 {
-	for (int i = 0; i < m_vertexCount; i++)
-	{
-		preFabColouredVertices[i].color.x = colourVector.x;
-		preFabColouredVertices[i].color.y = colourVector.y;
-		preFabColouredVertices[i].color.z = colourVector.z;
-		preFabColouredVertices[i].color.w = colourVector.w;
-	}
-
 	m_colour = colour;
-
-	InitializeBuffers(device, true);
+	m_colourVector = colourVector;
 }
 
 float ModelClass::GetBoundingRadius() const
@@ -517,19 +302,9 @@ void ModelClass::UpdateBoundingSphere()
 
 ModelClass::OBB ModelClass::GetOBB() const
 {
-	OBB obb;
-	obb.center = GetWorldPosition();
-	obb.extents = m_originalExtents * m_scale;
-
-	// Decompose the world matrix into scale, rotation (quaternion), and translation
-	DirectX::SimpleMath::Vector3 scale;
-	DirectX::SimpleMath::Quaternion rotation;
-	DirectX::SimpleMath::Vector3 translation;
-	GetWorldMatrix().Decompose(scale, rotation, translation);
-
-	obb.orientation = rotation;
+	UpdateTransformCache();
 
-	return obb;
+	return m_obb;
 }
 
 bool ModelClass::CheckCollision(const ModelClass& model)
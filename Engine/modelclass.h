@@ -14,6 +14,7 @@
 //using namespace std;
 
 #include "Enums.h"
+#include "MeshRegistry.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // Class name: ModelClass
@@ -49,12 +50,17 @@ public:
 	ModelClass();
 	~ModelClass();
 
-	bool InitializeModel(ID3D11Device *device, char* filename, bool isColoured = false);
+	// Models loaded from the same file share one mesh through MeshRegistry.
+	bool InitializeModel(ID3D11Device *device, char* filename);
 	bool InitializeTeapot(ID3D11Device*);
 	bool InitializeSphere(ID3D11Device*);
 	bool InitializeBox(ID3D11Device*, float xwidth, float yheight, float zdepth);
+	// Creates an unshared mesh from ready-made geometry; vertices must be laid out as VertexType.
+	bool InitializeMesh(ID3D11Device*, const void* vertices, int vertexCount, const uint32_t* indices, int indexCount);
 	void Shutdown();
 	void Render(ID3D11DeviceContext*);
+	// Draws instanceCount copies with instanceBuffer bound as the per-instance stream in slot 1.
+	void RenderInstanced(ID3D11DeviceContext*, ID3D11Buffer* instanceBuffer, unsigned int instanceStride, unsigned int instanceCount);
 	
 	int GetIndexCount();
 
@@ -70,12 +76,15 @@ public:
 	void SetRotation(const DirectX::SimpleMath::Vector3& rotation);
 	const DirectX::SimpleMath::Vector3& GetRotation() const;
 
+	// The world matrix, world position and OBB are cached and only rebuilt after a transform setter runs.
 	DirectX::SimpleMath::Matrix GetWorldMatrix() const;
 
 	const DirectX::SimpleMath::Vector3& GetWorldPosition() const;
 
-	void ChangeColour(ID3D11Device* device, const Enums::COLOUR& colour, const DirectX::SimpleMath::Vector4& colourVector);
+	// Only records the colour; it reaches the pixel shader as a per-draw material (Shader::SetMaterialColour).
+	void ChangeColour(const Enums::COLOUR& colour, const DirectX::SimpleMath::Vector4& colourVector);
 	const Enums::COLOUR& GetColour() const { return m_colour; }
+	const DirectX::SimpleMath::Vector4& GetColourVector() const { return m_colourVector; }
 
 	float GetBoundingRadius() const;
 
@@ -85,8 +94,8 @@ public:
 	void SetCollidingWithModel(const bool colliding) { isCollidingWithModel = colliding; }
 	const bool IsCollidingWithModel() const { return isCollidingWithModel; }
 
-	ID3D11Buffer* GetVertexBuffer() { return m_vertexBuffer; }
-	ID3D11Buffer* GetIndexBuffer() { return m_indexBuffer; }
+	ID3D11Buffer* GetVertexBuffer() { return m_mesh ? m_mesh->vertexBuffer.Get() : nullptr; }
+	ID3D11Buffer* GetIndexBuffer() { return m_mesh ? m_mesh->indexBuffer.Get() : nullptr; }
 
 	BoundingSphere GetBoundingSphere() const;
 	void UpdateBoundingSphere(); // Call after position/scale changes
@@ -96,21 +105,16 @@ public:
 	bool CheckCollision(const ModelClass& model);
 
 private:
-	bool InitializeBuffers(ID3D11Device*, const bool isColoured = false);
+	bool InitializeBuffers(ID3D11Device*, const std::vector<VertexPositionNormalTexture>& vertices, const std::vector<uint16_t>& indices);
+	void SetMesh(std::shared_ptr<const MeshAsset> mesh);
+	void UpdateTransformCache() const;
 	void ShutdownBuffers();
 	void RenderBuffers(ID3D11DeviceContext*);
-	bool LoadModel(char*, bool isColoured = false);
-
-	void ReleaseModel();
 
 private:
-	ID3D11Buffer *m_vertexBuffer, *m_indexBuffer;
-	int m_vertexCount, m_indexCount;
-
-	//arrays for our generated objects Made by directX
-	std::vector<VertexPositionNormalTexture> preFabVertices;
-	std::vector<VertexPositionNormalColorTexture> preFabColouredVertices;
-	std::vector<uint16_t> preFabIndices;
+	// Shared with every other model using the same mesh; the model itself only holds its transform,
+	// colour and collision state.
+	std::shared_ptr<const MeshAsset> m_mesh;
 
 	DirectX::SimpleMath::Vector3 m_scale = DirectX::SimpleMath::Vector3::Zero;
 	DirectX::SimpleMath::Vector3 m_position = DirectX::SimpleMath::Vector3::Zero;
@@ -122,12 +126,17 @@ private:
 	bool isCollidingWithModel = false;
 
 	Enums::COLOUR m_colour;
+	DirectX::SimpleMath::Vector4 m_colourVector = DirectX::SimpleMath::Vector4::Zero;
 
 	BoundingSphere m_boundingSphere;
 	float m_originalRadius = 0.0f; // Precomputed during model initialization
 
-	OBB m_obb;
 	DirectX::SimpleMath::Vector3 m_originalExtents;
+
+	mutable bool m_isTransformDirty = true;
+	mutable DirectX::SimpleMath::Matrix m_worldMatrix;
+	mutable DirectX::SimpleMath::Vector3 m_worldPosition;
+	mutable OBB m_obb;
 };
 
 #endif
\ No newline at end of file